@@ -24,6 +24,7 @@
 
 #include <inttypes.h>
 #include <nuttx/tls.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include "utils/BinderString.h"
@@ -55,7 +56,7 @@ IAIDLServiceManager* IAIDLServiceManager_asInterface(IBinder* obj)
     IAIDLServiceManager_global* global = IAIDLServiceManager_global_get();
 
     if (obj != NULL) {
-        intr = (IAIDLServiceManager*)obj->queryLocalInterface(obj, &global->descriptor);
+        intr = (IAIDLServiceManager*)IInterface_queryLocal(obj, &global->descriptor);
 
         if (intr == NULL) {
             intr = (IAIDLServiceManager*)BpAIDLServiceManager_new(obj);
@@ -103,3 +104,81 @@ void IAIDLServiceManager_ctor(IAIDLServiceManager* this)
 
     this->dtor = IAIDLServiceManager_dtor;
 }
+
+uint32_t ServiceDebugInfo_writeToParcel(const ServiceDebugInfo* this, Parcel* parcel)
+{
+    size_t start = Parcel_dataPosition(parcel);
+    size_t end;
+    uint32_t status;
+
+    /* Size first, so that a reader knowing fewer fields skips the rest */
+
+    status = Parcel_writeInt32(parcel, 0);
+    if (status == STATUS_OK) {
+        status = Parcel_writeString16(parcel, (String*)&this->name);
+    }
+    if (status == STATUS_OK) {
+        status = Parcel_writeInt32(parcel, this->pid);
+    }
+    if (status == STATUS_OK) {
+        status = Parcel_writeInt32(parcel, this->clients);
+    }
+    if (status == STATUS_OK) {
+        status = Parcel_writeInt64(parcel, this->lookups);
+    }
+    if (status == STATUS_OK) {
+        status = Parcel_writeInt64(parcel, this->lastLookupMs);
+    }
+    if (status != STATUS_OK) {
+        return status;
+    }
+
+    end = Parcel_dataPosition(parcel);
+    Parcel_setDataPosition(parcel, start);
+    Parcel_writeInt32(parcel, end - start);
+    Parcel_setDataPosition(parcel, end);
+    return STATUS_OK;
+}
+
+uint32_t ServiceDebugInfo_readFromParcel(ServiceDebugInfo* this, Parcel* parcel)
+{
+    size_t start = Parcel_dataPosition(parcel);
+    int32_t size;
+    uint32_t status;
+
+    status = Parcel_readInt32(parcel, &size);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    if (size < (int32_t)sizeof(int32_t) || (size_t)size - sizeof(int32_t) > Parcel_dataAvail(parcel)) {
+        return STATUS_BAD_VALUE;
+    }
+
+    status = Parcel_readString16_to(parcel, &this->name);
+    if (status == STATUS_OK) {
+        status = Parcel_readInt32(parcel, &this->pid);
+    }
+    if (status == STATUS_OK) {
+        status = Parcel_readInt32(parcel, &this->clients);
+    }
+    if (status == STATUS_OK) {
+        status = Parcel_readInt64(parcel, &this->lookups);
+    }
+    if (status == STATUS_OK) {
+        status = Parcel_readInt64(parcel, &this->lastLookupMs);
+    }
+    if (status != STATUS_OK) {
+        return status;
+    }
+
+    Parcel_setDataPosition(parcel, start + size);
+    return STATUS_OK;
+}
+
+void ServiceDebugInfo_clearVector(VectorImpl* infos)
+{
+    for (size_t i = 0; i < infos->size(infos); i++) {
+        free(infos->get(infos, i));
+    }
+    infos->clear(infos);
+}
@@ -31,6 +31,22 @@
 #include "utils/BinderString.h"
 #include "utils/RefBase.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Most names one getServices() carries, so that the request and the
+ * reply both fit well within the 4 KB binder buffer.
+ */
+
+#define AIDL_SERVICE_MANAGER_MAX_GET_SERVICES 16
+
+/* Most names one listServicesPaged() returns, 16 names of the longest
+ * String still fit the 4 KB binder buffer.
+ */
+
+#define AIDL_SERVICE_MANAGER_MAX_LIST_SERVICES 16
+
 /****************************************************************************
  * Public Types
  ****************************************************************************/
@@ -44,6 +60,22 @@ enum {
     DUMP_FLAG_PRIORITY_ALL = DUMP_FLAG_PRIORITY_CRITICAL | DUMP_FLAG_PRIORITY_HIGH | DUMP_FLAG_PRIORITY_NORMAL | DUMP_FLAG_PRIORITY_DEFAULT,
 };
 
+/* What servicemanager knows about one service, android::os::ServiceDebugInfo
+ * with the lookup statistics added. Sent as a parcelable prefixed with its
+ * size, so fields can be appended later.
+ */
+
+struct ServiceDebugInfo;
+typedef struct ServiceDebugInfo ServiceDebugInfo;
+
+struct ServiceDebugInfo {
+    String name;
+    int pid; /* Process that registered it */
+    int clients; /* Processes other than servicemanager holding it, -1 if unknown */
+    int64_t lookups; /* getService() and checkService() calls that found it */
+    int64_t lastLookupMs; /* uptimeMillis() of the last of them, 0 if never */
+};
+
 /* IAIDLServiceManager = android::os::IServiceManager
  * android::os::IServiceManager != IServiceManager
  * android::os::IServiceManager is generate with aidl,
@@ -81,8 +113,27 @@ struct IAIDLServiceManager {
         const IClientCallback* callback, Status* retStatus);
     void (*tryUnregisterService)(IAIDLServiceManager* this, String* name, IBinder* service,
         Status* retStatus);
-    void (*getServiceDebugInfo)(IAIDLServiceManager* this, VectorString* aidl_return,
+
+    /* A page of ServiceDebugInfo* like listServicesPaged(), the caller
+     * frees them with ServiceDebugInfo_clearVector().
+     */
+
+    void (*getServiceDebugInfoPaged)(IAIDLServiceManager* this, String* startAfter, int32_t maxCount,
+        VectorImpl* aidl_return, Status* retStatus);
+
+    /* getService() for each of names in one transaction, aidl_return
+     * gets one IBinder* per name, NULL for the ones not registered.
+     */
+
+    void (*getServices)(IAIDLServiceManager* this, VectorString* names, VectorImpl* aidl_return,
         Status* retStatus);
+
+    /* listServices() a page at a time: at most maxCount names sorted after
+     * startAfter ("" for the first page), fewer than maxCount on the last.
+     */
+
+    void (*listServicesPaged)(IAIDLServiceManager* this, int32_t dumpPriority, String* startAfter,
+        int32_t maxCount, VectorString* aidl_return, Status* retStatus);
 };
 
 void IAIDLServiceManager_ctor(IAIDLServiceManager* this);
@@ -92,4 +143,8 @@ IAIDLServiceManager* IAIDLServiceManager_asInterface(IBinder* obj);
 bool IAIDLServiceManager_setDefaultImpl(IAIDLServiceManager* impl);
 IAIDLServiceManager* IAIDLServiceManager_getDefaultImpl(void);
 
+uint32_t ServiceDebugInfo_writeToParcel(const ServiceDebugInfo* this, Parcel* parcel);
+uint32_t ServiceDebugInfo_readFromParcel(ServiceDebugInfo* this, Parcel* parcel);
+void ServiceDebugInfo_clearVector(VectorImpl* infos);
+
 #endif /* __BINDER_INCLUDE_BINDER_AIDLSERVERMANAGER_H__ */
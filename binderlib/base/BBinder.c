@@ -35,6 +35,7 @@
 #include "IInterface.h"
 #include "IPCThreadState.h"
 #include "Parcel.h"
+#include "ProcessGlobal.h"
 #include "utils/Binderlog.h"
 #include <android/binder_status.h>
 
@@ -64,7 +65,10 @@ BBinder_Extras* BBinder_Extras_new(void)
 {
     BBinder_Extras* this;
 
-    this = zalloc(sizeof(BBinder_Extras));
+    this = SlabCache_alloc(&Slab_global_get()->sBBinderExtras);
+    if (this == NULL) {
+        return NULL;
+    }
 
     BBinder_Extras_ctor(this);
     return this;
@@ -73,7 +77,7 @@ BBinder_Extras* BBinder_Extras_new(void)
 void BBinder_Extras_delete(BBinder_Extras* this)
 {
     this->dtor(this);
-    free(this);
+    SlabCache_free(&Slab_global_get()->sBBinderExtras, this);
 }
 
 static bool BBinder_isBinderAlive(BBinder* this)
@@ -101,12 +105,8 @@ static uint32_t BBinder_transact(BBinder* this, uint32_t code,
     const Parcel* in_data, Parcel* reply,
     uint32_t flags)
 {
-    Parcel data;
-
-    Parcel_initState(&data);
-    Parcel_dup(&data, in_data);
-
-    Parcel_setDataPosition(&data, 0);
+    ParcelCursor cursor;
+    Parcel* data = ParcelCursor_begin(&cursor, in_data);
 
     if (reply != NULL && (flags & FLAG_CLEAR_BUF)) {
         Parcel_markSensitive(reply);
@@ -133,11 +133,13 @@ static uint32_t BBinder_transact(BBinder* this, uint32_t code,
     }
 
     default: {
-        err = this->onTransact(this, code, &data, reply, flags);
+        err = this->onTransact(this, code, data, reply, flags);
         break;
     }
     }
 
+    ParcelCursor_end(&cursor);
+
     /* In case this is being transacted on in the same process. */
     if (reply != NULL) {
         Parcel_setDataPosition(reply, 0);
@@ -230,12 +232,22 @@ static BBinder* BBinder_localBinder(BBinder* this)
 static BBinder_Extras* BBinder_getOrCreateExtras(BBinder* this)
 {
     BBinder_Extras* e = atomic_load_explicit(&this->mExtras, memory_order_acquire);
+    BBinder_Extras* expected = NULL;
 
-    if (!e) {
-        e = BBinder_Extras_new();
-        if (e == NULL) {
-            return NULL; /* out of memory */
-        }
+    if (e) {
+        return e;
+    }
+
+    e = BBinder_Extras_new();
+    if (e == NULL) {
+        return NULL; /* out of memory */
+    }
+
+    /* Another thread may have won the race; use its extras and drop ours */
+
+    if (!atomic_compare_exchange_strong(&this->mExtras, &expected, e)) {
+        BBinder_Extras_delete(e);
+        e = expected;
     }
 
     return e;
@@ -260,10 +272,9 @@ uint32_t BBinder_onTransact(BBinder* this, uint32_t code,
     const struct Parcel* in_data,
     struct Parcel* reply, uint32_t flags)
 {
-    Parcel data;
-
-    Parcel_initState(&data);
-    Parcel_dup(&data, in_data);
+    ParcelCursor cursor;
+    Parcel* data = ParcelCursor_begin(&cursor, in_data);
+    uint32_t err = STATUS_OK;
 
     switch (code) {
     case INTERFACE_TRANSACTION: {
@@ -271,41 +282,44 @@ uint32_t BBinder_onTransact(BBinder* this, uint32_t code,
         String desc;
         String_dup(&desc, this->getInterfaceDescriptor(this));
         Parcel_writeString16(reply, &desc);
-        return STATUS_OK;
+        break;
     }
 
     case DUMP_TRANSACTION: {
-        int fd = Parcel_readFileDescriptor(&data);
+        int fd = Parcel_readFileDescriptor(data);
         int32_t argc;
-        uint32_t ret;
 
-        Parcel_readInt32(&data, &argc);
+        Parcel_readInt32(data, &argc);
         VectorString args;
         VectorString_ctor(&args);
         String str;
-        for (int i = 0; i < argc && Parcel_dataAvail(&data) > 0; i++) {
-            Parcel_readString16_to(&data, &str);
+        for (int i = 0; i < argc && Parcel_dataAvail(data) > 0; i++) {
+            Parcel_readString16_to(data, &str);
             args.add(&args, &str);
         }
-        ret = this->dump(this, fd, &args);
+        err = this->dump(this, fd, &args);
         args.dtor(&args);
-        return ret;
+        break;
     }
 
     case SHELL_COMMAND_TRANSACTION: {
         BINDER_LOGD("Unsupport: SHELL_COMMAND_TRANSACTION\n");
-        return STATUS_OK;
+        break;
     }
 
     case SYSPROPS_TRANSACTION: {
         BINDER_LOGD("Unsupport: SYSPROPS_TRANSACTION\n");
-        return STATUS_OK;
+        break;
     }
 
     default: {
-        return STATUS_UNKNOWN_TRANSACTION;
+        err = STATUS_UNKNOWN_TRANSACTION;
+        break;
     }
     }
+
+    ParcelCursor_end(&cursor);
+    return err;
 }
 
 static bool BBinder_isRequestingSid(BBinder* this)
@@ -107,6 +107,13 @@ struct BBinder {
 
 void BBinder_ctor(BBinder* this);
 
+/* Default onTransact of BBinder, for subclasses that override it and
+ * still want the generic transactions answered.
+ */
+
+uint32_t BBinder_onTransact(BBinder* this, uint32_t code,
+    const Parcel* data, Parcel* reply, uint32_t flags);
+
 struct BpRefBase;
 typedef struct BpRefBase BpRefBase;
 
@@ -63,6 +63,13 @@ static String* BnInterface_IAIDLServiceManager_Vfun_getInterfaceDescriptor(IBind
     return this->getInterfaceDescriptor(this);
 }
 
+static IInterface* BnInterface_IAIDLServiceManager_Vfun_queryLocalInterface(IBinder* v_this,
+    String* descriptor)
+{
+    BnInterface_IAIDLServiceManager* this = (BnInterface_IAIDLServiceManager*)v_this;
+    return this->queryLocalInterface(this, descriptor);
+}
+
 static void BnInterface_IAIDLServiceManager_dtor(BnInterface_IAIDLServiceManager* this)
 {
     this->m_IAIDLServiceManager.dtor(&this->m_IAIDLServiceManager);
@@ -77,6 +84,7 @@ void BnInterface_IAIDLServiceManager_ctor(BnInterface_IAIDLServiceManager* this)
 
     /* Override Pure Virtual function in IBinder */
     ibinder->getInterfaceDescriptor = BnInterface_IAIDLServiceManager_Vfun_getInterfaceDescriptor;
+    ibinder->queryLocalInterface = BnInterface_IAIDLServiceManager_Vfun_queryLocalInterface;
 
     this->queryLocalInterface = BnInterface_IAIDLServiceManager_queryLocalInterface;
     this->getInterfaceDescriptor = BnInterface_IAIDLServiceManager_getInterfaceDescriptor;
@@ -90,22 +98,19 @@ static uint32_t BnAIDLServiceManager_onTransact(BnAIDLServiceManager* this, uint
     uint32_t aidl_flags)
 {
     int32_t aidl_ret_status = STATUS_OK;
-    Parcel data;
-
-    Parcel_initState(&data);
-
-    Parcel_dup(&data, aidl_data);
+    ParcelCursor cursor;
+    Parcel* data = ParcelCursor_begin(&cursor, aidl_data);
 
     switch (aidl_code) {
     case BnServiceManager_TRANSACTION_getService: {
         String in_name;
         String_init(&in_name, NULL);
         IBinder* aidl_return;
-        if (!(Parcel_checkInterface(&data, (IBinder*)this))) {
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
             aidl_ret_status = STATUS_BAD_TYPE;
             break;
         }
-        aidl_ret_status = Parcel_readString16_to(&data, &in_name);
+        aidl_ret_status = Parcel_readString16_to(data, &in_name);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
@@ -128,11 +133,11 @@ static uint32_t BnAIDLServiceManager_onTransact(BnAIDLServiceManager* this, uint
         String in_name;
         String_init(&in_name, NULL);
         IBinder* aidl_return = NULL;
-        if (!(Parcel_checkInterface(&data, (IBinder*)this))) {
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
             aidl_ret_status = STATUS_BAD_TYPE;
             break;
         }
-        aidl_ret_status = Parcel_readString16_to(&data, &in_name);
+        aidl_ret_status = Parcel_readString16_to(data, &in_name);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
@@ -157,23 +162,23 @@ static uint32_t BnAIDLServiceManager_onTransact(BnAIDLServiceManager* this, uint
         IBinder* in_service;
         bool in_allowIsolated;
         int32_t in_dumpPriority;
-        if (!(Parcel_checkInterface(&data, (IBinder*)this))) {
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
             aidl_ret_status = STATUS_BAD_TYPE;
             break;
         }
-        aidl_ret_status = Parcel_readString16_to(&data, &in_name);
+        aidl_ret_status = Parcel_readString16_to(data, &in_name);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
-        aidl_ret_status = Parcel_readStrongBinder(&data, &in_service);
+        aidl_ret_status = Parcel_readStrongBinder(data, &in_service);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
-        aidl_ret_status = Parcel_readBool(&data, &in_allowIsolated);
+        aidl_ret_status = Parcel_readBool(data, &in_allowIsolated);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
-        aidl_ret_status = Parcel_readInt32(&data, &in_dumpPriority);
+        aidl_ret_status = Parcel_readInt32(data, &in_dumpPriority);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
@@ -191,38 +196,33 @@ static uint32_t BnAIDLServiceManager_onTransact(BnAIDLServiceManager* this, uint
     case BnServiceManager_TRANSACTION_listServices: {
         int32_t in_dumpPriority;
         VectorString aidl_return;
-        if (!(Parcel_checkInterface(&data, (IBinder*)this))) {
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
             aidl_ret_status = STATUS_BAD_TYPE;
             break;
         }
-        aidl_ret_status = Parcel_readInt32(&data, &in_dumpPriority);
+        aidl_ret_status = Parcel_readInt32(data, &in_dumpPriority);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
+        VectorString_ctor(&aidl_return);
         Status aidl_status;
         Status_init(&aidl_status);
         this->listServices(this, in_dumpPriority, &aidl_return, &aidl_status);
         aidl_ret_status = Status_writeToParcel(&aidl_status, aidl_reply);
-        if (aidl_ret_status != STATUS_OK) {
-            break;
-        }
-        if (!(aidl_status.mException == EX_NONE)) {
-            break;
-        }
-        aidl_ret_status = Parcel_writeUtf8VectorAsUtf16Vector(aidl_reply, &aidl_return);
-        if (aidl_ret_status != STATUS_OK) {
-            break;
+        if (aidl_ret_status == STATUS_OK && aidl_status.mException == EX_NONE) {
+            aidl_ret_status = Parcel_writeUtf8VectorAsUtf16Vector(aidl_reply, &aidl_return);
         }
+        aidl_return.dtor(&aidl_return);
     } break;
     case BnServiceManager_TRANSACTION_isDeclared: {
         String in_name;
         String_init(&in_name, NULL);
         bool aidl_return;
-        if (!(Parcel_checkInterface(&data, (IBinder*)this))) {
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
             aidl_ret_status = STATUS_BAD_TYPE;
             break;
         }
-        aidl_ret_status = Parcel_readUtf8FromUtf16(&data, &in_name);
+        aidl_ret_status = Parcel_readUtf8FromUtf16(data, &in_name);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
@@ -245,42 +245,224 @@ static uint32_t BnAIDLServiceManager_onTransact(BnAIDLServiceManager* this, uint
         String in_iface;
         String_init(&in_iface, NULL);
         VectorString aidl_return;
-        if (!(Parcel_checkInterface(&data, (IBinder*)this))) {
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
             aidl_ret_status = STATUS_BAD_TYPE;
             break;
         }
-        aidl_ret_status = Parcel_readUtf8FromUtf16(&data, &in_iface);
+        aidl_ret_status = Parcel_readUtf8FromUtf16(data, &in_iface);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
+        VectorString_ctor(&aidl_return);
         Status aidl_status;
         Status_init(&aidl_status);
         this->getDeclaredInstances(this, &in_iface, &aidl_return, &aidl_status);
         aidl_ret_status = Status_writeToParcel(&aidl_status, aidl_reply);
+        if (aidl_ret_status == STATUS_OK && aidl_status.mException == EX_NONE) {
+            aidl_ret_status = Parcel_writeUtf8VectorAsUtf16Vector(aidl_reply, &aidl_return);
+        }
+        aidl_return.dtor(&aidl_return);
+    } break;
+    case BnServiceManager_TRANSACTION_registerForNotifications:
+    case BnServiceManager_TRANSACTION_unregisterForNotifications: {
+        String in_name;
+        String_init(&in_name, NULL);
+        IBinder* in_callback;
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
+            aidl_ret_status = STATUS_BAD_TYPE;
+            break;
+        }
+        aidl_ret_status = Parcel_readString16_to(data, &in_name);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
-        if (!(aidl_status.mException == EX_NONE)) {
+        aidl_ret_status = Parcel_readStrongBinder(data, &in_callback);
+        if (aidl_ret_status != STATUS_OK) {
             break;
         }
-        aidl_ret_status = Parcel_writeUtf8VectorAsUtf16Vector(aidl_reply, &aidl_return);
+        Status aidl_status;
+        Status_init(&aidl_status);
+
+        /* The callback travels as its binder, see IServiceCallback.h */
+
+        if (aidl_code == BnServiceManager_TRANSACTION_registerForNotifications) {
+            this->registerForNotifications(this, &in_name, (const IServiceCallback*)in_callback, &aidl_status);
+        } else {
+            this->unregisterForNotifications(this, &in_name, (const IServiceCallback*)in_callback, &aidl_status);
+        }
+        aidl_ret_status = Status_writeToParcel(&aidl_status, aidl_reply);
         if (aidl_ret_status != STATUS_OK) {
             break;
         }
     } break;
-    case BnServiceManager_TRANSACTION_registerForNotifications:
-    case BnServiceManager_TRANSACTION_unregisterForNotifications:
+    case BnServiceManager_TRANSACTION_registerClientCallback: {
+        String in_name;
+        String_init(&in_name, NULL);
+        IBinder* in_service;
+        IBinder* in_callback;
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
+            aidl_ret_status = STATUS_BAD_TYPE;
+            break;
+        }
+        aidl_ret_status = Parcel_readString16_to(data, &in_name);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+        aidl_ret_status = Parcel_readStrongBinder(data, &in_service);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+        aidl_ret_status = Parcel_readStrongBinder(data, &in_callback);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+        Status aidl_status;
+        Status_init(&aidl_status);
+
+        /* The callback travels as its binder, see IClientCallback.h */
+
+        this->registerClientCallback(this, &in_name, in_service, (const IClientCallback*)in_callback,
+            &aidl_status);
+        aidl_ret_status = Status_writeToParcel(&aidl_status, aidl_reply);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+    } break;
+    case BnServiceManager_TRANSACTION_tryUnregisterService: {
+        String in_name;
+        String_init(&in_name, NULL);
+        IBinder* in_service;
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
+            aidl_ret_status = STATUS_BAD_TYPE;
+            break;
+        }
+        aidl_ret_status = Parcel_readString16_to(data, &in_name);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+        aidl_ret_status = Parcel_readStrongBinder(data, &in_service);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+        Status aidl_status;
+        Status_init(&aidl_status);
+        this->tryUnregisterService(this, &in_name, in_service, &aidl_status);
+        aidl_ret_status = Status_writeToParcel(&aidl_status, aidl_reply);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+    } break;
+    case BnServiceManager_TRANSACTION_getServices: {
+        VectorString in_names;
+        VectorImpl aidl_return;
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
+            aidl_ret_status = STATUS_BAD_TYPE;
+            break;
+        }
+        VectorString_ctor(&in_names);
+        VectorImpl_ctor(&aidl_return);
+        aidl_ret_status = Parcel_readUtf8VectorFromUtf16Vector(data, &in_names);
+        if (aidl_ret_status == STATUS_OK) {
+            Status aidl_status;
+            Status_init(&aidl_status);
+            this->getServices(this, &in_names, &aidl_return, &aidl_status);
+            aidl_ret_status = Status_writeToParcel(&aidl_status, aidl_reply);
+            if (aidl_ret_status == STATUS_OK && aidl_status.mException == EX_NONE) {
+                size_t count = aidl_return.size(&aidl_return);
+
+                aidl_ret_status = Parcel_writeInt32(aidl_reply, (int32_t)count);
+                for (size_t i = 0; aidl_ret_status == STATUS_OK && i < count; i++) {
+                    aidl_ret_status = Parcel_writeStrongBinder(aidl_reply, aidl_return.get(&aidl_return, i));
+                }
+            }
+        }
+        aidl_return.dtor(&aidl_return);
+        in_names.dtor(&in_names);
+    } break;
+    case BnServiceManager_TRANSACTION_listServicesPaged: {
+        int32_t in_dumpPriority;
+        String in_startAfter;
+        String_init(&in_startAfter, NULL);
+        int32_t in_maxCount;
+        VectorString aidl_return;
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
+            aidl_ret_status = STATUS_BAD_TYPE;
+            break;
+        }
+        aidl_ret_status = Parcel_readInt32(data, &in_dumpPriority);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+        aidl_ret_status = Parcel_readString16_to(data, &in_startAfter);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+        aidl_ret_status = Parcel_readInt32(data, &in_maxCount);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+        VectorString_ctor(&aidl_return);
+        Status aidl_status;
+        Status_init(&aidl_status);
+        this->listServicesPaged(this, in_dumpPriority, &in_startAfter, in_maxCount,
+            &aidl_return, &aidl_status);
+        aidl_ret_status = Status_writeToParcel(&aidl_status, aidl_reply);
+        if (aidl_ret_status == STATUS_OK && aidl_status.mException == EX_NONE) {
+            aidl_ret_status = Parcel_writeUtf8VectorAsUtf16Vector(aidl_reply, &aidl_return);
+        }
+        aidl_return.dtor(&aidl_return);
+    } break;
+    case BnServiceManager_TRANSACTION_getServiceDebugInfoPaged: {
+        String in_startAfter;
+        String_init(&in_startAfter, NULL);
+        int32_t in_maxCount;
+        VectorImpl aidl_return;
+        if (!(Parcel_checkInterface(data, (IBinder*)this))) {
+            aidl_ret_status = STATUS_BAD_TYPE;
+            break;
+        }
+        aidl_ret_status = Parcel_readString16_to(data, &in_startAfter);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+        aidl_ret_status = Parcel_readInt32(data, &in_maxCount);
+        if (aidl_ret_status != STATUS_OK) {
+            break;
+        }
+        VectorImpl_ctor(&aidl_return);
+        Status aidl_status;
+        Status_init(&aidl_status);
+        this->getServiceDebugInfoPaged(this, &in_startAfter, in_maxCount, &aidl_return, &aidl_status);
+        aidl_ret_status = Status_writeToParcel(&aidl_status, aidl_reply);
+        if (aidl_ret_status == STATUS_OK && aidl_status.mException == EX_NONE) {
+            size_t count = aidl_return.size(&aidl_return);
+
+            aidl_ret_status = Parcel_writeInt32(aidl_reply, (int32_t)count);
+            for (size_t i = 0; aidl_ret_status == STATUS_OK && i < count; i++) {
+                /* Non-null marker, then the parcelable */
+
+                aidl_ret_status = Parcel_writeInt32(aidl_reply, 1);
+                if (aidl_ret_status == STATUS_OK) {
+                    aidl_ret_status = ServiceDebugInfo_writeToParcel(aidl_return.get(&aidl_return, i),
+                        aidl_reply);
+                }
+            }
+        }
+        ServiceDebugInfo_clearVector(&aidl_return);
+        aidl_return.dtor(&aidl_return);
+    } break;
     case BnServiceManager_TRANSACTION_getConnectionInfo:
-    case BnServiceManager_TRANSACTION_registerClientCallback:
-    case BnServiceManager_TRANSACTION_tryUnregisterService:
-    case BnServiceManager_TRANSACTION_getServiceDebugInfo:
         BINDER_LOGE("Unsupport at persent, aidl_code=%" PRIu32 "\n", aidl_code - FIRST_CALL_TRANSACTION);
         break;
     default: {
+        /* Not the overridden onTransact, that is this function */
+
         BBinder* pBBinder = &this->m_BnIAidlServiceManager.m_BBinder;
-        aidl_ret_status = pBBinder->onTransact(pBBinder, aidl_code, aidl_data, aidl_reply, aidl_flags);
+        aidl_ret_status = BBinder_onTransact(pBBinder, aidl_code, aidl_data, aidl_reply, aidl_flags);
     } break;
     }
+
+    ParcelCursor_end(&cursor);
     if (aidl_ret_status == STATUS_UNEXPECTED_NULL) {
         Status aidl_status;
         Status_init(&aidl_status);
@@ -354,6 +536,30 @@ static void BnAIDLServiceManager_getDeclaredInstances(BnAIDLServiceManager* this
     aidl->getDeclaredInstances(aidl, iface, aidl_return, retStatus);
 }
 
+static void BnAIDLServiceManager_getServices(BnAIDLServiceManager* this, VectorString* names,
+    VectorImpl* aidl_return, Status* retStatus)
+{
+    IAIDLServiceManager* aidl;
+    aidl = &(this->m_BnIAidlServiceManager.m_IAIDLServiceManager);
+    aidl->getServices(aidl, names, aidl_return, retStatus);
+}
+
+static void BnAIDLServiceManager_listServicesPaged(BnAIDLServiceManager* this, int32_t dumpPriority,
+    String* startAfter, int32_t maxCount, VectorString* aidl_return, Status* retStatus)
+{
+    IAIDLServiceManager* aidl;
+    aidl = &(this->m_BnIAidlServiceManager.m_IAIDLServiceManager);
+    aidl->listServicesPaged(aidl, dumpPriority, startAfter, maxCount, aidl_return, retStatus);
+}
+
+static void BnAIDLServiceManager_getServiceDebugInfoPaged(BnAIDLServiceManager* this, String* startAfter,
+    int32_t maxCount, VectorImpl* aidl_return, Status* retStatus)
+{
+    IAIDLServiceManager* aidl;
+    aidl = &(this->m_BnIAidlServiceManager.m_IAIDLServiceManager);
+    aidl->getServiceDebugInfoPaged(aidl, startAfter, maxCount, aidl_return, retStatus);
+}
+
 static uint32_t BnAIDLServiceManager_Vfun_onTransact(BBinder* v_this, uint32_t code, const Parcel* data,
     Parcel* reply, uint32_t flags)
 {
@@ -382,6 +588,9 @@ void BnAIDLServiceManager_ctor(BnAIDLServiceManager* this)
     this->unregisterForNotifications = BnAIDLServiceManager_unregisterForNotifications;
     this->isDeclared = BnAIDLServiceManager_isDeclared;
     this->getDeclaredInstances = BnAIDLServiceManager_getDeclaredInstances;
+    this->getServices = BnAIDLServiceManager_getServices;
+    this->listServicesPaged = BnAIDLServiceManager_listServicesPaged;
+    this->getServiceDebugInfoPaged = BnAIDLServiceManager_getServiceDebugInfoPaged;
 
     this->onTransact = BnAIDLServiceManager_onTransact;
 
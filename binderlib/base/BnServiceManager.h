@@ -35,7 +35,10 @@ enum {
     BnServiceManager_TRANSACTION_getConnectionInfo = FIRST_CALL_TRANSACTION + 9,
     BnServiceManager_TRANSACTION_registerClientCallback = FIRST_CALL_TRANSACTION + 10,
     BnServiceManager_TRANSACTION_tryUnregisterService = FIRST_CALL_TRANSACTION + 11,
-    BnServiceManager_TRANSACTION_getServiceDebugInfo = FIRST_CALL_TRANSACTION + 12,
+    BnServiceManager_TRANSACTION_getServiceDebugInfo = FIRST_CALL_TRANSACTION + 12, /* Unknown, use ...Paged */
+    BnServiceManager_TRANSACTION_getServices = FIRST_CALL_TRANSACTION + 13,
+    BnServiceManager_TRANSACTION_listServicesPaged = FIRST_CALL_TRANSACTION + 14,
+    BnServiceManager_TRANSACTION_getServiceDebugInfoPaged = FIRST_CALL_TRANSACTION + 15,
 };
 
 struct BnInterface_IAIDLServiceManager;
@@ -76,7 +79,11 @@ struct BnAIDLServiceManager {
     void (*getDeclaredInstances)(BnAIDLServiceManager* this, String* iface, VectorString* aidl_return, Status* retStatus);
     void (*registerClientCallback)(BnAIDLServiceManager* this, String* name, const IBinder* service, const IClientCallback* callback, Status* retStatus);
     void (*tryUnregisterService)(BnAIDLServiceManager* this, String* name, const IBinder* service, Status* retStatus);
-    void (*getServiceDebugInfo)(BnAIDLServiceManager* this, VectorString* aidl_return, Status* retStatus);
+    void (*getServices)(BnAIDLServiceManager* this, VectorString* names, VectorImpl* aidl_return, Status* retStatus);
+    void (*listServicesPaged)(BnAIDLServiceManager* this, int32_t dumpPriority, String* startAfter,
+        int32_t maxCount, VectorString* aidl_return, Status* retStatus);
+    void (*getServiceDebugInfoPaged)(BnAIDLServiceManager* this, String* startAfter, int32_t maxCount,
+        VectorImpl* aidl_return, Status* retStatus);
 
     /* Virtual function */
     uint32_t (*onTransact)(BnAIDLServiceManager* this, uint32_t code,
@@ -32,6 +32,7 @@
 
 #include "BpBinder.h"
 #include "IPCThreadState.h"
+#include "ObituaryExecutor.h"
 #include "ProcessGlobal.h"
 #include "ProcessState.h"
 #include "utils/Binderlog.h"
@@ -122,6 +123,40 @@ void ObjectManager_ctor(ObjectManager* this)
     this->dtor = ObjectManager_dtor;
 }
 
+static void BpBinder_Extras_dtor(BpBinder_Extras* this)
+{
+    this->mObjects.dtor(&this->mObjects);
+    pthread_mutex_destroy(&this->mLock);
+}
+
+static void BpBinder_Extras_ctor(BpBinder_Extras* this)
+{
+    ObjectManager_ctor(&this->mObjects);
+    pthread_mutex_init(&this->mLock, NULL);
+    this->mObituaries = NULL;
+
+    this->dtor = BpBinder_Extras_dtor;
+}
+
+BpBinder_Extras* BpBinder_Extras_new(void)
+{
+    BpBinder_Extras* this;
+
+    this = SlabCache_alloc(&Slab_global_get()->sBpBinderExtras);
+    if (this == NULL) {
+        return NULL;
+    }
+
+    BpBinder_Extras_ctor(this);
+    return this;
+}
+
+void BpBinder_Extras_delete(BpBinder_Extras* this)
+{
+    this->dtor(this);
+    SlabCache_free(&Slab_global_get()->sBpBinderExtras, this);
+}
+
 static void PrivateAccessor_dtor(PrivateAccessor* this)
 {
 }
@@ -176,19 +211,64 @@ static int32_t BpBinder_getDebugBinderHandle(BpBinder* this)
     return this->binderHandle(this);
 }
 
+static void BpBinder_markDead(BpBinder* this)
+{
+    atomic_store_explicit(&this->mDead, true, memory_order_release);
+}
+
+/* Fast path for calls on a proxy whose death is already known: no parcel,
+ * no IPCThreadState and no driver round trip.
+ */
+
+static bool BpBinder_failIfDead(BpBinder* this)
+{
+    if (!BpBinder_isKnownDead(this)) {
+        return false;
+    }
+
+    atomic_fetch_add_explicit(&BpBinder_global_get()->sDeadCallsAvoided, 1,
+        memory_order_relaxed);
+    return true;
+}
+
+uint32_t BpBinder_checkDead(IBinder* binder)
+{
+    BpBinder* proxy = binder ? binder->remoteBinder(binder) : NULL;
+
+    if (proxy != NULL && BpBinder_failIfDead(proxy)) {
+        return STATUS_DEAD_OBJECT;
+    }
+    return STATUS_OK;
+}
+
+unsigned long BpBinder_getDeadCallsAvoided(void)
+{
+    return atomic_load_explicit(&BpBinder_global_get()->sDeadCallsAvoided,
+        memory_order_relaxed);
+}
+
 static bool BpBinder_isDescriptorCached(BpBinder* this)
 {
+    BpBinder_Extras* e = atomic_load_explicit(&this->mExtras, memory_order_acquire);
     bool ret;
 
-    pthread_mutex_lock(&this->mLock);
-    ret = String_size(&this->mDescriptorCache) ? true : false;
-    pthread_mutex_unlock(&this->mLock);
+    if (e == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&e->mLock);
+    ret = String_size(&e->mDescriptorCache) ? true : false;
+    pthread_mutex_unlock(&e->mLock);
     return ret;
 }
 
 static String* BpBinder_getInterfaceDescriptor(BpBinder* this)
 {
-    if (this->isDescriptorCached(this) == false) {
+    BpBinder_Extras* e = this->getOrCreateExtras(this);
+
+    CHECK_FAIL(!e);
+
+    if (this->isDescriptorCached(this) == false && !BpBinder_failIfDead(this)) {
         this->incStrongRequireStrong(this, (void*)this);
         Parcel data;
         Parcel reply;
@@ -203,25 +283,30 @@ static String* BpBinder_getInterfaceDescriptor(BpBinder* this)
         if (err == STATUS_OK) {
             String res;
             String_init(&res, Parcel_readString16(&reply));
-            pthread_mutex_lock(&this->mLock);
-            if (String_size(&this->mDescriptorCache) == 0) {
-                String_dup(&this->mDescriptorCache, &res);
+            pthread_mutex_lock(&e->mLock);
+            if (String_size(&e->mDescriptorCache) == 0) {
+                String_dup(&e->mDescriptorCache, &res);
             }
-            pthread_mutex_unlock(&this->mLock);
+            pthread_mutex_unlock(&e->mLock);
         }
     }
 
-    return &this->mDescriptorCache;
+    return &e->mDescriptorCache;
 }
 
 static bool BpBinder_isBinderAlive(BpBinder* this)
 {
-    return this->mAlive != 0;
+    return !BpBinder_isKnownDead(this);
 }
 
 static uint32_t BpBinder_pingBinder(BpBinder* this)
 {
     Parcel data;
+
+    if (BpBinder_failIfDead(this)) {
+        return STATUS_DEAD_OBJECT;
+    }
+
     Parcel_initState(&data);
 
     this->incStrongRequireStrong(this, (void*)this);
@@ -235,9 +320,14 @@ static uint32_t BpBinder_dump(BpBinder* this, int fd, const VectorString* args)
 {
     Parcel send;
     Parcel reply;
+    String* str;
+
+    if (BpBinder_failIfDead(this)) {
+        return STATUS_DEAD_OBJECT;
+    }
+
     Parcel_initState(&send);
     Parcel_initState(&reply);
-    String* str;
 
     Parcel_writeFileDescriptor(&send, fd, false);
     const size_t numArgs = args->size(args);
@@ -257,7 +347,7 @@ static uint32_t BpBinder_transact(BpBinder* this, uint32_t code,
 
     /* Once a binder has died, it will never come back to life. */
 
-    if (this->mAlive) {
+    if (!BpBinder_failIfDead(this)) {
         /* don't send userspace flags to the kernel */
         flags = flags & ~(FLAG_PRIVATE_VENDOR);
 
@@ -266,16 +356,22 @@ static uint32_t BpBinder_transact(BpBinder* this, uint32_t code,
         status = self->transact(self, this->binderHandle(this), code, data, reply, flags);
 
         if (Parcel_dataSize(data) > LOG_TRANSACTIONS_OVER_SIZE) {
-            pthread_mutex_lock(&this->mLock);
+            BpBinder_Extras* e = atomic_load_explicit(&this->mExtras, memory_order_acquire);
+
+            if (e != NULL) {
+                pthread_mutex_lock(&e->mLock);
+            }
             BINDER_LOGD("Large outgoing transaction of %zu bytes, interface descriptor %s, code %" PRIu32 "",
                 Parcel_dataSize(data),
-                String_size(&this->mDescriptorCache) ? String_data(&this->mDescriptorCache) : "<uncached descriptor>",
+                e && String_size(&e->mDescriptorCache) ? String_data(&e->mDescriptorCache) : "<uncached descriptor>",
                 code);
-            pthread_mutex_unlock(&this->mLock);
+            if (e != NULL) {
+                pthread_mutex_unlock(&e->mLock);
+            }
         }
 
         if (status == STATUS_DEAD_OBJECT) {
-            this->mAlive = 0;
+            BpBinder_markDead(this);
         }
         return status;
     }
@@ -286,22 +382,35 @@ static uint32_t BpBinder_linkToDeath(BpBinder* this, DeathRecipient* recipient,
     void* cookie, uint32_t flags)
 {
     IPCThreadState* self = IPCThreadState_self();
+    SlabCache* cache = &Slab_global_get()->sObituary;
     RefBase_weakref* weakref;
-    Obituary ob;
-    ob.recipient = recipient;
-    ob.cookie = cookie;
-    ob.flags = flags;
+    BpBinder_Extras* e;
+    Obituary* ob;
 
     LOG_FATAL_IF(recipient == NULL,
         "linkToDeath(): recipient must be non-NULL");
 
-    pthread_mutex_lock(&this->mLock);
+    e = this->getOrCreateExtras(this);
+    if (e == NULL) {
+        return STATUS_NO_MEMORY;
+    }
 
-    if (!this->mObitsSent) {
-        if (!this->mObituaries) {
-            this->mObituaries = VectorImpl_new();
-            if (!this->mObituaries) {
-                pthread_mutex_unlock(&this->mLock);
+    ob = SlabCache_alloc(cache);
+    if (ob == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+    ob->recipient = recipient;
+    ob->cookie = cookie;
+    ob->flags = flags;
+
+    pthread_mutex_lock(&e->mLock);
+
+    if (!atomic_load(&this->mObitsSent)) {
+        if (!e->mObituaries) {
+            e->mObituaries = VectorImpl_new();
+            if (!e->mObituaries) {
+                pthread_mutex_unlock(&e->mLock);
+                SlabCache_free(cache, ob);
                 return STATUS_NO_MEMORY;
             }
             BINDER_LOGV("Requesting death notification: %p handle %" PRIi32 "\n",
@@ -312,11 +421,12 @@ static uint32_t BpBinder_linkToDeath(BpBinder* this, DeathRecipient* recipient,
             self->flushCommands(self);
         }
 
-        ssize_t res = this->mObituaries->add(this->mObituaries, &ob);
-        pthread_mutex_unlock(&this->mLock);
+        ssize_t res = e->mObituaries->add(e->mObituaries, ob);
+        pthread_mutex_unlock(&e->mLock);
         return res >= (ssize_t)STATUS_OK ? (uint32_t)STATUS_OK : res;
     }
-    pthread_mutex_unlock(&this->mLock);
+    pthread_mutex_unlock(&e->mLock);
+    SlabCache_free(cache, ob);
 
     return STATUS_DEAD_OBJECT;
 }
@@ -326,36 +436,44 @@ static uint32_t BpBinder_unlinkToDeath(BpBinder* this, DeathRecipient* recipient
     DeathRecipient** outRecipient)
 {
     IPCThreadState* self = IPCThreadState_self();
+    BpBinder_Extras* e = atomic_load_explicit(&this->mExtras, memory_order_acquire);
+
+    if (atomic_load(&this->mObitsSent)) {
+        return STATUS_DEAD_OBJECT;
+    }
+    if (e == NULL) {
+        return STATUS_NAME_NOT_FOUND;
+    }
 
-    pthread_mutex_lock(&this->mLock);
-    if (this->mObitsSent) {
-        pthread_mutex_unlock(&this->mLock);
+    pthread_mutex_lock(&e->mLock);
+    if (atomic_load(&this->mObitsSent)) {
+        pthread_mutex_unlock(&e->mLock);
         return STATUS_DEAD_OBJECT;
     }
 
-    const size_t N = this->mObituaries ? this->mObituaries->size(this->mObituaries) : 0;
+    const size_t N = e->mObituaries ? e->mObituaries->size(e->mObituaries) : 0;
     for (size_t i = 0; i < N; i++) {
-        Obituary* obit = this->mObituaries->get(this->mObituaries, i);
+        Obituary* obit = e->mObituaries->get(e->mObituaries, i);
         if ((obit->recipient == recipient || (recipient == NULL && obit->cookie == cookie))
             && obit->flags == flags) {
             if (outRecipient != NULL) {
                 *outRecipient = obit->recipient;
             }
-            obit = this->mObituaries->removeItemAt(this->mObituaries, i);
-            free(obit);
-            if (this->mObituaries->size(this->mObituaries) == 0) {
+            obit = e->mObituaries->removeItemAt(e->mObituaries, i);
+            SlabCache_free(&Slab_global_get()->sObituary, obit);
+            if (e->mObituaries->size(e->mObituaries) == 0) {
                 BINDER_LOGV("Clearing death notification: %p handle %" PRIi32 "\n",
                     this, this->binderHandle(this));
                 self->clearDeathNotification(self, this->binderHandle(this), this);
                 self->flushCommands(self);
-                VectorImpl_delete(this->mObituaries);
-                this->mObituaries = NULL;
+                VectorImpl_delete(e->mObituaries);
+                e->mObituaries = NULL;
             }
-            pthread_mutex_unlock(&this->mLock);
+            pthread_mutex_unlock(&e->mLock);
             return STATUS_OK;
         }
     }
-    pthread_mutex_unlock(&this->mLock);
+    pthread_mutex_unlock(&e->mLock);
 
     return STATUS_NAME_NOT_FOUND;
 }
@@ -364,77 +482,144 @@ static void* BpBinder_attachObject(BpBinder* this, const void* objectID,
     void* object, void* cleanupCookie,
     object_cleanup_func func)
 {
+    BpBinder_Extras* e = this->getOrCreateExtras(this);
     void* p_ret;
 
-    pthread_mutex_lock(&this->mLock);
+    CHECK_FAIL(!e);
+
+    pthread_mutex_lock(&e->mLock);
     BINDER_LOGV("Attaching object %p to binder %p (manager=%p)",
-        object, this, &this->mObjects);
-    p_ret = this->mObjects.attach(&this->mObjects, objectID, object,
+        object, this, &e->mObjects);
+    p_ret = e->mObjects.attach(&e->mObjects, objectID, object,
         cleanupCookie, func);
-    pthread_mutex_unlock(&this->mLock);
+    pthread_mutex_unlock(&e->mLock);
 
     return p_ret;
 }
 
 static void* BpBinder_findObject(BpBinder* this, const void* objectID)
 {
+    BpBinder_Extras* e = atomic_load_explicit(&this->mExtras, memory_order_acquire);
     void* p_ret;
 
-    pthread_mutex_lock(&this->mLock);
-    p_ret = this->mObjects.find(&this->mObjects, objectID);
-    pthread_mutex_unlock(&this->mLock);
+    if (!e) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&e->mLock);
+    p_ret = e->mObjects.find(&e->mObjects, objectID);
+    pthread_mutex_unlock(&e->mLock);
     return p_ret;
 }
 
 static void* BpBinder_detachObject(BpBinder* this, const void* objectID)
 {
+    BpBinder_Extras* e = atomic_load_explicit(&this->mExtras, memory_order_acquire);
     void* p_ret;
 
-    pthread_mutex_lock(&this->mLock);
-    p_ret = this->mObjects.detach(&this->mObjects, objectID);
-    pthread_mutex_unlock(&this->mLock);
+    if (!e) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&e->mLock);
+    p_ret = e->mObjects.detach(&e->mObjects, objectID);
+    pthread_mutex_unlock(&e->mLock);
     return p_ret;
 }
 
+static BpBinder_Extras* BpBinder_getOrCreateExtras(BpBinder* this)
+{
+    BpBinder_Extras* e = atomic_load_explicit(&this->mExtras, memory_order_acquire);
+    BpBinder_Extras* expected = NULL;
+
+    if (e) {
+        return e;
+    }
+
+    e = BpBinder_Extras_new();
+    if (e == NULL) {
+        return NULL; /* out of memory */
+    }
+
+    /* Another thread may have won the race; use its extras and drop ours */
+
+    if (!atomic_compare_exchange_strong(&this->mExtras, &expected, e)) {
+        BpBinder_Extras_delete(e);
+        e = expected;
+    }
+
+    return e;
+}
+
 BpBinder* BpBinder_remoteBinder(BpBinder* this)
 {
     return this;
 }
 
+void BpBinder_freeObituaries(VectorImpl* obits)
+{
+    SlabCache* cache = &Slab_global_get()->sObituary;
+
+    for (size_t i = 0; i < obits->size(obits); i++) {
+        SlabCache_free(cache, obits->get(obits, i));
+    }
+    VectorImpl_delete(obits);
+}
+
 static void BpBinder_sendObituary(BpBinder* this)
 {
+    BpBinder_Extras* e;
+    VectorImpl* obits = NULL;
+
     BINDER_LOGV("Sending obituary for proxy %p handle %" PRIi32 ", mObitsSent=%s\n",
         this, this->binderHandle(this),
-        this->mObitsSent ? "true" : "false");
-    this->mAlive = 0;
-    if (this->mObitsSent)
+        atomic_load(&this->mObitsSent) ? "true" : "false");
+    BpBinder_markDead(this);
+
+    /* mObitsSent is published before mExtras is read, and linkToDeath
+     * installs mExtras before reading mObitsSent, so a proxy without
+     * extras here can never gain an obituary that is not delivered.
+     */
+
+    if (atomic_exchange(&this->mObitsSent, 1))
         return;
 
-    pthread_mutex_lock(&this->mLock);
-    VectorImpl* obits = this->mObituaries;
-    if (obits != NULL) {
-        BINDER_LOGV("Clearing sent death notification: %p handle %" PRIi32 "\n",
-            this, this->binderHandle(this));
-        IPCThreadState* self = IPCThreadState_self();
-        self->clearDeathNotification(self, this->binderHandle(this), this);
-        self->flushCommands(self);
-        this->mObituaries = NULL;
+    e = atomic_load(&this->mExtras);
+    if (e != NULL) {
+        pthread_mutex_lock(&e->mLock);
+        obits = e->mObituaries;
+        if (obits != NULL) {
+            BINDER_LOGV("Clearing sent death notification: %p handle %" PRIi32 "\n",
+                this, this->binderHandle(this));
+            IPCThreadState* self = IPCThreadState_self();
+            self->clearDeathNotification(self, this->binderHandle(this), this);
+            self->flushCommands(self);
+            e->mObituaries = NULL;
+        }
+        pthread_mutex_unlock(&e->mLock);
     }
-    this->mObitsSent = 1;
-    pthread_mutex_unlock(&this->mLock);
 
-    BINDER_LOGV("Reporting death of proxy %p for %zu recipients\n",
-        this, obits ? obits->size(obits) : 0U);
+    /* Recipients run on the obituary executor, so the binder thread can
+     * acknowledge the death and go back to serving right away.
+     */
 
     if (obits != NULL) {
-        const size_t N = obits->size(obits);
-        for (size_t i = 0; i < N; i++) {
-            this->reportOneDeath(this, obits->get(obits, i));
-        }
-        VectorImpl_delete(obits);
+        ObituaryExecutor_post(this, obits);
     }
 }
 
+void BpBinder_deliverObituaries(BpBinder* this, VectorImpl* obits)
+{
+    const size_t N = obits->size(obits);
+
+    BINDER_LOGV("Reporting death of proxy %p for %zu recipients\n", this, N);
+
+    for (size_t i = 0; i < N; i++) {
+        this->reportOneDeath(this, obits->get(obits, i));
+    }
+    BpBinder_freeObituaries(obits);
+}
+
 static void BpBinder_reportOneDeath(BpBinder* this, const struct Obituary* obit)
 {
     RefBase* ref = &obit->recipient->m_refbase;
@@ -455,9 +640,206 @@ static void BpBinder_reportOneDeath(BpBinder* this, const struct Obituary* obit)
 
 static void BpBinder_withLock(BpBinder* this, withLockcallback doWithLock)
 {
-    pthread_mutex_lock(&this->mLock);
+    BpBinder_Extras* e = this->getOrCreateExtras(this);
+
+    CHECK_FAIL(!e);
+
+    pthread_mutex_lock(&e->mLock);
     doWithLock((IBinder*)this);
-    pthread_mutex_unlock(&this->mLock);
+    pthread_mutex_unlock(&e->mLock);
+}
+
+static BpBinder_UidCount* BpBinder_uidSlot(BpBinder_global* global, int32_t uid,
+    bool create)
+{
+    size_t i = ((uint32_t)uid * 2654435761u) & (BPBINDER_UID_SLOTS - 1);
+
+    for (size_t n = 0; n < BPBINDER_UID_SLOTS; n++) {
+        BpBinder_UidCount* slot = &global->sUidCounts[i];
+        int cur = atomic_load_explicit(&slot->mUid, memory_order_acquire);
+
+        if (cur == uid) {
+            return slot;
+        }
+        if (cur < 0) {
+            if (!create) {
+                return NULL;
+            }
+            if (atomic_compare_exchange_strong(&slot->mUid, &cur, uid)) {
+                atomic_fetch_add(&global->sNumTrackedUids, 1);
+                return slot;
+            }
+            if (cur == uid) {
+                return slot;
+            }
+        }
+        i = (i + 1) & (BPBINDER_UID_SLOTS - 1);
+    }
+    return NULL;
+}
+
+/* Count a new proxy for *uid. Returns false if creates from that uid are
+ * throttled; sets *uid to -1 if the table is full and the proxy can't be
+ * tracked.
+ */
+
+/* A limit callback waiting for its own short-lived thread, so the
+ * proxy creation that crossed the watermark does not wait for it.
+ */
+
+struct BpBinder_LimitCall {
+    binder_proxy_limit_callback mCallback;
+    int32_t mUid;
+};
+
+static void* BpBinder_limitCallThread(void* arg)
+{
+    struct BpBinder_LimitCall* call = arg;
+
+    call->mCallback(call->mUid);
+    free(call);
+    return NULL;
+}
+
+static void BpBinder_postLimitCallback(binder_proxy_limit_callback cb, int32_t uid)
+{
+    struct BpBinder_LimitCall* call = zalloc(sizeof(struct BpBinder_LimitCall));
+    pthread_attr_t attr;
+    pthread_t thread;
+    int ret = -1;
+
+    if (call != NULL) {
+        call->mCallback = cb;
+        call->mUid = uid;
+
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        pthread_attr_setstacksize(&attr, CONFIG_BINDER_LIB_THREAD_STACKSIZE);
+        ret = pthread_create(&thread, &attr, BpBinder_limitCallThread, call);
+        pthread_attr_destroy(&attr);
+        if (ret == 0) {
+            return;
+        }
+        free(call);
+    }
+
+    BINDER_LOGW("Can't start proxy limit callback of uid %" PRIi32 " (%d), calling inline\n",
+        uid, ret);
+    cb(uid);
+}
+
+static bool BpBinder_trackProxy(BpBinder_global* global, int32_t* uid)
+{
+    BpBinder_UidCount* slot = BpBinder_uidSlot(global, *uid, true);
+    uint32_t high = global->sBinderProxyCountHighWatermark;
+    bool throttle = global->sBinderProxyThrottleCreate;
+    uint32_t value;
+    uint32_t newValue;
+    uint32_t count;
+
+    if (slot == NULL) {
+        BINDER_LOGW("No proxy count slot left for uid %" PRIi32 "\n", *uid);
+        *uid = -1;
+        return true;
+    }
+
+    value = atomic_load_explicit(&slot->mValue, memory_order_relaxed);
+    do {
+        count = value & COUNTING_VALUE_MASK;
+        if ((value & LIMIT_REACHED_MASK) && throttle) {
+            return false;
+        }
+
+        newValue = value + 1;
+        if (!(value & LIMIT_REACHED_MASK) && count >= high) {
+            /* Crossing: the winner of this exchange owns the callback */
+
+            newValue = throttle ? (value | LIMIT_REACHED_MASK) : (newValue | LIMIT_REACHED_MASK);
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&slot->mValue, &value, newValue,
+        memory_order_relaxed, memory_order_relaxed));
+
+    if (!(value & LIMIT_REACHED_MASK) && (newValue & LIMIT_REACHED_MASK)) {
+        BINDER_LOGD("Too many binder proxy objects sent "
+                    "to uid %d from uid %" PRIi32 " (%" PRIu32 " proxies held)",
+            getuid(), *uid, count);
+        atomic_store_explicit(&slot->mLastLimitCallbackAt, count, memory_order_relaxed);
+        if (global->sLimitCallback) {
+            BpBinder_postLimitCallback(global->sLimitCallback, *uid);
+        }
+        if (throttle) {
+            BINDER_LOGD("Throttling binder proxy creates from "
+                        "uid %" PRIi32 " in uid %d until binder proxy count drops below %" PRIu32 "",
+                *uid, getuid(), global->sBinderProxyCountLowWatermark);
+            return false;
+        }
+    } else if (value & LIMIT_REACHED_MASK) {
+        uint32_t lastAt = atomic_load_explicit(&slot->mLastLimitCallbackAt, memory_order_relaxed);
+
+        if (count > lastAt && count - lastAt > high
+            && atomic_compare_exchange_strong_explicit(&slot->mLastLimitCallbackAt, &lastAt, count,
+                memory_order_relaxed, memory_order_relaxed)) {
+            BINDER_LOGD("Still too many binder proxy objects sent "
+                        "to uid %d from uid %" PRIi32 " (%" PRIu32 " proxies held)",
+                getuid(), *uid, count);
+            if (global->sLimitCallback) {
+                BpBinder_postLimitCallback(global->sLimitCallback, *uid);
+            }
+        }
+    }
+
+    return true;
+}
+
+static void BpBinder_untrackUid(BpBinder_global* global, int32_t uid)
+{
+    BpBinder_UidCount* slot = BpBinder_uidSlot(global, uid, false);
+    uint32_t low = global->sBinderProxyCountLowWatermark;
+    uint32_t value;
+    uint32_t newValue;
+    uint32_t count;
+
+    value = slot ? atomic_load_explicit(&slot->mValue, memory_order_relaxed) : 0;
+    do {
+        count = value & COUNTING_VALUE_MASK;
+        if (count == 0) {
+            BINDER_LOGE("Unexpected Binder Proxy tracking decrement for uid %" PRIi32 "\n", uid);
+            return;
+        }
+
+        newValue = value - 1;
+        if ((value & LIMIT_REACHED_MASK) && count <= low) {
+            newValue &= ~LIMIT_REACHED_MASK;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&slot->mValue, &value, newValue,
+        memory_order_relaxed, memory_order_relaxed));
+
+    if ((value & LIMIT_REACHED_MASK) && !(newValue & LIMIT_REACHED_MASK)) {
+        BINDER_LOGI("Limit reached bit reset for uid %d (fewer than %" PRIu32 " proxies from uid %" PRIi32 " held)",
+            getuid(), low, uid);
+        atomic_store_explicit(&slot->mLastLimitCallbackAt, 0, memory_order_relaxed);
+    }
+}
+
+static void BpBinder_untrackProxy(BpBinder* this)
+{
+    if (this->mTrackedUid >= 0 && atomic_exchange(&this->mCounted, false)) {
+        BpBinder_untrackUid(BpBinder_global_get(), this->mTrackedUid);
+    }
+}
+
+/* A proxy strongly held again after its last reference went counts
+ * again, but is never refused: it exists already.
+ */
+
+static void BpBinder_retrackProxy(BpBinder* this)
+{
+    int32_t uid = this->mTrackedUid;
+
+    if (uid >= 0 && !atomic_exchange(&this->mCounted, true)
+        && (!BpBinder_trackProxy(BpBinder_global_get(), &uid) || uid < 0)) {
+        atomic_store(&this->mCounted, false);
+    }
 }
 
 static void BpBinder_onFirstRef(BpBinder* this)
@@ -468,6 +850,7 @@ static void BpBinder_onFirstRef(BpBinder* this)
     if (self) {
         self->incStrongHandle(self, this->binderHandle(this), this);
     }
+    BpBinder_retrackProxy(this);
 }
 
 static void BpBinder_onLastStrongRef(BpBinder* this, const void* id)
@@ -479,21 +862,27 @@ static void BpBinder_onLastStrongRef(BpBinder* this, const void* id)
     if (self) {
         self->decStrongHandle(self, this->binderHandle(this));
     }
+    BpBinder_untrackProxy(this);
 
-    pthread_mutex_lock(&this->mLock);
-    VectorImpl* obits = this->mObituaries;
+    BpBinder_Extras* e = atomic_load_explicit(&this->mExtras, memory_order_acquire);
+    if (e == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&e->mLock);
+    VectorImpl* obits = e->mObituaries;
     if (obits != NULL) {
         if (!obits->isEmpty(obits)) {
             BINDER_LOGI("onLastStrongRef automatically unlinking death recipients: %s",
-                String_size(&this->mDescriptorCache) ? String_data(&this->mDescriptorCache) : "<uncached descriptor>");
+                String_size(&e->mDescriptorCache) ? String_data(&e->mDescriptorCache) : "<uncached descriptor>");
         }
 
         if (self) {
             self->clearDeathNotification(self, this->binderHandle(this), this);
         }
-        this->mObituaries = NULL;
+        e->mObituaries = NULL;
     }
-    pthread_mutex_unlock(&this->mLock);
+    pthread_mutex_unlock(&e->mLock);
 
     if (obits != NULL) {
         /* XXX Should we tell any remaining DeathRecipient
@@ -501,7 +890,7 @@ static void BpBinder_onLastStrongRef(BpBinder* this, const void* id)
          * are no longer linked?
          */
 
-        VectorImpl_delete(obits);
+        BpBinder_freeObituaries(obits);
     }
 }
 
@@ -610,48 +999,76 @@ BpBinder* BpBinder_Vfun_remoteBinder(IBinder* v_this)
     return this->remoteBinder(this);
 }
 
+void BpBinder_setCountByUidEnabled(bool enable)
+{
+    atomic_store(&BpBinder_global_get()->sCountByUidEnabled, enable);
+}
+
+void BpBinder_setLimitCallback(binder_proxy_limit_callback cb)
+{
+    BpBinder_global_get()->sLimitCallback = cb;
+}
+
+void BpBinder_setProxyCountWatermarks(uint32_t high, uint32_t low)
+{
+    BpBinder_global* global = BpBinder_global_get();
+
+    global->sBinderProxyCountHighWatermark = high;
+    global->sBinderProxyCountLowWatermark = low;
+}
+
+uint32_t BpBinder_getProxyCount(int32_t uid)
+{
+    BpBinder_UidCount* slot = BpBinder_uidSlot(BpBinder_global_get(), uid, false);
+
+    if (slot == NULL) {
+        return 0;
+    }
+    return atomic_load_explicit(&slot->mValue, memory_order_relaxed) & COUNTING_VALUE_MASK;
+}
+
+void BpBinder_dumpProxyCounts(int fd)
+{
+    BpBinder_global* global = BpBinder_global_get();
+
+    dprintf(fd, "Binder proxies by uid of process %d (%s, watermarks %" PRIu32 "/%" PRIu32 "):\n",
+        getpid(), atomic_load(&global->sCountByUidEnabled) ? "counting" : "not counting",
+        global->sBinderProxyCountHighWatermark, global->sBinderProxyCountLowWatermark);
+
+    for (size_t i = 0; i < BPBINDER_UID_SLOTS; i++) {
+        BpBinder_UidCount* slot = &global->sUidCounts[i];
+        int uid = atomic_load_explicit(&slot->mUid, memory_order_acquire);
+        uint32_t value = atomic_load_explicit(&slot->mValue, memory_order_relaxed);
+
+        if (uid < 0 || (value & COUNTING_VALUE_MASK) == 0) {
+            continue;
+        }
+        dprintf(fd, "  uid %6d: %6" PRIu32 " proxies%s\n", uid,
+            value & COUNTING_VALUE_MASK,
+            (value & LIMIT_REACHED_MASK) ? " (limit reached)" : "");
+    }
+}
+
 static void BpBinder_dtor(BpBinder* this)
 {
     IPCThreadState* self = IPCThreadState_self();
-    BpBinder_global* global = BpBinder_global_get();
-    uint32_t tempValue;
 
     BINDER_LOGV("Destroying BpBinder %p handle %" PRIi32 "\n",
         this, this->binderHandle(this));
 
-    if (this->mTrackedUid >= 0) {
-        pthread_mutex_lock(&global->sTrackingLock);
-        uint32_t trackedValue = global->sTrackingMap.get(&global->sTrackingMap, this->mTrackedUid);
-
-        if ((trackedValue & COUNTING_VALUE_MASK) == 0) {
-            BINDER_LOGE("Unexpected Binder Proxy tracking decrement in %p handle %" PRIi32 "\n", this,
-                this->binderHandle(this));
-        } else {
-            if ((trackedValue & LIMIT_REACHED_MASK) && ((trackedValue & COUNTING_VALUE_MASK) <= global->sBinderProxyCountLowWatermark)) {
-                BINDER_LOGI("Limit reached bit reset for uid %d (fewer than %" PRIu32 " proxies from uid %" PRIu32 " held)",
-                    getuid(), global->sBinderProxyCountLowWatermark, this->mTrackedUid);
-                tempValue = global->sTrackingMap.get(&global->sTrackingMap, this->mTrackedUid);
-                tempValue &= ~LIMIT_REACHED_MASK;
-                global->sTrackingMap.put(&global->sTrackingMap, this->mTrackedUid, tempValue);
-                global->sLastLimitCallbackMap.erase(&global->sLastLimitCallbackMap, this->mTrackedUid);
-            }
-            tempValue = global->sTrackingMap.get(&global->sTrackingMap, this->mTrackedUid);
-            if (--tempValue == 0) {
-                global->sTrackingMap.erase(&global->sTrackingMap, this->mTrackedUid);
-            } else {
-                global->sTrackingMap.put(&global->sTrackingMap, this->mTrackedUid, tempValue);
-            }
-        }
-        pthread_mutex_unlock(&global->sTrackingLock);
-    }
+    BpBinder_untrackProxy(this);
 
     if (self) {
         self->expungeHandle(self, this->binderHandle(this), (IBinder*)this);
         self->decWeakHandle(self, this->binderHandle(this));
     }
-    this->mObjects.dtor(&this->mObjects);
+    BpBinder_Extras* e = atomic_load_explicit(&this->mExtras, memory_order_relaxed);
+
+    if (e) {
+        BpBinder_Extras_delete(e);
+    }
+
     this->m_IBinder.dtor(&this->m_IBinder);
-    pthread_mutex_destroy(&this->mLock);
 }
 
 static void BpBinder_ctor(BpBinder* this, int32_t handle, int32_t trackedUid)
@@ -661,7 +1078,6 @@ static void BpBinder_ctor(BpBinder* this, int32_t handle, int32_t trackedUid)
     IPCThreadState* self = IPCThreadState_self();
 
     IBinder_ctor(&this->m_IBinder);
-    ObjectManager_ctor(&this->mObjects);
 
     /* Override IBinder virtual function */
     ibinder->isBinderAlive = BpBinder_Vfun_isBinderAlive;
@@ -708,14 +1124,15 @@ static void BpBinder_ctor(BpBinder* this, int32_t handle, int32_t trackedUid)
     this->isDescriptorCached = BpBinder_isDescriptorCached;
     this->withLock = BpBinder_withLock;
     this->getPrivateAccessor = BpBinder_getPrivateAccessor;
+    this->getOrCreateExtras = BpBinder_getOrCreateExtras;
 
-    pthread_mutex_init(&this->mLock, NULL);
     this->binder_handle = handle;
     this->mStability = 0;
-    this->mAlive = true;
-    this->mObitsSent = false;
-    this->mObituaries = NULL;
+    atomic_init(&this->mDead, false);
+    atomic_init(&this->mObitsSent, false);
+    atomic_init(&this->mExtras, NULL);
     this->mTrackedUid = trackedUid;
+    atomic_init(&this->mCounted, trackedUid >= 0);
     refbase->extendObjectLifetime(refbase, OBJECT_LIFETIME_WEAK);
 
     BINDER_LOGD("Creating BpBinder %p handle %" PRIi32 "\n", this, this->binderHandle(this));
@@ -726,15 +1143,27 @@ static void BpBinder_ctor(BpBinder* this, int32_t handle, int32_t trackedUid)
 void BpBinder_delete(BpBinder* this)
 {
     this->dtor(this);
-    free(this);
+    SlabCache_free(&Slab_global_get()->sBpBinder, this);
 }
 
 BpBinder* BpBinder_new(int32_t handle, int32_t trackedUid)
 {
+    SlabCache* cache = &Slab_global_get()->sBpBinder;
     BpBinder* this;
-    this = zalloc(sizeof(BpBinder));
+
+    this = SlabCache_alloc(cache);
+    if (this == NULL) {
+        return NULL;
+    }
 
     BpBinder_ctor(this, handle, trackedUid);
+
+    /* No destroy function: proxies stay alive once created. Unflattening
+     * hands out raw pointers that no caller releases, so the counts do not
+     * say when a proxy is unused. The owner of a proxy that never went out
+     * through getStrongProxyForHandle() may free it with BpBinder_delete().
+     */
+
     return this;
 }
 
@@ -742,57 +1171,19 @@ BpBinder* BpBinder_create(int32_t handle)
 {
     BpBinder_global* global = BpBinder_global_get();
     int32_t trackedUid = -1;
-    uint32_t tempValue;
 
-    if (global->sCountByUidEnabled) {
+    if (atomic_load_explicit(&global->sCountByUidEnabled, memory_order_relaxed)) {
         IPCThreadState* ts = IPCThreadState_self();
         trackedUid = ts->getCallingUid(ts);
-        pthread_mutex_lock(&global->sTrackingLock);
-        uint32_t trackedValue = global->sTrackingMap.get(&global->sTrackingMap, trackedUid);
-        if (trackedValue & LIMIT_REACHED_MASK) {
-            if (global->sBinderProxyThrottleCreate) {
-                pthread_mutex_unlock(&global->sTrackingLock);
-                return NULL;
-            }
-            trackedValue = trackedValue & COUNTING_VALUE_MASK;
-            uint32_t lastLimitCallbackAt = global->sLastLimitCallbackMap.get(&global->sLastLimitCallbackMap, trackedUid);
-
-            if ((trackedValue > lastLimitCallbackAt) && (trackedValue - lastLimitCallbackAt > global->sBinderProxyCountHighWatermark)) {
-                BINDER_LOGD("Still too many binder proxy objects sent "
-                            "to uid %d from uid %" PRIi32 " (%" PRIu32 " proxies held)",
-                    getuid(), trackedUid, trackedValue);
-                if (global->sLimitCallback) {
-                    global->sLimitCallback(trackedUid);
-                }
-                global->sLastLimitCallbackMap.put(&global->sLastLimitCallbackMap, trackedUid, trackedValue);
-            }
-        } else {
-            if ((trackedValue & COUNTING_VALUE_MASK) >= global->sBinderProxyCountHighWatermark) {
-                BINDER_LOGD("Too many binder proxy objects sent "
-                            "to uid %d from uid %" PRIi32 " (%" PRIu32 " proxies held)",
-                    getuid(), trackedUid, trackedValue);
-                tempValue = global->sTrackingMap.get(&global->sTrackingMap, trackedUid);
-                tempValue |= LIMIT_REACHED_MASK;
-                global->sTrackingMap.put(&global->sTrackingMap, trackedUid, tempValue);
-                if (global->sLimitCallback) {
-                    global->sLimitCallback(trackedUid);
-                }
-                global->sLastLimitCallbackMap.put(&global->sLastLimitCallbackMap,
-                    trackedUid, trackedValue & COUNTING_VALUE_MASK);
-                if (global->sBinderProxyThrottleCreate) {
-                    BINDER_LOGD("Throttling binder proxy creates from "
-                                "uid %" PRIi32 " in uid %d until binder proxy count drops below %" PRIu32 "",
-                        trackedUid, getuid(), global->sBinderProxyCountLowWatermark);
-                    pthread_mutex_unlock(&global->sTrackingLock);
-                    return NULL;
-                }
-            }
+        if (!BpBinder_trackProxy(global, &trackedUid)) {
+            return NULL;
         }
-        tempValue = global->sTrackingMap.get(&global->sTrackingMap, trackedUid);
-        tempValue++;
-        global->sTrackingMap.put(&global->sTrackingMap, trackedUid, tempValue);
-        pthread_mutex_unlock(&global->sTrackingLock);
     }
 
-    return BpBinder_new(handle, trackedUid);
+    BpBinder* proxy = BpBinder_new(handle, trackedUid);
+
+    if (proxy == NULL && trackedUid >= 0) {
+        BpBinder_untrackUid(global, trackedUid);
+    }
+    return proxy;
 }
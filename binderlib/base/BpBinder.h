@@ -18,6 +18,7 @@
 #define __BINDER_INCLUDE_BINDER_BPBINDER_H__
 
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 
 #include "IBinder.h"
@@ -71,6 +72,46 @@ struct Obituary {
 };
 typedef struct Obituary Obituary;
 
+/* State most proxies never touch: attached objects, death recipients and
+ * the cached interface descriptor. Allocated on first use, so a proxy that
+ * is only ever transacted on carries a single pointer for all of it.
+ */
+
+struct BpBinder_Extras;
+typedef struct BpBinder_Extras BpBinder_Extras;
+
+struct BpBinder_Extras {
+    void (*dtor)(BpBinder_Extras* this);
+
+    pthread_mutex_t mLock;
+    VectorImpl* mObituaries;
+    ObjectManager mObjects;
+    String mDescriptorCache;
+};
+
+typedef _Atomic(BpBinder_Extras*) Atomic_BpBinder_Extras_ptr;
+
+BpBinder_Extras* BpBinder_Extras_new(void);
+void BpBinder_Extras_delete(BpBinder_Extras* this);
+
+/* Slots of the per-UID proxy count table, must be a power of two */
+
+#define BPBINDER_UID_SLOTS 32
+
+/* Proxies held per sending UID when counting by UID is enabled. Slots are
+ * claimed with a compare-and-swap on mUid and never released, so creates
+ * and destroys only ever update mValue atomically.
+ */
+
+struct BpBinder_UidCount;
+typedef struct BpBinder_UidCount BpBinder_UidCount;
+
+struct BpBinder_UidCount {
+    atomic_int mUid; /* -1 while the slot is free */
+    atomic_uint mValue; /* Proxy count, bit 31 set above the high watermark */
+    atomic_uint mLastLimitCallbackAt;
+};
+
 struct BpBinder {
     struct IBinder m_IBinder;
 
@@ -113,16 +154,21 @@ struct BpBinder {
     bool (*isDescriptorCached)(BpBinder* this);
     void (*withLock)(BpBinder* this, withLockcallback doWithLock);
     PrivateAccessor* (*getPrivateAccessor)(BpBinder* this);
+    BpBinder_Extras* (*getOrCreateExtras)(BpBinder* this);
 
     int32_t binder_handle;
     int32_t mStability;
-    pthread_mutex_t mLock;
-    volatile int32_t mAlive;
-    volatile int32_t mObitsSent;
-    VectorImpl* mObituaries;
-    ObjectManager mObjects;
-    String mDescriptorCache;
+
+    /* Set once the death is seen (obituary or DEAD_OBJECT reply), never
+     * cleared: a dead handle does not come back, a new registration of the
+     * service arrives as another proxy.
+     */
+
+    atomic_bool mDead;
+    atomic_int mObitsSent;
     int32_t mTrackedUid;
+    atomic_bool mCounted; /* In the count of mTrackedUid, while held strongly */
+    Atomic_BpBinder_Extras_ptr mExtras;
 };
 
 BpBinder* BpBinder_new(int32_t handle, int32_t trackedUid);
@@ -130,4 +176,44 @@ void BpBinder_delete(BpBinder* this);
 
 BpBinder* BpBinder_create(int32_t handle);
 
+/* Return STATUS_DEAD_OBJECT, and count the call as avoided, if binder is a
+ * proxy whose remote is already known to be dead; STATUS_OK otherwise.
+ * Lets callers fail before building parcels or touching IPCThreadState.
+ */
+
+uint32_t BpBinder_checkDead(IBinder* binder);
+
+/* Per-UID proxy accounting. When enabled, BpBinder_create() counts new
+ * proxies by calling UID, and a proxy leaves the count when its last
+ * strong reference goes (proxies themselves are never freed). Crossing
+ * the high watermark runs the limit callback on a thread of its own
+ * (and throttles creates if configured), dropping to the low watermark
+ * re-arms it.
+ */
+
+void BpBinder_setCountByUidEnabled(bool enable);
+void BpBinder_setLimitCallback(binder_proxy_limit_callback cb);
+void BpBinder_setProxyCountWatermarks(uint32_t high, uint32_t low);
+uint32_t BpBinder_getProxyCount(int32_t uid);
+void BpBinder_dumpProxyCounts(int fd);
+
+/* Calls on known-dead proxies that never reached the driver */
+
+unsigned long BpBinder_getDeadCallsAvoided(void);
+
+static inline bool BpBinder_isKnownDead(BpBinder* this)
+{
+    return atomic_load_explicit(&this->mDead, memory_order_acquire);
+}
+
+/* Report the death of this proxy to the recipients in obits, then free
+ * them. Called by the obituary executor, obits is owned by the caller.
+ */
+
+void BpBinder_deliverObituaries(BpBinder* this, VectorImpl* obits);
+
+/* Free obits and the obituaries in it without reporting anything */
+
+void BpBinder_freeObituaries(VectorImpl* obits);
+
 #endif /* __BINDER_INCLUDE_BINDER_BPBINDER_H__ */
@@ -18,12 +18,14 @@
 
 #include <inttypes.h>
 #include <nuttx/tls.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include <android/binder_status.h>
 
 #include "AidlServiceManager.h"
 #include "BnServiceManager.h"
+#include "BpBinder.h"
 #include "BpServiceManager.h"
 #include "Parcel.h"
 #include "utils/Binderlog.h"
@@ -85,6 +87,11 @@ static void BpAIDLServiceManager_getService(BpAIDLServiceManager* this, String*
     Parcel_initState(&aidl_data);
     Parcel_initState(&aidl_reply);
 
+    aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
     Parcel_markForBinder(&aidl_data, this->remoteStrong(this));
 
     aidl_ret_status = Parcel_writeInterfaceToken(&aidl_data, this->getInterfaceDescriptor(this));
@@ -136,6 +143,11 @@ static void BpAIDLServiceManager_checkService(BpAIDLServiceManager* this, String
     Parcel_initState(&aidl_data);
     Parcel_initState(&aidl_reply);
 
+    aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
     Parcel_markForBinder(&aidl_data, this->remoteStrong(this));
 
     aidl_ret_status = Parcel_writeInterfaceToken(&aidl_data, this->getInterfaceDescriptor(this));
@@ -187,6 +199,11 @@ static void BpAIDLServiceManager_addService(BpAIDLServiceManager* this, String*
     Parcel_initState(&aidl_data);
     Parcel_initState(&aidl_reply);
 
+    aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
     Parcel_markForBinder(&aidl_data, this->remoteStrong(this));
 
     aidl_ret_status = Parcel_writeInterfaceToken(&aidl_data, this->getInterfaceDescriptor(this));
@@ -249,6 +266,11 @@ static void BpAIDLServiceManager_listServices(BpAIDLServiceManager* this, int32_
     Parcel_initState(&_aidl_data);
     Parcel_initState(&_aidl_reply);
 
+    _aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (_aidl_ret_status != STATUS_OK) {
+        goto _aidl_error;
+    }
+
     Parcel_markForBinder(&_aidl_data, this->remoteStrong(this));
 
     _aidl_ret_status = Parcel_writeInterfaceToken(&_aidl_data,
@@ -300,6 +322,11 @@ static void BpAIDLServiceManager_registerForNotifications(BpAIDLServiceManager*
     Parcel_initState(&_aidl_data);
     Parcel_initState(&_aidl_reply);
 
+    _aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (_aidl_ret_status != STATUS_OK) {
+        goto _aidl_error;
+    }
+
     Parcel_markForBinder(&_aidl_data, this->remoteStrong(this));
 
     _aidl_ret_status = Parcel_writeInterfaceToken(&_aidl_data,
@@ -351,6 +378,11 @@ static void BpAIDLServiceManager_unregisterForNotifications(BpAIDLServiceManager
     Parcel_initState(&_aidl_data);
     Parcel_initState(&_aidl_reply);
 
+    _aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (_aidl_ret_status != STATUS_OK) {
+        goto _aidl_error;
+    }
+
     Parcel_markForBinder(&_aidl_data, this->remoteStrong(this));
 
     _aidl_ret_status = Parcel_writeInterfaceToken(&_aidl_data,
@@ -403,6 +435,11 @@ static void BpAIDLServiceManager_isDeclared(BpAIDLServiceManager* this, String*
     Parcel_initState(&_aidl_data);
     Parcel_initState(&_aidl_reply);
 
+    _aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (_aidl_ret_status != STATUS_OK) {
+        goto _aidl_error;
+    }
+
     Parcel_markForBinder(&_aidl_data, this->remoteStrong(this));
 
     _aidl_ret_status = Parcel_writeInterfaceToken(&_aidl_data,
@@ -453,6 +490,11 @@ static void BpAIDLServiceManager_getDeclaredInstances(BpAIDLServiceManager* this
     Parcel_initState(&_aidl_data);
     Parcel_initState(&_aidl_reply);
 
+    _aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (_aidl_ret_status != STATUS_OK) {
+        goto _aidl_error;
+    }
+
     Parcel_markForBinder(&_aidl_data, this->remoteStrong(this));
 
     _aidl_ret_status = Parcel_writeInterfaceToken(&_aidl_data,
@@ -505,6 +547,11 @@ static void BpAIDLServiceManager_registerClientCallback(BpAIDLServiceManager* th
     Parcel_initState(&_aidl_data);
     Parcel_initState(&_aidl_reply);
 
+    _aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (_aidl_ret_status != STATUS_OK) {
+        goto _aidl_error;
+    }
+
     Parcel_markForBinder(&_aidl_data, this->remoteStrong(this));
 
     _aidl_ret_status = Parcel_writeInterfaceToken(&_aidl_data,
@@ -560,6 +607,11 @@ static void BpAIDLServiceManager_tryUnregisterService(BpAIDLServiceManager* this
     Parcel_initState(&_aidl_data);
     Parcel_initState(&_aidl_reply);
 
+    _aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (_aidl_ret_status != STATUS_OK) {
+        goto _aidl_error;
+    }
+
     Parcel_markForBinder(&_aidl_data, this->remoteStrong(this));
 
     _aidl_ret_status = Parcel_writeInterfaceToken(&_aidl_data,
@@ -600,17 +652,155 @@ _aidl_error:
     return;
 }
 
-static void BpAIDLServiceManager_getServiceDebugInfo(BpAIDLServiceManager* this, VectorString* _aidl_return,
-    Status* _aidl_status)
+static void BpAIDLServiceManager_getServices(BpAIDLServiceManager* this, VectorString* names,
+    VectorImpl* aidl_return, Status* aidl_status)
+{
+    Parcel aidl_data;
+    Parcel aidl_reply;
+    IBinder* ibinder;
+    int32_t aidl_ret_status = STATUS_OK;
+    int32_t count;
+
+    Parcel_initState(&aidl_data);
+    Parcel_initState(&aidl_reply);
+
+    aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
+    Parcel_markForBinder(&aidl_data, this->remoteStrong(this));
+
+    aidl_ret_status = Parcel_writeInterfaceToken(&aidl_data, this->getInterfaceDescriptor(this));
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_writeUtf8VectorAsUtf16Vector(&aidl_data, names);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
+    ibinder = this->remote(this);
+    aidl_ret_status = ibinder->transact(ibinder, BnServiceManager_TRANSACTION_getServices,
+        &aidl_data, &aidl_reply, 0);
+
+    if (aidl_ret_status == STATUS_UNKNOWN_TRANSACTION && IAIDLServiceManager_getDefaultImpl()) {
+        IAIDLServiceManager* Impl = IAIDLServiceManager_getDefaultImpl();
+        Impl->getServices(Impl, names, aidl_return, aidl_status);
+        return;
+    }
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Status_readFromParcel(aidl_status, &aidl_reply);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    if (aidl_status->mException != EX_NONE) {
+        return;
+    }
+
+    aidl_ret_status = Parcel_readInt32(&aidl_reply, &count);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    if (count != (int32_t)names->size(names)) {
+        aidl_ret_status = STATUS_BAD_VALUE;
+        goto aidl_error;
+    }
+    for (int32_t i = 0; i < count; i++) {
+        IBinder* binder = NULL;
+
+        aidl_ret_status = Parcel_readNullableStrongBinder(&aidl_reply, &binder);
+        if (aidl_ret_status != STATUS_OK) {
+            goto aidl_error;
+        }
+        aidl_return->push(aidl_return, binder);
+    }
+
+aidl_error:
+    Status_setFromStatusT(aidl_status, aidl_ret_status);
+    return;
+}
+
+static void BpAIDLServiceManager_listServicesPaged(BpAIDLServiceManager* this, int32_t dumpPriority,
+    String* startAfter, int32_t maxCount, VectorString* aidl_return, Status* aidl_status)
+{
+    Parcel aidl_data;
+    Parcel aidl_reply;
+    IBinder* ibinder;
+    int32_t aidl_ret_status = STATUS_OK;
+
+    Parcel_initState(&aidl_data);
+    Parcel_initState(&aidl_reply);
+
+    aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
+    Parcel_markForBinder(&aidl_data, this->remoteStrong(this));
+
+    aidl_ret_status = Parcel_writeInterfaceToken(&aidl_data, this->getInterfaceDescriptor(this));
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_writeInt32(&aidl_data, dumpPriority);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_writeString16(&aidl_data, startAfter);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_writeInt32(&aidl_data, maxCount);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
+    ibinder = this->remote(this);
+    aidl_ret_status = ibinder->transact(ibinder, BnServiceManager_TRANSACTION_listServicesPaged,
+        &aidl_data, &aidl_reply, 0);
+
+    if (aidl_ret_status == STATUS_UNKNOWN_TRANSACTION && IAIDLServiceManager_getDefaultImpl()) {
+        IAIDLServiceManager* Impl = IAIDLServiceManager_getDefaultImpl();
+        Impl->listServicesPaged(Impl, dumpPriority, startAfter, maxCount, aidl_return, aidl_status);
+        return;
+    }
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Status_readFromParcel(aidl_status, &aidl_reply);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    if (aidl_status->mException != EX_NONE) {
+        return;
+    }
+    aidl_ret_status = Parcel_readUtf8VectorFromUtf16Vector(&aidl_reply, aidl_return);
+
+aidl_error:
+    Status_setFromStatusT(aidl_status, aidl_ret_status);
+    return;
+}
+
+static void BpAIDLServiceManager_getServiceDebugInfoPaged(BpAIDLServiceManager* this, String* startAfter,
+    int32_t maxCount, VectorImpl* _aidl_return, Status* _aidl_status)
 {
     Parcel _aidl_data;
     Parcel _aidl_reply;
     IBinder* ibinder;
     int32_t _aidl_ret_status = STATUS_OK;
+    int32_t count;
 
     Parcel_initState(&_aidl_data);
     Parcel_initState(&_aidl_reply);
 
+    _aidl_ret_status = BpBinder_checkDead(this->remote(this));
+    if (_aidl_ret_status != STATUS_OK) {
+        goto _aidl_error;
+    }
+
     Parcel_markForBinder(&_aidl_data, this->remoteStrong(this));
 
     _aidl_ret_status = Parcel_writeInterfaceToken(&_aidl_data,
@@ -618,13 +808,21 @@ static void BpAIDLServiceManager_getServiceDebugInfo(BpAIDLServiceManager* this,
     if (_aidl_ret_status != STATUS_OK) {
         goto _aidl_error;
     }
+    _aidl_ret_status = Parcel_writeString16(&_aidl_data, startAfter);
+    if (_aidl_ret_status != STATUS_OK) {
+        goto _aidl_error;
+    }
+    _aidl_ret_status = Parcel_writeInt32(&_aidl_data, maxCount);
+    if (_aidl_ret_status != STATUS_OK) {
+        goto _aidl_error;
+    }
     ibinder = this->remote(this);
-    _aidl_ret_status = ibinder->transact(ibinder, BnServiceManager_TRANSACTION_getServiceDebugInfo,
+    _aidl_ret_status = ibinder->transact(ibinder, BnServiceManager_TRANSACTION_getServiceDebugInfoPaged,
         &_aidl_data, &_aidl_reply, 0);
 
     if (_aidl_ret_status == STATUS_UNKNOWN_TRANSACTION && IAIDLServiceManager_getDefaultImpl()) {
         IAIDLServiceManager* Impl = IAIDLServiceManager_getDefaultImpl();
-        Impl->getServiceDebugInfo(Impl, _aidl_return, _aidl_status);
+        Impl->getServiceDebugInfoPaged(Impl, startAfter, maxCount, _aidl_return, _aidl_status);
         return;
     }
     if (_aidl_ret_status != STATUS_OK) {
@@ -637,11 +835,40 @@ static void BpAIDLServiceManager_getServiceDebugInfo(BpAIDLServiceManager* this,
     if (_aidl_status->mException != EX_NONE) {
         return;
     }
-    //_aidl_ret_status = _aidl_reply.readParcelableVector(_aidl_return);
-    _aidl_ret_status = Parcel_readUtf8VectorFromUtf16Vector(&_aidl_reply, _aidl_return);
+
+    _aidl_ret_status = Parcel_readInt32(&_aidl_reply, &count);
     if (_aidl_ret_status != STATUS_OK) {
         goto _aidl_error;
     }
+    if (count < 0 || count > maxCount) {
+        _aidl_ret_status = STATUS_BAD_VALUE;
+        goto _aidl_error;
+    }
+    for (int32_t i = 0; i < count; i++) {
+        ServiceDebugInfo* info;
+        int32_t present;
+
+        _aidl_ret_status = Parcel_readInt32(&_aidl_reply, &present);
+        if (_aidl_ret_status != STATUS_OK) {
+            goto _aidl_error;
+        }
+        if (present == 0) {
+            _aidl_ret_status = STATUS_UNEXPECTED_NULL;
+            goto _aidl_error;
+        }
+
+        info = zalloc(sizeof(ServiceDebugInfo));
+        if (info == NULL) {
+            _aidl_ret_status = STATUS_NO_MEMORY;
+            goto _aidl_error;
+        }
+        _aidl_ret_status = ServiceDebugInfo_readFromParcel(info, &_aidl_reply);
+        if (_aidl_ret_status != STATUS_OK) {
+            free(info);
+            goto _aidl_error;
+        }
+        _aidl_return->push(_aidl_return, info);
+    }
 
 _aidl_error:
     Status_setFromStatusT(_aidl_status, _aidl_ret_status);
@@ -725,11 +952,25 @@ static void AIDLServiceManager_Vfun_tryUnregisterService(IAIDLServiceManager* v_
     this->tryUnregisterService(this, name, service, retStatus);
 }
 
-static void AIDLServiceManager_Vfun_getServiceDebugInfo(IAIDLServiceManager* v_this, VectorString* aidl_return,
-    Status* retStatus)
+static void AIDLServiceManager_Vfun_getServices(IAIDLServiceManager* v_this, VectorString* names,
+    VectorImpl* aidl_return, Status* retStatus)
+{
+    BpAIDLServiceManager* this = (BpAIDLServiceManager*)v_this;
+    this->getServices(this, names, aidl_return, retStatus);
+}
+
+static void AIDLServiceManager_Vfun_listServicesPaged(IAIDLServiceManager* v_this, int32_t dumpPriority,
+    String* startAfter, int32_t maxCount, VectorString* aidl_return, Status* retStatus)
+{
+    BpAIDLServiceManager* this = (BpAIDLServiceManager*)v_this;
+    this->listServicesPaged(this, dumpPriority, startAfter, maxCount, aidl_return, retStatus);
+}
+
+static void AIDLServiceManager_Vfun_getServiceDebugInfoPaged(IAIDLServiceManager* v_this, String* startAfter,
+    int32_t maxCount, VectorImpl* aidl_return, Status* retStatus)
 {
     BpAIDLServiceManager* this = (BpAIDLServiceManager*)v_this;
-    this->getServiceDebugInfo(this, aidl_return, retStatus);
+    this->getServiceDebugInfoPaged(this, startAfter, maxCount, aidl_return, retStatus);
 }
 
 static void BpAIDLServiceManager_dtor(BpAIDLServiceManager* this)
@@ -756,7 +997,9 @@ static void BpAIDLServiceManager_ctor(BpAIDLServiceManager* this, IBinder* impl)
     aidl->getDeclaredInstances = AIDLServiceManager_Vfun_getDeclaredInstances;
     aidl->registerClientCallback = AIDLServiceManager_Vfun_registerClientCallback;
     aidl->tryUnregisterService = AIDLServiceManager_Vfun_tryUnregisterService;
-    aidl->getServiceDebugInfo = AIDLServiceManager_Vfun_getServiceDebugInfo;
+    aidl->getServices = AIDLServiceManager_Vfun_getServices;
+    aidl->listServicesPaged = AIDLServiceManager_Vfun_listServicesPaged;
+    aidl->getServiceDebugInfoPaged = AIDLServiceManager_Vfun_getServiceDebugInfoPaged;
 
     /* Virtual Function for BpRefBase */
     this->remoteStrong = BpAIDLServiceManager_remoteStrong;
@@ -774,7 +1017,9 @@ static void BpAIDLServiceManager_ctor(BpAIDLServiceManager* this, IBinder* impl)
     this->getDeclaredInstances = BpAIDLServiceManager_getDeclaredInstances;
     this->registerClientCallback = BpAIDLServiceManager_registerClientCallback;
     this->tryUnregisterService = BpAIDLServiceManager_tryUnregisterService;
-    this->getServiceDebugInfo = BpAIDLServiceManager_getServiceDebugInfo;
+    this->getServices = BpAIDLServiceManager_getServices;
+    this->listServicesPaged = BpAIDLServiceManager_listServicesPaged;
+    this->getServiceDebugInfoPaged = BpAIDLServiceManager_getServiceDebugInfoPaged;
 
     this->dtor = BpAIDLServiceManager_dtor;
 }
@@ -64,7 +64,11 @@ struct BpAIDLServiceManager {
     void (*registerClientCallback)(BpAIDLServiceManager* this, String* name, const IBinder* service,
         const IClientCallback* callback, Status* retStatus);
     void (*tryUnregisterService)(BpAIDLServiceManager* this, String* name, IBinder* service, Status* retStatus);
-    void (*getServiceDebugInfo)(BpAIDLServiceManager* this, VectorString* aidl_return, Status* retStatus);
+    void (*getServices)(BpAIDLServiceManager* this, VectorString* names, VectorImpl* aidl_return, Status* retStatus);
+    void (*listServicesPaged)(BpAIDLServiceManager* this, int32_t dumpPriority, String* startAfter,
+        int32_t maxCount, VectorString* aidl_return, Status* retStatus);
+    void (*getServiceDebugInfoPaged)(BpAIDLServiceManager* this, String* startAfter, int32_t maxCount,
+        VectorImpl* aidl_return, Status* retStatus);
 };
 
 BpAIDLServiceManager* BpAIDLServiceManager_new(IBinder* impl);
@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "IClientCallback"
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <android/binder_status.h>
+
+#include "BpBinder.h"
+#include "IClientCallback.h"
+#include "Parcel.h"
+#include "utils/Binderlog.h"
+
+/****************************************************************************
+ * IClientCallback
+ ****************************************************************************/
+
+static String* IClientCallback_getInterfaceDescriptor(IClientCallback* this)
+{
+    return &this->descriptor;
+}
+
+static void IClientCallback_dtor(IClientCallback* this)
+{
+    this->m_iface.dtor(&this->m_iface);
+}
+
+void IClientCallback_ctor(IClientCallback* this)
+{
+    IInterface_ctor(&this->m_iface);
+    String_init(&this->descriptor, "android.os.IClientCallback");
+
+    this->getInterfaceDescriptor = IClientCallback_getInterfaceDescriptor;
+
+    this->dtor = IClientCallback_dtor;
+}
+
+/****************************************************************************
+ * BnClientCallback
+ ****************************************************************************/
+
+static IInterface* BnInterface_IClientCallback_queryLocalInterface(
+    BnInterface_IClientCallback* this,
+    const String* _descriptor)
+{
+    IInterface* iface = (&this->m_IClientCallback.m_iface);
+    if (String_cmp(_descriptor, this->getInterfaceDescriptor(this)) == 0) {
+        iface->incStrongRequireStrong(iface, (void*)this);
+        return iface;
+    }
+    return NULL;
+}
+
+static String* BnInterface_IClientCallback_getInterfaceDescriptor(BnInterface_IClientCallback* this)
+{
+    IClientCallback* iface = (&this->m_IClientCallback);
+    return iface->getInterfaceDescriptor(iface);
+}
+
+static IBinder* BnInterface_IClientCallback_onAsBinder(BnInterface_IClientCallback* this)
+{
+    return (IBinder*)this;
+}
+
+static String* BnInterface_IClientCallback_Vfun_getInterfaceDescriptor(IBinder* v_this)
+{
+    BnInterface_IClientCallback* this = (BnInterface_IClientCallback*)v_this;
+    return this->getInterfaceDescriptor(this);
+}
+
+static IInterface* BnInterface_IClientCallback_Vfun_queryLocalInterface(IBinder* v_this,
+    String* descriptor)
+{
+    BnInterface_IClientCallback* this = (BnInterface_IClientCallback*)v_this;
+    return this->queryLocalInterface(this, descriptor);
+}
+
+static void BnInterface_IClientCallback_dtor(BnInterface_IClientCallback* this)
+{
+    this->m_IClientCallback.dtor(&this->m_IClientCallback);
+    this->m_BBinder.dtor(&this->m_BBinder);
+}
+
+void BnInterface_IClientCallback_ctor(BnInterface_IClientCallback* this)
+{
+    IBinder* ibinder = &this->m_BBinder.m_IBinder;
+    IClientCallback_ctor(&this->m_IClientCallback);
+    BBinder_ctor(&this->m_BBinder);
+
+    /* Override Pure Virtual function in IBinder */
+    ibinder->getInterfaceDescriptor = BnInterface_IClientCallback_Vfun_getInterfaceDescriptor;
+    ibinder->queryLocalInterface = BnInterface_IClientCallback_Vfun_queryLocalInterface;
+
+    this->queryLocalInterface = BnInterface_IClientCallback_queryLocalInterface;
+    this->getInterfaceDescriptor = BnInterface_IClientCallback_getInterfaceDescriptor;
+    this->onAsBinder = BnInterface_IClientCallback_onAsBinder;
+
+    this->dtor = BnInterface_IClientCallback_dtor;
+}
+
+static uint32_t BnClientCallback_onTransact(BnClientCallback* this, uint32_t aidl_code,
+    const Parcel* aidl_data, Parcel* aidl_reply,
+    uint32_t aidl_flags)
+{
+    IClientCallback* iface = &this->m_BnIClientCallback.m_IClientCallback;
+    BBinder* bbinder = &this->m_BnIClientCallback.m_BBinder;
+    int32_t aidl_ret_status = STATUS_OK;
+    ParcelCursor cursor;
+    Parcel* data;
+
+    if (aidl_code != BnClientCallback_TRANSACTION_onClients) {
+        return BBinder_onTransact(bbinder, aidl_code, aidl_data, aidl_reply, aidl_flags);
+    }
+
+    data = ParcelCursor_begin(&cursor, aidl_data);
+
+    IBinder* in_registered;
+    bool in_hasClients;
+
+    if (!(Parcel_checkInterface(data, (IBinder*)this))) {
+        aidl_ret_status = STATUS_BAD_TYPE;
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_readStrongBinder(data, &in_registered);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_readBool(data, &in_hasClients);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
+    /* oneway, nothing is written back to the caller */
+
+    iface->onClients(this, in_registered, in_hasClients);
+
+aidl_error:
+    ParcelCursor_end(&cursor);
+    return aidl_ret_status;
+}
+
+static uint32_t BnClientCallback_Vfun_onTransact(BBinder* v_this, uint32_t code, const Parcel* data,
+    Parcel* reply, uint32_t flags)
+{
+    BnClientCallback* this = (BnClientCallback*)v_this;
+    return this->onTransact(this, code, data, reply, flags);
+}
+
+static void BnClientCallback_dtor(BnClientCallback* this)
+{
+    this->m_BnIClientCallback.dtor(&this->m_BnIClientCallback);
+}
+
+void BnClientCallback_ctor(BnClientCallback* this)
+{
+    BBinder* bbinder = &(this->m_BnIClientCallback.m_BBinder);
+    BnInterface_IClientCallback_ctor(&this->m_BnIClientCallback);
+
+    /* Virtual function override at BBinder */
+    bbinder->onTransact = BnClientCallback_Vfun_onTransact;
+
+    this->onTransact = BnClientCallback_onTransact;
+
+    this->dtor = BnClientCallback_dtor;
+}
+
+/****************************************************************************
+ * BpClientCallback
+ ****************************************************************************/
+
+static IBinder* BpInterface_IClientCallback_onAsBinder(BpInterface_IClientCallback* this)
+{
+    BpRefBase* pRefBase = &this->m_BpRefBase;
+    return pRefBase->remote(pRefBase);
+}
+
+static void BpInterface_IClientCallback_dtor(BpInterface_IClientCallback* this)
+{
+    this->m_IClientCallback.dtor(&this->m_IClientCallback);
+    this->m_BpRefBase.dtor(&this->m_BpRefBase);
+}
+
+void BpInterface_IClientCallback_ctor(BpInterface_IClientCallback* this,
+    IBinder* remote)
+{
+    BpRefBase_ctor(&this->m_BpRefBase, remote);
+    IClientCallback_ctor(&this->m_IClientCallback);
+
+    this->onAsBinder = BpInterface_IClientCallback_onAsBinder;
+
+    this->dtor = BpInterface_IClientCallback_dtor;
+}
+
+static uint32_t BpClientCallback_onClients(BpClientCallback* this, IBinder* registered,
+    bool hasClients)
+{
+    BpInterface_IClientCallback* bp = &this->m_BpIClientCallback;
+    IClientCallback* iface = &bp->m_IClientCallback;
+    IBinder* remote = bp->m_BpRefBase.remote(&bp->m_BpRefBase);
+    Parcel aidl_data;
+    int32_t aidl_ret_status;
+
+    Parcel_initState(&aidl_data);
+
+    aidl_ret_status = BpBinder_checkDead(remote);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
+    Parcel_markForBinder(&aidl_data, remote);
+
+    aidl_ret_status = Parcel_writeInterfaceToken(&aidl_data, iface->getInterfaceDescriptor(iface));
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_writeStrongBinder(&aidl_data, registered);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_writeBool(&aidl_data, hasClients);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
+    /* oneway, servicemanager sends it from its single looper thread */
+
+    aidl_ret_status = remote->transact(remote, BnClientCallback_TRANSACTION_onClients,
+        &aidl_data, NULL, FLAG_ONEWAY);
+
+aidl_error:
+    Parcel_freeData(&aidl_data);
+    return aidl_ret_status;
+}
+
+static void BpClientCallback_dtor(BpClientCallback* this)
+{
+    this->m_BpIClientCallback.dtor(&this->m_BpIClientCallback);
+}
+
+static void BpClientCallback_ctor(BpClientCallback* this, IBinder* impl)
+{
+    BpInterface_IClientCallback_ctor(&this->m_BpIClientCallback, impl);
+
+    this->onClients = BpClientCallback_onClients;
+
+    this->dtor = BpClientCallback_dtor;
+}
+
+BpClientCallback* BpClientCallback_new(IBinder* impl)
+{
+    BpClientCallback* this;
+    this = zalloc(sizeof(BpClientCallback));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    BpClientCallback_ctor(this, impl);
+    return this;
+}
+
+void BpClientCallback_delete(BpClientCallback* this)
+{
+    this->dtor(this);
+    free(this);
+}
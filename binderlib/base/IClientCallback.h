@@ -30,9 +30,14 @@
  ****************************************************************************/
 
 /****************************************************************************
- * IServiceCallback
+ * IClientCallback
  ****************************************************************************/
 
+/* Like IServiceCallback, IAIDLServiceManager registerClientCallback
+ * marshals the callback with Parcel_writeStrongBinder(), so callers pass
+ * the IBinder of their BnClientCallback.
+ */
+
 struct IClientCallback;
 typedef struct IClientCallback IClientCallback;
 
@@ -63,8 +68,8 @@ struct BnInterface_IClientCallback;
 typedef struct BnInterface_IClientCallback BnInterface_IClientCallback;
 
 struct BnInterface_IClientCallback {
-    IClientCallback m_IClientCallback;
     BBinder m_BBinder;
+    IClientCallback m_IClientCallback;
 
     void (*dtor)(BnInterface_IClientCallback* this);
 
@@ -109,7 +114,7 @@ struct BpInterface_IClientCallback {
 
     void (*dtor)(BpInterface_IClientCallback* this);
 
-    IBinder* (*onAsBinder)(BnInterface_IClientCallback* this);
+    IBinder* (*onAsBinder)(BpInterface_IClientCallback* this);
 };
 
 void BpInterface_IClientCallback_ctor(BpInterface_IClientCallback* this,
@@ -129,5 +134,6 @@ struct BpClientCallback {
 };
 
 BpClientCallback* BpClientCallback_new(IBinder* impl);
+void BpClientCallback_delete(BpClientCallback* this);
 
 #endif /* __BINDER_INCLUDE_BINDER_ICLIENTCALLBACK_H__ */
@@ -33,6 +33,16 @@ IBinder* IInterface_onAsBinder(IInterface* iface)
     return ibinder;
 }
 
+IInterface* IInterface_queryLocal(IBinder* obj, String* descriptor)
+{
+    /* A proxy never implements an interface in this process */
+
+    if (obj == NULL || obj->localBinder(obj) == NULL) {
+        return NULL;
+    }
+    return obj->queryLocalInterface(obj, descriptor);
+}
+
 void IInterface_incStrongRequireStrong(IInterface* this, const void* id)
 {
     this->m_refbase.incStrongRequireStrong(&this->m_refbase, id);
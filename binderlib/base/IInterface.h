@@ -46,6 +46,14 @@ struct IInterface {
 
 IBinder* IInterface_asBinder(IInterface* iface);
 
+/* Return the object implementing descriptor if obj is an in-process
+ * BBinder that implements it, with a strong reference taken; NULL for
+ * proxies and for local binders of another interface. Calls through the
+ * returned interface go straight to the implementation, no Parcel.
+ */
+
+IInterface* IInterface_queryLocal(IBinder* obj, String* descriptor);
+
 void IInterface_ctor(IInterface* this);
 
 /**
@@ -54,6 +62,9 @@ void IInterface_ctor(IInterface* this);
  * return a proxy to the interface without checking the interface descriptor.
  * This means that subsequent calls may fail with BAD_TYPE.
  *
+ * In C, INTERFACE_asInterface() does the local lookup with
+ * IInterface_queryLocal() before falling back to its Bp proxy.
+ *
  * C++ template define
  * template<typename INTERFACE>
  * inline sp<INTERFACE> interface_cast(const sp<IBinder>& obj)
@@ -62,12 +73,7 @@ void IInterface_ctor(IInterface* this);
  * }
  */
 
-#define interface_cast(INTERFACE, obj)            \
-    ({                                            \
-#INTERFACE* __cast_val;                   \
-        __cast_val = #INTERFACE##asInterface(obj) \
-            __cast_val;                           \
-    })
+#define interface_cast(INTERFACE, obj) INTERFACE##_asInterface(obj)
 
 /**
  * This is the same as interface_cast, except that it always checks to make sure
@@ -86,16 +92,17 @@ void IInterface_ctor(IInterface* this);
  * }
  */
 
-#define checked_interface_cast(INTERFACE, obj)             \
-    ({                                                     \
-#INTERFACE* __checked_val;                         \
-        String* __str1 = obj->getInterfaceDescriptor(obj); \
-        String* __str2 = &(I##INTERFACE##__descriptor);    \
-        if (String_cmp(__str1, __str2) != 0) {             \
-            return NULL;                                   \
-        }                                                  \
-        __checked_val = interface_cast(INTERFACE, obj)     \
-            __checked_val;                                 \
+#define checked_interface_cast(INTERFACE, obj)                              \
+    ({                                                                      \
+        IBinder* __checked_obj = (obj);                                     \
+        INTERFACE* __checked_val = NULL;                                    \
+        if (__checked_obj != NULL                                           \
+            && String_cmp(__checked_obj->getInterfaceDescriptor(__checked_obj), \
+                   INTERFACE##_getInterfaceDescriptor(NULL))                \
+                == 0) {                                                     \
+            __checked_val = interface_cast(INTERFACE, __checked_obj);       \
+        }                                                                   \
+        __checked_val;                                                      \
     })
 
 /* template<typename INTERFACE>
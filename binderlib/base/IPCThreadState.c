@@ -25,6 +25,7 @@
 #include <nuttx/android/binder.h>
 #include <nuttx/clock.h>
 #include <nuttx/tls.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sched.h>
 #include <signal.h>
@@ -44,6 +45,14 @@
 static const int64_t kWorkSourcePropagatedBitIndex = 32;
 static const int32_t kUnsetWorkSource = -1;
 
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+/* Same pointer as pthread_getspecific(mProcess->mTLS), without first going
+ * through ProcessState_self() to find the key.
+ */
+
+static _Thread_local IPCThreadState* gIPCThreadStateCache;
+#endif
+
 #ifdef CONFIG_BINDER_LIB_DEBUG
 static const char* statusToString(int32_t s)
 {
@@ -309,11 +318,11 @@ static int32_t IPCThreadState_getAndExecuteCommand(IPCThreadState* this)
 
 static void IPCThreadState_processPendingDerefs(IPCThreadState* this)
 {
-    if (Parcel_dataPosition(&this->mIn) >= Parcel_dataPosition(&this->mIn)) {
+    if (Parcel_dataPosition(&this->mIn) >= Parcel_dataSize(&this->mIn)) {
         /* The decWeak()/decStrong() calls may cause a destructor to run,
          * which in turn could have initiated an outgoing transaction,
          * which in turn could cause us to add to the pending refs
-         * vectors; so instead of simply iterating, loop until they're empty.
+         * queues; so instead of simply iterating, loop until they're empty.
          *
          * We do this in an outer loop, because calling decStrong()
          * may result in something being added to mPendingWeakDerefs,
@@ -321,22 +330,20 @@ static void IPCThreadState_processPendingDerefs(IPCThreadState* this)
          * from the driver if we don't process it now.
          */
 
-        while (this->mPendingWeakDerefs.size(&this->mPendingWeakDerefs) > 0 || this->mPendingStrongDerefs.size(&this->mPendingStrongDerefs) > 0) {
-            while (this->mPendingWeakDerefs.size(&this->mPendingWeakDerefs) > 0) {
-                RefBase_weakref* refs = this->mPendingWeakDerefs.get(&this->mPendingWeakDerefs, 0);
-                this->mPendingWeakDerefs.removeAt(&this->mPendingWeakDerefs, 0);
+        while (!RingBuffer_isEmpty(&this->mPendingWeakDerefs) || !RingBuffer_isEmpty(&this->mPendingStrongDerefs)) {
+            while (!RingBuffer_isEmpty(&this->mPendingWeakDerefs)) {
+                RefBase_weakref* refs = RingBuffer_pop(&this->mPendingWeakDerefs);
                 refs->decWeak(refs, (const void*)this->mProcess);
             }
 
-            if (this->mPendingStrongDerefs.size(&this->mPendingStrongDerefs) > 0) {
+            if (!RingBuffer_isEmpty(&this->mPendingStrongDerefs)) {
                 /* We don't use while() here because we don't want to re-order
                  * strong and weak decs at all; if this decStrong() causes both a
                  * decWeak() and a decStrong() to be queued, we want to process
                  * the decWeak() first.
                  */
 
-                BBinder* obj = this->mPendingStrongDerefs.get(&this->mPendingStrongDerefs, 0);
-                this->mPendingStrongDerefs.removeAt(&this->mPendingStrongDerefs, 0);
+                BBinder* obj = RingBuffer_pop(&this->mPendingStrongDerefs);
                 obj->decStrong(obj, (const void*)this->mProcess);
             }
         }
@@ -345,26 +352,83 @@ static void IPCThreadState_processPendingDerefs(IPCThreadState* this)
 
 static void IPCThreadState_processPostWriteDerefs(IPCThreadState* this)
 {
-    for (size_t i = 0; i < this->mPostWriteWeakDerefs.size(&this->mPostWriteWeakDerefs); i++) {
-        RefBase_weakref* refs = this->mPostWriteWeakDerefs.get(&this->mPostWriteWeakDerefs, i);
+    while (!RingBuffer_isEmpty(&this->mPostWriteWeakDerefs)) {
+        RefBase_weakref* refs = RingBuffer_pop(&this->mPostWriteWeakDerefs);
         refs->decWeak(refs, (const void*)this->mProcess);
     }
 
-    this->mPostWriteWeakDerefs.clear(&this->mPostWriteWeakDerefs);
-    for (size_t i = 0; i < this->mPostWriteStrongDerefs.size(&this->mPostWriteStrongDerefs); i++) {
-        RefBase* obj = this->mPostWriteStrongDerefs.get(&this->mPostWriteStrongDerefs, i);
+    while (!RingBuffer_isEmpty(&this->mPostWriteStrongDerefs)) {
+        RefBase* obj = RingBuffer_pop(&this->mPostWriteStrongDerefs);
         obj->decStrong(obj, (const void*)this->mProcess);
     }
-    this->mPostWriteStrongDerefs.clear(&this->mPostWriteStrongDerefs);
 }
 
+#if CONFIG_BINDER_LIB_THREAD_IDLE_TIMEOUT_MS > 0
+/* Wait up to the idle timeout for the driver to have work for this thread.
+ * Returns true when nothing arrived and the pool may shrink by one thread,
+ * in which case mCurrentThreads has already been decremented so that
+ * concurrently expiring threads can never take the pool below the floor.
+ */
+
+static bool IPCThreadState_retireIfIdle(IPCThreadState* this)
+{
+    ProcessState* proc = this->mProcess;
+    struct pollfd pfd;
+    bool retire = false;
+
+    /* Never block while there is still something to send or to consume */
+
+    if (Parcel_dataSize(&this->mOut) > 0
+        || Parcel_dataPosition(&this->mIn) < Parcel_dataSize(&this->mIn)) {
+        return false;
+    }
+
+    /* At the floor no thread can retire, skip the poll() */
+
+    pthread_mutex_lock(&proc->mThreadCountLock);
+    retire = proc->mCurrentThreads > CONFIG_BINDER_LIB_THREAD_POOL_MIN_THREADS;
+    pthread_mutex_unlock(&proc->mThreadCountLock);
+    if (!retire) {
+        return false;
+    }
+
+    pfd.fd = proc->mDriverFD;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, CONFIG_BINDER_LIB_THREAD_IDLE_TIMEOUT_MS) != 0) {
+        return false;
+    }
+
+    retire = false;
+
+    pthread_mutex_lock(&proc->mThreadCountLock);
+    if (proc->mCurrentThreads > CONFIG_BINDER_LIB_THREAD_POOL_MIN_THREADS) {
+        proc->mCurrentThreads--;
+        proc->mThreadPoolStats.threadsRetired++;
+        proc->mThreadPoolStats.reclaimedStackBytes += proc->mThreadStackSize;
+        retire = true;
+    }
+    pthread_mutex_unlock(&proc->mThreadCountLock);
+
+    return retire;
+}
+#endif
+
 static void IPCThreadState_joinThreadPool(IPCThreadState* this, bool isMain)
 {
+    ThreadPoolStats* stats = &this->mProcess->mThreadPoolStats;
+    int64_t joinTimeMs = uptimeMillis();
+    int64_t lifetimeMs;
+    bool retired = false;
+
     BINDER_LOGV("%s Thread %d is Joining the threadpool of Process %d\n",
         isMain ? "Main" : "Child", gettid(), getpid());
 
     pthread_mutex_lock(&this->mProcess->mThreadCountLock);
     this->mProcess->mCurrentThreads++;
+    if (this->mProcess->mCurrentThreads > stats->peakThreads) {
+        stats->peakThreads = this->mProcess->mCurrentThreads;
+    }
     pthread_mutex_unlock(&this->mProcess->mThreadCountLock);
     Parcel_writeInt32(&this->mOut, isMain ? BC_ENTER_LOOPER : BC_REGISTER_LOOPER);
 
@@ -372,6 +436,13 @@ static void IPCThreadState_joinThreadPool(IPCThreadState* this, bool isMain)
     int32_t result;
     do {
         this->processPendingDerefs(this);
+#if CONFIG_BINDER_LIB_THREAD_IDLE_TIMEOUT_MS > 0
+        if (!isMain && IPCThreadState_retireIfIdle(this)) {
+            retired = true;
+            result = STATUS_TIMED_OUT;
+            break;
+        }
+#endif
         /* now get the next command to be processed, waiting if necessary */
         result = this->getAndExecuteCommand(this);
         if (result < STATUS_OK && result != STATUS_TIMED_OUT && result != -ECONNREFUSED && result != -EBADF) {
@@ -393,13 +464,31 @@ static void IPCThreadState_joinThreadPool(IPCThreadState* this, bool isMain)
     Parcel_writeInt32(&this->mOut, BC_EXIT_LOOPER);
     this->mIsLooper = false;
     this->talkWithDriver(this, false);
+    lifetimeMs = uptimeMillis() - joinTimeMs;
     pthread_mutex_lock(&this->mProcess->mThreadCountLock);
-    LOG_FATAL_IF(this->mProcess->mCurrentThreads == 0,
-        "Threadpool thread count = 0. Thread cannot exist and exit in empty "
-        "threadpool\n"
-        "Misconfiguration. Increase threadpool max threads configuration\n");
-    this->mProcess->mCurrentThreads--;
+    if (!retired) {
+        LOG_FATAL_IF(this->mProcess->mCurrentThreads == 0,
+            "Threadpool thread count = 0. Thread cannot exist and exit in empty "
+            "threadpool\n"
+            "Misconfiguration. Increase threadpool max threads configuration\n");
+        this->mProcess->mCurrentThreads--;
+    }
+    stats->totalLifetimeMs += lifetimeMs;
+    if (lifetimeMs > stats->maxLifetimeMs) {
+        stats->maxLifetimeMs = lifetimeMs;
+    }
     pthread_mutex_unlock(&this->mProcess->mThreadCountLock);
+
+    if (retired) {
+        /* Pool threads are spawned on BR_SPAWN_LOOPER, and the driver
+         * stops asking once its requested_threads_started reaches the
+         * limit. Raise the limit by this thread so the pool can grow back.
+         */
+
+        this->mProcess->setThreadPoolMaxThreadCount(this->mProcess, this->mProcess->mMaxThreads);
+        BINDER_LOGI("Thread %d retired after %" PRId64 " ms idle timeout, lived %" PRId64 " ms\n",
+            gettid(), (int64_t)CONFIG_BINDER_LIB_THREAD_IDLE_TIMEOUT_MS, lifetimeMs);
+    }
 }
 
 static int32_t IPCThreadState_setupPolling(IPCThreadState* this, int* fd)
@@ -472,7 +561,9 @@ static void IPCThreadState_incStrongHandle(IPCThreadState* this, int32_t handle,
     if (!this->flushIfNeeded(this)) {
         /* Create a temp reference until the driver has handled this command.*/
         proxy->m_IBinder.m_refbase.incStrong(&proxy->m_IBinder.m_refbase, (const void*)this->mProcess);
-        this->mPostWriteStrongDerefs.push(&this->mPostWriteStrongDerefs, &proxy->m_IBinder.m_refbase);
+        if (RingBuffer_push(&this->mPostWriteStrongDerefs, &proxy->m_IBinder.m_refbase) < 0) {
+            BINDER_LOGE("Leaking temp strong reference on handle %" PRIi32 "\n", handle);
+        }
     }
 }
 
@@ -491,7 +582,9 @@ static void IPCThreadState_incWeakHandle(IPCThreadState* this, int32_t handle, B
         RefBase_weakref* weakref = proxy->m_IBinder.m_refbase.getWeakRefs(&proxy->m_IBinder.m_refbase);
         /* Create a temp reference until the driver has handled this command. */
         weakref->incWeak(weakref, (const void*)this->mProcess);
-        this->mPostWriteWeakDerefs.push(&this->mPostWriteWeakDerefs, weakref);
+        if (RingBuffer_push(&this->mPostWriteWeakDerefs, weakref) < 0) {
+            BINDER_LOGE("Leaking temp weak reference on handle %" PRIi32 "\n", handle);
+        }
     }
 }
 
@@ -841,7 +934,9 @@ static int32_t IPCThreadState_executeCommand(IPCThreadState* this,
             BINDER_LOGD("BR_RELEASE from driver on %p", obj);
             obj->printRefs(obj);
         }
-        this->mPendingStrongDerefs.push(&this->mPendingStrongDerefs, obj);
+        if (RingBuffer_push(&this->mPendingStrongDerefs, obj) < 0) {
+            BINDER_LOGE("BR_RELEASE: dropped decStrong of %p\n", obj);
+        }
         break;
     }
 
@@ -858,7 +953,9 @@ static int32_t IPCThreadState_executeCommand(IPCThreadState* this,
     case BR_DECREFS: {
         refs = (RefBase_weakref*)Parcel_readPointer(&this->mIn);
         obj = (BBinder*)Parcel_readPointer(&this->mIn);
-        this->mPendingWeakDerefs.push(&this->mPendingWeakDerefs, refs);
+        if (RingBuffer_push(&this->mPendingWeakDerefs, refs) < 0) {
+            BINDER_LOGE("BR_DECREFS: dropped decWeak of %p\n", refs);
+        }
         break;
     }
     case BR_ATTEMPT_ACQUIRE: {
@@ -1033,6 +1130,11 @@ void IPCThreadState_threadDestructor(void* st)
 {
     IPCThreadState* self = (IPCThreadState*)st;
 
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+    if (gIPCThreadStateCache == self) {
+        gIPCThreadStateCache = NULL;
+    }
+#endif
     if (self) {
         self->flushCommands(self);
         if (self->mProcess->mDriverFD >= 0) {
@@ -1065,21 +1167,25 @@ static void IPCThreadState_freeBuffer(Parcel* parcel, const uint8_t* data,
 
 static void IPCThreadState_dtor(IPCThreadState* this)
 {
-    this->mPendingStrongDerefs.dtor(&this->mPendingStrongDerefs);
-    this->mPendingWeakDerefs.dtor(&this->mPendingWeakDerefs);
-    this->mPostWriteStrongDerefs.dtor(&this->mPostWriteStrongDerefs);
-    this->mPostWriteWeakDerefs.dtor(&this->mPostWriteWeakDerefs);
+    RingBuffer_destroy(&this->mPendingStrongDerefs);
+    RingBuffer_destroy(&this->mPendingWeakDerefs);
+    RingBuffer_destroy(&this->mPostWriteStrongDerefs);
+    RingBuffer_destroy(&this->mPostWriteWeakDerefs);
+    Parcel_freeData(&this->mIn);
+    Parcel_freeData(&this->mOut);
 }
 
 static void IPCThreadState_ctor(IPCThreadState* this)
 {
-    VectorImpl_ctor(&this->mPendingStrongDerefs);
-    VectorImpl_ctor(&this->mPendingWeakDerefs);
-    VectorImpl_ctor(&this->mPostWriteStrongDerefs);
-    VectorImpl_ctor(&this->mPostWriteWeakDerefs);
+    RingBuffer_init(&this->mPendingStrongDerefs);
+    RingBuffer_init(&this->mPendingWeakDerefs);
+    RingBuffer_init(&this->mPostWriteStrongDerefs);
+    RingBuffer_init(&this->mPostWriteWeakDerefs);
 
     Parcel_initState(&this->mIn);
     Parcel_initState(&this->mOut);
+    Parcel_setPooled(&this->mIn, true);
+    Parcel_setPooled(&this->mOut, true);
 
     this->mProcess = ProcessState_self();
     this->mServingStackPointer = NULL;
@@ -1135,6 +1241,9 @@ static void IPCThreadState_ctor(IPCThreadState* this)
     this->setCallingWorkSourceUidWithoutPropagation = IPCThreadState_setCallingWorkSourceUidWithoutPropagation;
 
     pthread_setspecific(this->mProcess->mTLS, this);
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+    gIPCThreadStateCache = this;
+#endif
     this->clearCaller(this);
     Parcel_setDataCapacity(&this->mIn, 256);
     Parcel_setDataCapacity(&this->mOut, 256);
@@ -1160,6 +1269,13 @@ void IPCThreadState_delete(IPCThreadState* this)
 
 IPCThreadState* IPCThreadState_self(void)
 {
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+    IPCThreadState* cached = gIPCThreadStateCache;
+
+    if (cached && !atomic_load_explicit(&cached->mProcess->mShutdown, memory_order_relaxed)) {
+        return cached;
+    }
+#endif
     ProcessState* proc = ProcessState_self();
 
     /* Racey, heuristic test for simultaneous shutdown. */
@@ -1178,6 +1294,11 @@ IPCThreadState* IPCThreadState_self(void)
 
 IPCThreadState* IPCThreadState_selfOrNull(void)
 {
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+    if (gIPCThreadStateCache) {
+        return gIPCThreadStateCache;
+    }
+#endif
     ProcessState* proc = ProcessState_self();
 
     return (IPCThreadState*)pthread_getspecific(proc->mTLS);
@@ -30,6 +30,7 @@
 #include "IBinder.h"
 #include "Parcel.h"
 #include "ProcessState.h"
+#include "utils/RingBuffer.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -102,10 +103,10 @@ struct IPCThreadState {
     /* private data */
     ProcessState* mProcess;
 
-    VectorImpl mPendingStrongDerefs;
-    VectorImpl mPendingWeakDerefs;
-    VectorImpl mPostWriteStrongDerefs;
-    VectorImpl mPostWriteWeakDerefs;
+    RingBuffer mPendingStrongDerefs; /* BBinder* */
+    RingBuffer mPendingWeakDerefs; /* RefBase_weakref* */
+    RingBuffer mPostWriteStrongDerefs; /* RefBase* */
+    RingBuffer mPostWriteWeakDerefs; /* RefBase_weakref* */
 
     Parcel mIn;
     Parcel mOut;
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "IServiceCallback"
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <android/binder_status.h>
+
+#include "BpBinder.h"
+#include "IServiceCallback.h"
+#include "Parcel.h"
+#include "utils/Binderlog.h"
+
+/****************************************************************************
+ * IServiceCallback
+ ****************************************************************************/
+
+static String* IServiceCallback_getInterfaceDescriptor(IServiceCallback* this)
+{
+    return &this->descriptor;
+}
+
+static void IServiceCallback_dtor(IServiceCallback* this)
+{
+    this->m_iface.dtor(&this->m_iface);
+}
+
+void IServiceCallback_ctor(IServiceCallback* this)
+{
+    IInterface_ctor(&this->m_iface);
+    String_init(&this->descriptor, "android.os.IServiceCallback");
+
+    this->getInterfaceDescriptor = IServiceCallback_getInterfaceDescriptor;
+
+    this->dtor = IServiceCallback_dtor;
+}
+
+/****************************************************************************
+ * BnServiceCallback
+ ****************************************************************************/
+
+static IInterface* BnInterface_IServiceCallback_queryLocalInterface(
+    BnInterface_IServiceCallback* this,
+    const String* _descriptor)
+{
+    IInterface* iface = (&this->m_IServiceCallback.m_iface);
+    if (String_cmp(_descriptor, this->getInterfaceDescriptor(this)) == 0) {
+        iface->incStrongRequireStrong(iface, (void*)this);
+        return iface;
+    }
+    return NULL;
+}
+
+static String* BnInterface_IServiceCallback_getInterfaceDescriptor(BnInterface_IServiceCallback* this)
+{
+    IServiceCallback* iface = (&this->m_IServiceCallback);
+    return iface->getInterfaceDescriptor(iface);
+}
+
+static IBinder* BnInterface_IServiceCallback_onAsBinder(BnInterface_IServiceCallback* this)
+{
+    return (IBinder*)this;
+}
+
+static String* BnInterface_IServiceCallback_Vfun_getInterfaceDescriptor(IBinder* v_this)
+{
+    BnInterface_IServiceCallback* this = (BnInterface_IServiceCallback*)v_this;
+    return this->getInterfaceDescriptor(this);
+}
+
+static IInterface* BnInterface_IServiceCallback_Vfun_queryLocalInterface(IBinder* v_this,
+    String* descriptor)
+{
+    BnInterface_IServiceCallback* this = (BnInterface_IServiceCallback*)v_this;
+    return this->queryLocalInterface(this, descriptor);
+}
+
+static void BnInterface_IServiceCallback_dtor(BnInterface_IServiceCallback* this)
+{
+    this->m_IServiceCallback.dtor(&this->m_IServiceCallback);
+    this->m_BBinder.dtor(&this->m_BBinder);
+}
+
+void BnInterface_IServiceCallback_ctor(BnInterface_IServiceCallback* this)
+{
+    IBinder* ibinder = &this->m_BBinder.m_IBinder;
+    IServiceCallback_ctor(&this->m_IServiceCallback);
+    BBinder_ctor(&this->m_BBinder);
+
+    /* Override Pure Virtual function in IBinder */
+    ibinder->getInterfaceDescriptor = BnInterface_IServiceCallback_Vfun_getInterfaceDescriptor;
+    ibinder->queryLocalInterface = BnInterface_IServiceCallback_Vfun_queryLocalInterface;
+
+    this->queryLocalInterface = BnInterface_IServiceCallback_queryLocalInterface;
+    this->getInterfaceDescriptor = BnInterface_IServiceCallback_getInterfaceDescriptor;
+    this->onAsBinder = BnInterface_IServiceCallback_onAsBinder;
+
+    this->dtor = BnInterface_IServiceCallback_dtor;
+}
+
+static uint32_t BnServiceCallback_onTransact(BnServiceCallback* this, uint32_t aidl_code,
+    const Parcel* aidl_data, Parcel* aidl_reply,
+    uint32_t aidl_flags)
+{
+    IServiceCallback* iface = &this->m_BnIServiceCallback.m_IServiceCallback;
+    BBinder* bbinder = &this->m_BnIServiceCallback.m_BBinder;
+    int32_t aidl_ret_status = STATUS_OK;
+    ParcelCursor cursor;
+    Parcel* data;
+
+    if (aidl_code != BnServiceCallback_TRANSACTION_onRegistration) {
+        return BBinder_onTransact(bbinder, aidl_code, aidl_data, aidl_reply, aidl_flags);
+    }
+
+    data = ParcelCursor_begin(&cursor, aidl_data);
+
+    String in_name;
+    IBinder* in_binder;
+
+    String_init(&in_name, NULL);
+    if (!(Parcel_checkInterface(data, (IBinder*)this))) {
+        aidl_ret_status = STATUS_BAD_TYPE;
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_readString16_to(data, &in_name);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_readStrongBinder(data, &in_binder);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
+    /* oneway, nothing is written back to the caller */
+
+    iface->onRegistration(this, &in_name, in_binder);
+
+aidl_error:
+    ParcelCursor_end(&cursor);
+    return aidl_ret_status;
+}
+
+static uint32_t BnServiceCallback_Vfun_onTransact(BBinder* v_this, uint32_t code, const Parcel* data,
+    Parcel* reply, uint32_t flags)
+{
+    BnServiceCallback* this = (BnServiceCallback*)v_this;
+    return this->onTransact(this, code, data, reply, flags);
+}
+
+static void BnServiceCallback_dtor(BnServiceCallback* this)
+{
+    this->m_BnIServiceCallback.dtor(&this->m_BnIServiceCallback);
+}
+
+void BnServiceCallback_ctor(BnServiceCallback* this)
+{
+    BBinder* bbinder = &(this->m_BnIServiceCallback.m_BBinder);
+    BnInterface_IServiceCallback_ctor(&this->m_BnIServiceCallback);
+
+    /* Virtual function override at BBinder */
+    bbinder->onTransact = BnServiceCallback_Vfun_onTransact;
+
+    this->onTransact = BnServiceCallback_onTransact;
+
+    this->dtor = BnServiceCallback_dtor;
+}
+
+/****************************************************************************
+ * BpServiceCallback
+ ****************************************************************************/
+
+static IBinder* BpInterface_IServiceCallback_onAsBinder(BpInterface_IServiceCallback* this)
+{
+    BpRefBase* pRefBase = &this->m_BpRefBase;
+    return pRefBase->remote(pRefBase);
+}
+
+static void BpInterface_IServiceCallback_dtor(BpInterface_IServiceCallback* this)
+{
+    this->m_IServiceCallback.dtor(&this->m_IServiceCallback);
+    this->m_BpRefBase.dtor(&this->m_BpRefBase);
+}
+
+void BpInterface_IServiceCallback_ctor(BpInterface_IServiceCallback* this,
+    IBinder* remote)
+{
+    BpRefBase_ctor(&this->m_BpRefBase, remote);
+    IServiceCallback_ctor(&this->m_IServiceCallback);
+
+    this->onAsBinder = BpInterface_IServiceCallback_onAsBinder;
+
+    this->dtor = BpInterface_IServiceCallback_dtor;
+}
+
+static uint32_t BpServiceCallback_onRegistration(BpServiceCallback* this, const String* name,
+    IBinder* binder)
+{
+    BpInterface_IServiceCallback* bp = &this->m_BpIServiceCallback;
+    IServiceCallback* iface = &bp->m_IServiceCallback;
+    IBinder* remote = bp->m_BpRefBase.remote(&bp->m_BpRefBase);
+    Parcel aidl_data;
+    int32_t aidl_ret_status;
+
+    Parcel_initState(&aidl_data);
+
+    aidl_ret_status = BpBinder_checkDead(remote);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
+    Parcel_markForBinder(&aidl_data, remote);
+
+    aidl_ret_status = Parcel_writeInterfaceToken(&aidl_data, iface->getInterfaceDescriptor(iface));
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_writeString16(&aidl_data, (String*)name);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+    aidl_ret_status = Parcel_writeStrongBinder(&aidl_data, binder);
+    if (aidl_ret_status != STATUS_OK) {
+        goto aidl_error;
+    }
+
+    /* oneway, so a slow or stuck client never blocks the notifier */
+
+    aidl_ret_status = remote->transact(remote, BnServiceCallback_TRANSACTION_onRegistration,
+        &aidl_data, NULL, FLAG_ONEWAY);
+
+aidl_error:
+    Parcel_freeData(&aidl_data);
+    return aidl_ret_status;
+}
+
+static void BpServiceCallback_dtor(BpServiceCallback* this)
+{
+    this->m_BpIServiceCallback.dtor(&this->m_BpIServiceCallback);
+}
+
+static void BpServiceCallback_ctor(BpServiceCallback* this, IBinder* impl)
+{
+    BpInterface_IServiceCallback_ctor(&this->m_BpIServiceCallback, impl);
+
+    this->onRegistration = BpServiceCallback_onRegistration;
+
+    this->dtor = BpServiceCallback_dtor;
+}
+
+BpServiceCallback* BpServiceCallback_new(IBinder* impl)
+{
+    BpServiceCallback* this;
+    this = zalloc(sizeof(BpServiceCallback));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    BpServiceCallback_ctor(this, impl);
+    return this;
+}
+
+void BpServiceCallback_delete(BpServiceCallback* this)
+{
+    this->dtor(this);
+    free(this);
+}
@@ -33,6 +33,12 @@
  * IServiceCallback
  ****************************************************************************/
 
+/* IAIDLServiceManager register/unregisterForNotifications take the
+ * callback as an IServiceCallback* but marshal it with
+ * Parcel_writeStrongBinder(), so callers pass the IBinder of their
+ * BnServiceCallback, and the server side gets the IBinder it read back.
+ */
+
 struct IServiceCallback;
 typedef struct IServiceCallback IServiceCallback;
 
@@ -64,8 +70,8 @@ struct BnInterface_IServiceCallback;
 typedef struct BnInterface_IServiceCallback BnInterface_IServiceCallback;
 
 struct BnInterface_IServiceCallback {
-    IServiceCallback m_IServiceCallback;
     BBinder m_BBinder;
+    IServiceCallback m_IServiceCallback;
 
     void (*dtor)(BnInterface_IServiceCallback* this);
 
@@ -120,7 +126,7 @@ struct BpServiceCallback;
 typedef struct BpServiceCallback BpServiceCallback;
 
 struct BpServiceCallback {
-    BpInterface_IServiceCallback m_BpIClientCallback;
+    BpInterface_IServiceCallback m_BpIServiceCallback;
 
     void (*dtor)(BpServiceCallback* this);
 
@@ -130,5 +136,6 @@ struct BpServiceCallback {
 };
 
 BpServiceCallback* BpServiceCallback_new(IBinder* impl);
+void BpServiceCallback_delete(BpServiceCallback* this);
 
 #endif /* __BINDER_INCLUDE_BINDER_ISERVICECALLBACK_H__ */
@@ -16,13 +16,17 @@
 
 #define LOG_TAG "IServiceManager"
 
+#include <errno.h>
 #include <inttypes.h>
 #include <nuttx/tls.h>
+#include <pthread.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <android/binder_status.h>
 
 #include "BnServiceManager.h"
+#include "BpBinder.h"
 #include "BpServiceManager.h"
 #include "IPCThreadState.h"
 #include "IServiceCallback.h"
@@ -40,6 +44,9 @@
  * Public Types
  ****************************************************************************/
 
+struct ServiceManagerShim;
+typedef struct ServiceManagerShim ServiceManagerShim;
+
 struct RegistrationWaiter;
 typedef struct RegistrationWaiter RegistrationWaiter;
 
@@ -50,7 +57,20 @@ struct RegistrationWaiter {
     int32_t (*onRegistration)(RegistrationWaiter* this, const String* name,
         const IBinder* binder);
 
+    /* Wait up to timeoutMs for name to be announced, NULL on timeout */
+    IBinder* (*waitFor)(RegistrationWaiter* this, String* name, int64_t timeoutMs);
+
     LocalRegistrationCallback* mImpl;
+
+    /* Without mImpl, announced services wake the waitFor() callers */
+
+    pthread_mutex_t mLock;
+    pthread_cond_t mCond;
+    HashMap mArrived; /* name -> IBinder* */
+
+    /* Also keeps the lookup cache of this shim current */
+
+    ServiceManagerShim* mShim;
 };
 
 struct LocalRegistrationAndWaiter {
@@ -60,9 +80,6 @@ struct LocalRegistrationAndWaiter {
 
 typedef struct LocalRegistrationAndWaiter LocalRegistrationAndWaiter;
 
-struct ServiceManagerShim;
-typedef struct ServiceManagerShim ServiceManagerShim;
-
 struct ServiceManagerShim {
     IServiceManager m_IServiceManager;
 
@@ -83,9 +100,17 @@ struct ServiceManagerShim {
     int32_t (*unregisterForNotifications)(ServiceManagerShim* this, String* name,
         const LocalRegistrationCallback* callback);
     int32_t (*getServiceDebugInfo)(ServiceManagerShim* this, VectorImpl* infvector);
+    int32_t (*getServices)(ServiceManagerShim* this, VectorString* names, IBinder** services);
 
     /* Member function */
     int32_t (*realGetService)(ServiceManagerShim* this, String* name, IBinder** aidl_return);
+    IBinder* (*waitForServiceTimeout)(ServiceManagerShim* this, String* name, int64_t timeoutMs);
+    IBinder* (*pollService)(ServiceManagerShim* this, String* name, int64_t timeoutMs);
+    RegistrationWaiter* (*startWaiting)(ServiceManagerShim* this, String* name);
+    void (*stopWaiting)(ServiceManagerShim* this, String* name);
+    IBinder* (*lookupCachedService)(ServiceManagerShim* this, String* name);
+    void (*cacheService)(ServiceManagerShim* this, String* name, IBinder* binder);
+    void (*updateCachedService)(ServiceManagerShim* this, const String* name, IBinder* binder);
     void (*removeRegistrationCallbackLocked)(ServiceManagerShim* this, const LocalRegistrationCallback* cb,
         VectorImpl* it, RegistrationWaiter* waiter);
     String* (*getInterfaceDescriptor)(ServiceManagerShim* this);
@@ -95,6 +120,24 @@ struct ServiceManagerShim {
     IAIDLServiceManager* mTheRealServiceManager;
     HashMap mNameToRegistrationCallback;
     pthread_mutex_t mNameToRegistrationLock;
+
+    /* Shared by every waitForService() and the lookup cache of this
+     * process, registered once per watched name. Guarded by
+     * mNameToRegistrationLock.
+     */
+
+    RegistrationWaiter* mWaiter;
+    HashMap mNameToWaitCount;
+
+    /* name -> IBinder*, one weak reference each, so dropping an entry
+     * never takes away a strong reference a caller still relies on. A
+     * name stays once it is watched, with a NULL value after its service
+     * died. Deaths are seen on lookup through the proxy's dead flag,
+     * re-registrations arrive on mWaiter.
+     */
+
+    HashMap mServiceCache;
+    pthread_mutex_t mServiceCacheLock;
 };
 
 /****************************************************************************
@@ -128,25 +171,95 @@ static void IServiceManager_ctor(IServiceManager* this)
 static int32_t RegistrationWaiter_onRegistration(RegistrationWaiter* this, const String* name,
     const IBinder* binder)
 {
-    this->mImpl->onServiceRegistration(this->mImpl, name, binder);
+    if (this->mImpl != NULL) {
+        this->mImpl->onServiceRegistration(this->mImpl, name, binder);
+        return STATUS_OK;
+    }
+
+    pthread_mutex_lock(&this->mLock);
+    this->mArrived.put(&this->mArrived, (long)name, (long)binder);
+    pthread_cond_broadcast(&this->mCond);
+    pthread_mutex_unlock(&this->mLock);
+
+    this->mShim->updateCachedService(this->mShim, name, (IBinder*)binder);
     return STATUS_OK;
 }
 
+static IBinder* RegistrationWaiter_waitFor(RegistrationWaiter* this, String* name,
+    int64_t timeoutMs)
+{
+    IBinder* binder = NULL;
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (timeoutMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&this->mLock);
+    while (this->mArrived.find(&this->mArrived, (long)name, (long*)&binder) != STATUS_OK) {
+        if (pthread_cond_timedwait(&this->mCond, &this->mLock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&this->mLock);
+
+    return binder;
+}
+
+static int32_t RegistrationWaiter_Vfun_onRegistration(void* v_this, const String* name,
+    const IBinder* binder)
+{
+    RegistrationWaiter* this = (RegistrationWaiter*)v_this;
+    return this->onRegistration(this, name, binder);
+}
+
 static void RegistrationWaiter_dtor(RegistrationWaiter* this)
 {
+    this->mArrived.dtor(&this->mArrived);
+    pthread_cond_destroy(&this->mCond);
+    pthread_mutex_destroy(&this->mLock);
     this->m_BnServiceCallback.dtor(&this->m_BnServiceCallback);
 }
 
 void RegistrationWaiter_ctor(RegistrationWaiter* this, LocalRegistrationCallback* callback)
 {
+    IServiceCallback* iface = &this->m_BnServiceCallback.m_BnIServiceCallback.m_IServiceCallback;
+    pthread_condattr_t attr;
+
     BnServiceCallback_ctor(&this->m_BnServiceCallback);
 
     this->mImpl = callback;
+    pthread_mutex_init(&this->mLock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&this->mCond, &attr);
+    pthread_condattr_destroy(&attr);
+    HashMap_String_ctor(&this->mArrived);
+
+    /* Override Pure Virtual function in IServiceCallback */
+    iface->onRegistration = RegistrationWaiter_Vfun_onRegistration;
 
     this->onRegistration = RegistrationWaiter_onRegistration;
+    this->waitFor = RegistrationWaiter_waitFor;
     this->dtor = RegistrationWaiter_dtor;
 }
 
+static RegistrationWaiter* RegistrationWaiter_new(LocalRegistrationCallback* callback)
+{
+    RegistrationWaiter* this;
+    this = zalloc(sizeof(RegistrationWaiter));
+    if (this == NULL) {
+        return NULL;
+    }
+
+    RegistrationWaiter_ctor(this, callback);
+    return this;
+}
+
 /****************************************************************************
  * Function define for ServiceManagerShim
  ****************************************************************************/
@@ -176,12 +289,44 @@ static int32_t IServiceManager_Vfun_addService(IServiceManager* v_this, String*
     return this->addService(this, name, service, allowIsolated, dumpPriority);
 }
 
+static IBinder* IServiceManager_Vfun_waitForService(IServiceManager* v_this, String* name)
+{
+    ServiceManagerShim* this = (ServiceManagerShim*)v_this;
+    return this->waitForService(this, name);
+}
+
 static int32_t IServiceManager_Vfun_listServices(IServiceManager* v_this, int dumpsysPriority, VectorString* list)
 {
     ServiceManagerShim* this = (ServiceManagerShim*)v_this;
     return this->listServices(this, dumpsysPriority, list);
 }
 
+static bool IServiceManager_Vfun_isDeclared(IServiceManager* v_this, String* name)
+{
+    ServiceManagerShim* this = (ServiceManagerShim*)v_this;
+    return this->isDeclared(this, name);
+}
+
+static int32_t IServiceManager_Vfun_getDeclaredInstances(IServiceManager* v_this, String* interface,
+    VectorString* strvector)
+{
+    ServiceManagerShim* this = (ServiceManagerShim*)v_this;
+    return this->getDeclaredInstances(this, interface, strvector);
+}
+
+static int32_t IServiceManager_Vfun_getServiceDebugInfo(IServiceManager* v_this, VectorImpl* infvector)
+{
+    ServiceManagerShim* this = (ServiceManagerShim*)v_this;
+    return this->getServiceDebugInfo(this, infvector);
+}
+
+static int32_t IServiceManager_Vfun_getServices(IServiceManager* v_this, VectorString* names,
+    IBinder** services)
+{
+    ServiceManagerShim* this = (ServiceManagerShim*)v_this;
+    return this->getServices(this, names, services);
+}
+
 static String* ServiceManagerShim_getInterfaceDescriptor(ServiceManagerShim* this)
 {
     return this->mTheRealServiceManager->getInterfaceDescriptor(this->mTheRealServiceManager);
@@ -194,52 +339,381 @@ static int32_t ServiceManagerShim_realGetService(ServiceManagerShim* this, Strin
     return status.mErrorCode;
 }
 
-static IBinder* ServiceManagerShim_getService(ServiceManagerShim* this, String* name)
+static RegistrationWaiter* ServiceManagerShim_startWaiting(ServiceManagerShim* this, String* name)
 {
-    ProcessState* self = ProcessState_self();
+    RegistrationWaiter* waiter;
+    long count = 0;
+    Status status;
 
-    IBinder* svc = this->checkService(this, name);
-    UNUSED(self);
+    pthread_mutex_lock(&this->mNameToRegistrationLock);
 
-    if (svc != NULL) {
-        return svc;
+    if (this->mWaiter == NULL) {
+        waiter = RegistrationWaiter_new(NULL);
+        if (waiter == NULL) {
+            goto out;
+        }
+        waiter->mShim = this;
+
+        /* Never released: servicemanager may still hold the callback after
+         * the last wait has ended.
+         */
+
+        IBinder* binder = (IBinder*)waiter;
+        binder->incStrong(binder, (const void*)this);
+        this->mWaiter = waiter;
+    }
+
+    waiter = this->mWaiter;
+    this->mNameToWaitCount.find(&this->mNameToWaitCount, (long)name, &count);
+    if (count == 0) {
+        pthread_mutex_lock(&waiter->mLock);
+        waiter->mArrived.erase(&waiter->mArrived, (long)name);
+        pthread_mutex_unlock(&waiter->mLock);
+
+        Status_init(&status);
+        this->mTheRealServiceManager->registerForNotifications(this->mTheRealServiceManager,
+            name, (const IServiceCallback*)waiter, &status);
+        if (status.mErrorCode != STATUS_OK) {
+            BINDER_LOGW("Failed to register for notifications of %s: %" PRId32,
+                String_data(name), status.mErrorCode);
+            waiter = NULL;
+            goto out;
+        }
+    }
+    this->mNameToWaitCount.put(&this->mNameToWaitCount, (long)name, count + 1);
+
+out:
+    pthread_mutex_unlock(&this->mNameToRegistrationLock);
+    return waiter;
+}
+
+static void ServiceManagerShim_stopWaiting(ServiceManagerShim* this, String* name)
+{
+    RegistrationWaiter* waiter = this->mWaiter;
+    long count = 0;
+    Status status;
+
+    pthread_mutex_lock(&this->mNameToRegistrationLock);
+
+    this->mNameToWaitCount.find(&this->mNameToWaitCount, (long)name, &count);
+    if (count > 1) {
+        this->mNameToWaitCount.put(&this->mNameToWaitCount, (long)name, count - 1);
+    } else {
+        this->mNameToWaitCount.erase(&this->mNameToWaitCount, (long)name);
+        Status_init(&status);
+        this->mTheRealServiceManager->unregisterForNotifications(this->mTheRealServiceManager,
+            name, (const IServiceCallback*)waiter, &status);
+
+        pthread_mutex_lock(&waiter->mLock);
+        waiter->mArrived.erase(&waiter->mArrived, (long)name);
+        pthread_mutex_unlock(&waiter->mLock);
     }
 
+    pthread_mutex_unlock(&this->mNameToRegistrationLock);
+}
+
+static IBinder* ServiceManagerShim_pollService(ServiceManagerShim* this, String* name,
+    int64_t timeoutMs)
+{
     // retry interval in millisecond; note that vendor services stay at 100ms
     const useconds_t sleepTime = 100;
-    const int64_t timeout = 5000;
     int64_t startTime = uptimeMillis();
+    IBinder* svc = NULL;
 
-    BINDER_LOGV("Waiting for service '%s' on '%s'...", String_data(name), self->getDriverName(self));
-
-    int n = 0;
-    while (uptimeMillis() - startTime < timeout) {
-        n++;
+    while (svc == NULL && (timeoutMs < 0 || uptimeMillis() - startTime < timeoutMs)) {
         usleep(1000 * sleepTime);
         svc = this->checkService(this, name);
-        if (svc != NULL) {
-            BINDER_LOGV("Waiting for service '%s' on '%s' successful after waiting %" PRIi64 "ms",
-                String_data(name), self->getDriverName(self), uptimeMillis() - startTime);
-            return svc;
+    }
+    return svc;
+}
+
+static IBinder* ServiceManagerShim_waitForServiceTimeout(ServiceManagerShim* this, String* name,
+    int64_t timeoutMs)
+{
+    ProcessState* self = ProcessState_self();
+    RegistrationWaiter* waiter = NULL;
+    int64_t startTime = uptimeMillis();
+    bool warned = false;
+    IBinder* svc;
+
+    svc = this->checkService(this, name);
+    if (svc != NULL) {
+        return svc;
+    }
+
+    BINDER_LOGV("Waiting for service '%s' on '%s'...", String_data(name), self->getDriverName(self));
+
+    /* The notification is a oneway call into this process, it needs a
+     * binder thread to land on. Without a pool, poll like before.
+     */
+
+    if (self->mThreadPoolStarted) {
+        waiter = this->startWaiting(this, name);
+    }
+    if (waiter == NULL) {
+        svc = this->pollService(this, name, timeoutMs);
+        goto out;
+    }
+
+    while (svc == NULL) {
+        int64_t waitMs = 1000;
+
+        if (timeoutMs >= 0) {
+            int64_t remaining = timeoutMs - (uptimeMillis() - startTime);
+            if (remaining <= 0) {
+                break;
+            }
+            waitMs = remaining < waitMs ? remaining : waitMs;
         }
+
+        svc = waiter->waitFor(waiter, name, waitMs);
+        if (svc == NULL) {
+            /* Cover a notification lost to a servicemanager restart */
+
+            if (!warned) {
+                BINDER_LOGW("Waited %" PRIi64 "ms for service '%s'", uptimeMillis() - startTime,
+                    String_data(name));
+                warned = true;
+            } else {
+                BINDER_LOGV("Still waiting %" PRIi64 "ms for service '%s'",
+                    uptimeMillis() - startTime, String_data(name));
+            }
+            svc = this->checkService(this, name);
+        }
+    }
+
+    this->stopWaiting(this, name);
+
+out:
+    if (svc != NULL) {
+        BINDER_LOGV("Waiting for service '%s' on '%s' successful after waiting %" PRIi64 "ms",
+            String_data(name), self->getDriverName(self), uptimeMillis() - startTime);
+    } else {
+        BINDER_LOGV("Service %s didn't start. Returning NULL", String_data(name));
+    }
+    return svc;
+}
+
+static IBinder* ServiceManagerShim_getService(ServiceManagerShim* this, String* name)
+{
+    const int64_t timeout = 5000;
+
+    return this->waitForServiceTimeout(this, name, timeout);
+}
+
+static IBinder* ServiceManagerShim_waitForService(ServiceManagerShim* this, String* name)
+{
+    return this->waitForServiceTimeout(this, name, -1);
+}
+
+static RefBase_weakref* ServiceManagerShim_weakRefs(IBinder* binder)
+{
+    RefBase* refbase = &binder->m_refbase;
+
+    return refbase->getWeakRefs(refbase);
+}
+
+static void ServiceManagerShim_releaseCached(ServiceManagerShim* this, IBinder* binder)
+{
+    RefBase_weakref* refs = ServiceManagerShim_weakRefs(binder);
+
+    refs->decWeak(refs, (const void*)this);
+}
+
+/* The caller gets a strong reference of its own, taken from the cache's
+ * weak one, like every proxy handed out by unflattening.
+ */
+
+static IBinder* ServiceManagerShim_lookupCachedService(ServiceManagerShim* this, String* name)
+{
+    ServiceManager_global* global = ServiceManager_global_get();
+    IBinder* binder = NULL;
+    IBinder* dead = NULL;
+
+    pthread_mutex_lock(&this->mServiceCacheLock);
+    this->mServiceCache.find(&this->mServiceCache, (long)name, (long*)&binder);
+    if (binder != NULL) {
+        BpBinder* proxy = binder->remoteBinder(binder);
+        RefBase_weakref* refs = ServiceManagerShim_weakRefs(binder);
+
+        /* The death notification already came in, or a local binder that
+         * is gone fails attemptIncStrong().
+         */
+
+        if ((proxy != NULL && BpBinder_isKnownDead(proxy))
+            || !refs->attemptIncStrong(refs, (const void*)this)) {
+            this->mServiceCache.put(&this->mServiceCache, (long)name, 0);
+            dead = binder;
+            binder = NULL;
+        }
+    }
+    pthread_mutex_unlock(&this->mServiceCacheLock);
+
+    if (dead != NULL) {
+        atomic_fetch_add_explicit(&global->sCacheInvalidations, 1, memory_order_relaxed);
+        ServiceManagerShim_releaseCached(this, dead);
+    }
+
+    return binder;
+}
+
+static void ServiceManagerShim_cacheService(ServiceManagerShim* this, String* name, IBinder* binder)
+{
+    ProcessState* self = ProcessState_self();
+    RefBase_weakref* refs;
+    IBinder* old = NULL;
+    bool watched;
+
+    /* A re-registration can only reach us on a binder thread, without a
+     * pool an entry could go stale, so nothing is cached.
+     */
+
+    if (!self->mThreadPoolStarted) {
+        return;
+    }
+
+    pthread_mutex_lock(&this->mServiceCacheLock);
+    watched = this->mServiceCache.find(&this->mServiceCache, (long)name, (long*)&old) == STATUS_OK;
+    pthread_mutex_unlock(&this->mServiceCacheLock);
+
+    /* Watch the name for good, outside the cache lock as it is an IPC */
+
+    if (!watched && this->startWaiting(this, name) == NULL) {
+        return;
+    }
+
+    refs = ServiceManagerShim_weakRefs(binder);
+    refs->incWeak(refs, (const void*)this);
+
+    pthread_mutex_lock(&this->mServiceCacheLock);
+    old = NULL;
+    this->mServiceCache.find(&this->mServiceCache, (long)name, (long*)&old);
+    this->mServiceCache.put(&this->mServiceCache, (long)name, (long)binder);
+    pthread_mutex_unlock(&this->mServiceCacheLock);
+
+    if (old != NULL) {
+        ServiceManagerShim_releaseCached(this, old);
+    }
+}
+
+static void ServiceManagerShim_updateCachedService(ServiceManagerShim* this, const String* name,
+    IBinder* binder)
+{
+    ServiceManager_global* global = ServiceManager_global_get();
+    RefBase_weakref* refs;
+    IBinder* old = NULL;
+
+    pthread_mutex_lock(&this->mServiceCacheLock);
+    if (this->mServiceCache.find(&this->mServiceCache, (long)name, (long*)&old) != STATUS_OK
+        || old == binder) {
+        pthread_mutex_unlock(&this->mServiceCacheLock);
+        return;
+    }
+    refs = ServiceManagerShim_weakRefs(binder);
+    refs->incWeak(refs, (const void*)this);
+    this->mServiceCache.put(&this->mServiceCache, (long)name, (long)binder);
+    pthread_mutex_unlock(&this->mServiceCacheLock);
+
+    if (old != NULL) {
+        atomic_fetch_add_explicit(&global->sCacheInvalidations, 1, memory_order_relaxed);
+        ServiceManagerShim_releaseCached(this, old);
     }
-    BINDER_LOGV("Service %s didn't start. Returning NULL", String_data(name));
-    return NULL;
 }
 
 static IBinder* ServiceManagerShim_checkService(ServiceManagerShim* this, String* name)
 {
-    IBinder* ret = NULL;
+    ServiceManager_global* global = ServiceManager_global_get();
+    IBinder* ret;
     Status status;
 
+    ret = this->lookupCachedService(this, name);
+    if (ret != NULL) {
+        atomic_fetch_add_explicit(&global->sCacheHits, 1, memory_order_relaxed);
+        return ret;
+    }
+    atomic_fetch_add_explicit(&global->sCacheMisses, 1, memory_order_relaxed);
+
     this->mTheRealServiceManager->checkService(this->mTheRealServiceManager,
         name, &ret, &status);
     if (status.mErrorCode != STATUS_OK) {
         return NULL;
     }
+    if (ret != NULL) {
+        this->cacheService(this, name, ret);
+    }
     return ret;
 }
 
+static int32_t ServiceManagerShim_getServices(ServiceManagerShim* this, VectorString* names,
+    IBinder** services)
+{
+    ServiceManager_global* global = ServiceManager_global_get();
+    size_t index[AIDL_SERVICE_MANAGER_MAX_GET_SERVICES];
+    size_t count = names->size(names);
+    size_t i = 0;
+
+    while (i < count) {
+        VectorString batch;
+        VectorImpl found;
+        Status status;
+        size_t n = 0;
+
+        /* Cached names need no IPC, collect the rest into one batch */
+
+        VectorString_ctor(&batch);
+        for (; i < count && n < AIDL_SERVICE_MANAGER_MAX_GET_SERVICES; i++) {
+            String* name = names->get(names, i);
+
+            services[i] = this->lookupCachedService(this, name);
+            if (services[i] != NULL) {
+                atomic_fetch_add_explicit(&global->sCacheHits, 1, memory_order_relaxed);
+                continue;
+            }
+            atomic_fetch_add_explicit(&global->sCacheMisses, 1, memory_order_relaxed);
+            batch.add(&batch, name);
+            index[n++] = i;
+        }
+
+        if (n > 0) {
+            VectorImpl_ctor(&found);
+            Status_init(&status);
+            this->mTheRealServiceManager->getServices(this->mTheRealServiceManager,
+                &batch, &found, &status);
+            if (status.mException == EX_NONE && found.size(&found) == n) {
+                for (size_t j = 0; j < n; j++) {
+                    String* name = batch.get(&batch, j);
+
+                    /* Held like any unflattened proxy, the cache only adds a weak ref */
+
+                    services[index[j]] = found.get(&found, j);
+                    if (services[index[j]] != NULL) {
+                        this->cacheService(this, name, services[index[j]]);
+                    }
+                }
+            } else {
+                /* An older servicemanager, or the batch failed: go one by one */
+
+                for (size_t j = 0; j < n; j++) {
+                    String* name = batch.get(&batch, j);
+                    IBinder* binder = NULL;
+
+                    Status_init(&status);
+                    this->mTheRealServiceManager->checkService(this->mTheRealServiceManager,
+                        name, &binder, &status);
+                    services[index[j]] = status.mErrorCode == STATUS_OK ? binder : NULL;
+                    if (services[index[j]] != NULL) {
+                        this->cacheService(this, name, services[index[j]]);
+                    }
+                }
+            }
+            found.dtor(&found);
+        }
+        batch.dtor(&batch);
+    }
+
+    return STATUS_OK;
+}
+
 static int32_t ServiceManagerShim_addService(ServiceManagerShim* this, String* name, IBinder* service,
     bool allowIsolated, int dumpPriority)
 {
@@ -253,10 +727,96 @@ static int32_t ServiceManagerShim_addService(ServiceManagerShim* this, String* n
 
 static int32_t ServiceManagerShim_listServices(ServiceManagerShim* this, int dumpsysPriority, VectorString* list)
 {
+    IAIDLServiceManager* sm = this->mTheRealServiceManager;
+    String startAfter;
+    Status status;
+    size_t count;
+    bool first = true;
+
+    /* A page at a time, a big registry does not fit one reply */
+
+    String_init(&startAfter, "");
+    do {
+        VectorString page;
+
+        VectorString_ctor(&page);
+        Status_init(&status);
+        sm->listServicesPaged(sm, dumpsysPriority, &startAfter,
+            AIDL_SERVICE_MANAGER_MAX_LIST_SERVICES, &page, &status);
+        count = page.size(&page);
+        if (status.mException == EX_NONE) {
+            first = false;
+            for (size_t i = 0; i < count; i++) {
+                list->add(list, page.get(&page, i));
+            }
+            if (count > 0) {
+                String_dup(&startAfter, page.get(&page, count - 1));
+            }
+        }
+        page.dtor(&page);
+    } while (status.mException == EX_NONE && count == AIDL_SERVICE_MANAGER_MAX_LIST_SERVICES);
+
+    if (first && status.mErrorCode == STATUS_UNKNOWN_TRANSACTION) {
+        /* An older servicemanager, all in one reply then */
+
+        Status_init(&status);
+        sm->listServices(sm, dumpsysPriority, list, &status);
+    }
+
+    if (status.mException != EX_NONE && status.mErrorCode == STATUS_OK) {
+        return STATUS_UNKNOWN_ERROR;
+    }
+    return status.mErrorCode;
+}
+
+static bool ServiceManagerShim_isDeclared(ServiceManagerShim* this, String* name)
+{
+    Status status;
+    bool declared = false;
+
+    Status_init(&status);
+    this->mTheRealServiceManager->isDeclared(this->mTheRealServiceManager, name, &declared, &status);
+    return status.mException == EX_NONE && declared;
+}
+
+static int32_t ServiceManagerShim_getDeclaredInstances(ServiceManagerShim* this, String* interface,
+    VectorString* strvector)
+{
+    Status status;
+
+    Status_init(&status);
+    this->mTheRealServiceManager->getDeclaredInstances(this->mTheRealServiceManager, interface,
+        strvector, &status);
+    if (status.mException != EX_NONE && status.mErrorCode == STATUS_OK) {
+        return STATUS_UNKNOWN_ERROR;
+    }
+    return status.mErrorCode;
+}
+
+static int32_t ServiceManagerShim_getServiceDebugInfo(ServiceManagerShim* this, VectorImpl* infvector)
+{
+    IAIDLServiceManager* sm = this->mTheRealServiceManager;
+    String startAfter;
     Status status;
+    size_t count;
+
+    String_init(&startAfter, "");
+    do {
+        size_t before = infvector->size(infvector);
+
+        Status_init(&status);
+        sm->getServiceDebugInfoPaged(sm, &startAfter, AIDL_SERVICE_MANAGER_MAX_LIST_SERVICES,
+            infvector, &status);
+        count = infvector->size(infvector) - before;
+        if (count > 0) {
+            ServiceDebugInfo* last = infvector->get(infvector, infvector->size(infvector) - 1);
+            String_dup(&startAfter, &last->name);
+        }
+    } while (status.mException == EX_NONE && count == AIDL_SERVICE_MANAGER_MAX_LIST_SERVICES);
 
-    this->mTheRealServiceManager->listServices(this->mTheRealServiceManager,
-        dumpsysPriority, list, &status);
+    if (status.mException != EX_NONE && status.mErrorCode == STATUS_OK) {
+        return STATUS_UNKNOWN_ERROR;
+    }
     return status.mErrorCode;
 }
 
@@ -264,6 +824,8 @@ static void ServiceManagerShim_dtor(ServiceManagerShim* this)
 {
     this->m_IServiceManager.dtor(&this->m_IServiceManager);
     this->mNameToRegistrationCallback.dtor(&this->mNameToRegistrationCallback);
+    this->mNameToWaitCount.dtor(&this->mNameToWaitCount);
+    this->mServiceCache.dtor(&this->mServiceCache);
 }
 
 static void ServiceManagerShim_ctor(ServiceManagerShim* this, IAIDLServiceManager* impl)
@@ -272,6 +834,9 @@ static void ServiceManagerShim_ctor(ServiceManagerShim* this, IAIDLServiceManage
 
     IServiceManager_ctor(&this->m_IServiceManager);
     HashMap_String_ctor(&this->mNameToRegistrationCallback);
+    HashMap_String_ctor(&this->mNameToWaitCount);
+    HashMap_String_ctor(&this->mServiceCache);
+    pthread_mutex_init(&this->mServiceCacheLock, NULL);
     pthread_mutex_init(&this->mNameToRegistrationLock, NULL);
 
     this->mTheRealServiceManager = impl;
@@ -283,13 +848,30 @@ static void ServiceManagerShim_ctor(ServiceManagerShim* this, IAIDLServiceManage
     isvcmgr->checkService = IServiceManager_Vfun_checkService;
     isvcmgr->addService = IServiceManager_Vfun_addService;
     isvcmgr->listServices = IServiceManager_Vfun_listServices;
+    isvcmgr->waitForService = IServiceManager_Vfun_waitForService;
+    isvcmgr->getServices = IServiceManager_Vfun_getServices;
+    isvcmgr->getServiceDebugInfo = IServiceManager_Vfun_getServiceDebugInfo;
+    isvcmgr->isDeclared = IServiceManager_Vfun_isDeclared;
+    isvcmgr->getDeclaredInstances = IServiceManager_Vfun_getDeclaredInstances;
 
     this->getInterfaceDescriptor = ServiceManagerShim_getInterfaceDescriptor;
     this->getService = ServiceManagerShim_getService;
     this->checkService = ServiceManagerShim_checkService;
     this->addService = ServiceManagerShim_addService;
     this->listServices = ServiceManagerShim_listServices;
+    this->waitForService = ServiceManagerShim_waitForService;
+    this->getServices = ServiceManagerShim_getServices;
+    this->getServiceDebugInfo = ServiceManagerShim_getServiceDebugInfo;
+    this->isDeclared = ServiceManagerShim_isDeclared;
+    this->getDeclaredInstances = ServiceManagerShim_getDeclaredInstances;
     this->realGetService = ServiceManagerShim_realGetService;
+    this->waitForServiceTimeout = ServiceManagerShim_waitForServiceTimeout;
+    this->pollService = ServiceManagerShim_pollService;
+    this->startWaiting = ServiceManagerShim_startWaiting;
+    this->stopWaiting = ServiceManagerShim_stopWaiting;
+    this->lookupCachedService = ServiceManagerShim_lookupCachedService;
+    this->cacheService = ServiceManagerShim_cacheService;
+    this->updateCachedService = ServiceManagerShim_updateCachedService;
 
     this->dtor = ServiceManagerShim_dtor;
 }
@@ -329,6 +911,15 @@ IServiceManager* defaultServiceManager()
     return global->gDefaultServiceManager;
 }
 
+void getServiceCacheStats(ServiceCacheStats* stats)
+{
+    ServiceManager_global* global = ServiceManager_global_get();
+
+    stats->hits = atomic_load_explicit(&global->sCacheHits, memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&global->sCacheMisses, memory_order_relaxed);
+    stats->invalidations = atomic_load_explicit(&global->sCacheInvalidations, memory_order_relaxed);
+}
+
 void setDefaultServiceManager(IServiceManager* sm)
 {
     ServiceManager_global* global = ServiceManager_global_get();
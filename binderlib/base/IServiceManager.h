@@ -21,6 +21,7 @@
  * Included Files
  ****************************************************************************/
 
+#include "AidlServiceManager.h"
 #include "Binder.h"
 #include "BpBinder.h"
 #include "IBinder.h"
@@ -49,14 +50,16 @@ struct LocalRegistrationCallback {
         const IBinder* binder);
 };
 
-struct ServiceDebugInfo;
-typedef struct ServiceDebugInfo ServiceDebugInfo;
+/* Client side service lookup cache, counted since process start */
 
-struct ServiceDebugInfo {
-    String name;
-    int pid;
+struct ServiceCacheStats {
+    unsigned long hits;          /* Lookups answered from the cache, no IPC */
+    unsigned long misses;        /* Lookups that went to servicemanager */
+    unsigned long invalidations; /* Entries dropped by death or re-registration */
 };
 
+typedef struct ServiceCacheStats ServiceCacheStats;
+
 /**
  * Service manager for C++ services.
  */
@@ -81,7 +84,19 @@ struct IServiceManager {
         LocalRegistrationCallback* callback);
     int32_t (*unregisterForNotifications)(IServiceManager* this, String* name,
         LocalRegistrationCallback* callback);
+
+    /* Appends a ServiceDebugInfo* for every registered service, free
+     * them with ServiceDebugInfo_clearVector().
+     */
+
     int32_t (*getServiceDebugInfo)(IServiceManager* this, VectorImpl* infvector);
+
+    /* checkService() for all of names at once, services gets one IBinder*
+     * per name, NULL for the ones not registered. Names not cached are
+     * looked up in batched transactions, nothing is waited for.
+     */
+
+    int32_t (*getServices)(IServiceManager* this, VectorString* names, IBinder** services);
 };
 
 /****************************************************************************
@@ -91,5 +106,6 @@ struct IServiceManager {
 IServiceManager* defaultServiceManager(void);
 void setDefaultServiceManager(IServiceManager* sm);
 void destoryServiceManager(void);
+void getServiceCacheStats(ServiceCacheStats* stats);
 
 #endif /* __BINDER_INCLUDE_BINDER_ISERVERMANAGER_H__ */
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "ObituaryExecutor"
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include <android/binder_status.h>
+
+#include "BpBinder.h"
+#include "ObituaryExecutor.h"
+#include "ProcessGlobal.h"
+#include "utils/Binderlog.h"
+#include "utils/Thread.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Dead proxies taken off the queue per lock round trip */
+
+#define OBITUARY_EXECUTOR_BATCH 32
+
+#define OBITUARY_EXECUTOR_NAME "binder:obituary"
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+#ifdef CONFIG_BINDER_LIB_OBITUARY_EXECUTOR
+static void ObituaryExecutor_deliver(PendingObituaries* p)
+{
+    BpBinder* proxy = p->mProxy;
+    RefBase_weakref* weakref = proxy->getWeakRefs(proxy);
+
+    BpBinder_deliverObituaries(proxy, p->mObituaries);
+    weakref->decWeak(weakref, p);
+    free(p);
+}
+
+static bool ObituaryExecutor_threadLoop(void* v_this)
+{
+    ObituaryExecutor_global* global = ObituaryExecutor_global_get();
+    PendingObituaries* batch[OBITUARY_EXECUTOR_BATCH];
+    size_t n = 0;
+    bool exiting;
+
+    pthread_mutex_lock(&global->sLock);
+    while (RingBuffer_isEmpty(&global->sQueue) && !global->sExitPending) {
+        pthread_cond_wait(&global->sCond, &global->sLock);
+    }
+
+    /* On exit the queue is left for the global dtor to release */
+
+    while (n < OBITUARY_EXECUTOR_BATCH && !global->sExitPending
+        && !RingBuffer_isEmpty(&global->sQueue)) {
+        batch[n++] = RingBuffer_pop(&global->sQueue);
+    }
+
+    if (n > 0) {
+        global->sStats.batches++;
+        if (n > global->sStats.maxBatch) {
+            global->sStats.maxBatch = n;
+        }
+    }
+    exiting = global->sExitPending;
+    pthread_mutex_unlock(&global->sLock);
+
+    for (size_t i = 0; i < n; i++) {
+        ObituaryExecutor_deliver(batch[i]);
+    }
+
+    return !exiting;
+}
+
+static int ObituaryExecutor_startLocked(ObituaryExecutor_global* global)
+{
+    BinderThread* thread;
+
+    if (global->sThread != NULL) {
+        return STATUS_OK;
+    }
+    if (global->sExitPending) {
+        return STATUS_INVALID_OPERATION;
+    }
+
+    thread = zalloc(sizeof(BinderThread));
+    if (thread == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+
+    BinderThread_ctor(thread);
+    thread->threadLoop = ObituaryExecutor_threadLoop;
+
+    /* Recipients used to run on binder threads, give them the same stack */
+
+    if (thread->run(thread, OBITUARY_EXECUTOR_NAME, SCHED_PRIORITY_DEFAULT,
+            CONFIG_BINDER_LIB_THREAD_STACKSIZE)
+        != STATUS_OK) {
+        free(thread);
+        return STATUS_UNKNOWN_ERROR;
+    }
+
+    global->sThread = thread;
+    return STATUS_OK;
+}
+
+static bool ObituaryExecutor_enqueue(ObituaryExecutor_global* global,
+    BpBinder* proxy, VectorImpl* obits)
+{
+    PendingObituaries* p;
+    RefBase_weakref* weakref;
+    bool wake = false;
+    bool queued = false;
+
+    p = zalloc(sizeof(PendingObituaries));
+    if (p == NULL) {
+        return false;
+    }
+
+    p->mProxy = proxy;
+    p->mObituaries = obits;
+    weakref = proxy->getWeakRefs(proxy);
+    weakref->incWeak(weakref, p);
+
+    pthread_mutex_lock(&global->sLock);
+    if (ObituaryExecutor_startLocked(global) == STATUS_OK
+        && RingBuffer_push(&global->sQueue, p) == 0) {
+        /* The thread only sleeps on an empty queue */
+
+        wake = RingBuffer_size(&global->sQueue) == 1;
+        global->sStats.deaths++;
+        global->sStats.recipients += obits->size(obits);
+        queued = true;
+    }
+    pthread_mutex_unlock(&global->sLock);
+
+    if (!queued) {
+        weakref->decWeak(weakref, p);
+        free(p);
+        return false;
+    }
+
+    if (wake) {
+        pthread_cond_signal(&global->sCond);
+    }
+    return true;
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void ObituaryExecutor_post(BpBinder* proxy, VectorImpl* obits)
+{
+    ObituaryExecutor_global* global = ObituaryExecutor_global_get();
+
+#ifdef CONFIG_BINDER_LIB_OBITUARY_EXECUTOR
+    if (ObituaryExecutor_enqueue(global, proxy, obits)) {
+        return;
+    }
+    BINDER_LOGW("Can't queue obituaries of proxy %p, reporting inline\n", proxy);
+#endif
+
+    pthread_mutex_lock(&global->sLock);
+    global->sStats.inlined++;
+    global->sStats.recipients += obits->size(obits);
+    pthread_mutex_unlock(&global->sLock);
+
+    BpBinder_deliverObituaries(proxy, obits);
+}
+
+void ObituaryExecutor_getStats(ObituaryExecutorStats* stats)
+{
+    ObituaryExecutor_global* global = ObituaryExecutor_global_get();
+
+    pthread_mutex_lock(&global->sLock);
+    *stats = global->sStats;
+    pthread_mutex_unlock(&global->sLock);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BINDER_INCLUDE_BINDER_OBITUARYEXECUTOR_H__
+#define __BINDER_INCLUDE_BINDER_OBITUARYEXECUTOR_H__
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stddef.h>
+
+#include "BpBinder.h"
+#include "utils/Vector.h"
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Obituaries of one dead proxy waiting for the executor thread */
+
+struct PendingObituaries;
+typedef struct PendingObituaries PendingObituaries;
+
+struct PendingObituaries {
+    BpBinder* mProxy; /* Weak reference held until delivered */
+    VectorImpl* mObituaries;
+};
+
+struct ObituaryExecutorStats;
+typedef struct ObituaryExecutorStats ObituaryExecutorStats;
+
+struct ObituaryExecutorStats {
+    size_t deaths;     /* Dead proxies handed to the executor thread */
+    size_t recipients; /* Death recipients of those proxies */
+    size_t batches;    /* Wake-ups of the executor thread */
+    size_t maxBatch;   /* Most dead proxies delivered in one wake-up */
+    size_t inlined;    /* Dead proxies reported on the calling thread */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: ObituaryExecutor_post
+ *
+ * Description:
+ *     Queue the obituaries of a dead proxy to the executor thread of the
+ *  process, which is started on first use. Deaths queued while the thread
+ *  is busy are delivered together in its next batch. Ownership of obits
+ *  passes to the executor. If the thread can't be started, or
+ *  CONFIG_BINDER_LIB_OBITUARY_EXECUTOR is disabled, the recipients are
+ *  called before this function returns.
+ *
+ ****************************************************************************/
+
+void ObituaryExecutor_post(BpBinder* proxy, VectorImpl* obits);
+
+/****************************************************************************
+ * Name: ObituaryExecutor_getStats
+ *
+ * Description:
+ *     Snapshot the delivery counters of the current process.
+ *
+ ****************************************************************************/
+
+void ObituaryExecutor_getStats(ObituaryExecutorStats* stats);
+
+#endif /* __BINDER_INCLUDE_BINDER_OBITUARYEXECUTOR_H__ */
@@ -45,8 +45,11 @@
 static void release_object(ProcessState* proc, struct flat_binder_object* obj,
     const void* who);
 
-#define gParcelGlobalAllocCount (Parcel_global_get()->gParcelGlobalAllocCount)
-#define gParcelGlobalAllocSize (Parcel_global_get()->gParcelGlobalAllocSize)
+/* Bytes a thread may account locally before folding them into the
+ * process-wide running total that the peak is tracked on.
+ */
+
+#define PARCEL_ALLOC_BATCH 1024
 
 #define max(a, b) ((a) > (b) ? (a) : (b))
 #define min(a, b) (((a) < (b)) ? (a) : (b))
@@ -61,6 +64,107 @@ static inline size_t pad_size(size_t s)
     return PAD_SIZE_UNSAFE(s);
 }
 
+static void ParcelAlloc_threadExit(void* arg)
+{
+    ParcelAllocCounters* self = (ParcelAllocCounters*)arg;
+    Parcel_global* global = Parcel_global_get();
+
+    atomic_fetch_add_explicit(&global->gAllocTotal, self->unflushed, memory_order_relaxed);
+
+    pthread_mutex_lock(&global->gAllocLock);
+    for (int i = 0; i < PARCEL_ALLOC_NR; i++) {
+        global->gAllocRetired[i] += atomic_load_explicit(&self->counters[i], memory_order_relaxed);
+    }
+    for (size_t i = 0; i < global->gAllocThreads.size(&global->gAllocThreads); i++) {
+        if (global->gAllocThreads.get(&global->gAllocThreads, i) == self) {
+            global->gAllocThreads.removeAt(&global->gAllocThreads, i);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&global->gAllocLock);
+    free(self);
+}
+
+static ParcelAllocCounters* ParcelAlloc_self(Parcel_global* global)
+{
+    ParcelAllocCounters* self = NULL;
+
+    if (global->gAllocKeyCreated) {
+        self = (ParcelAllocCounters*)pthread_getspecific(global->gAllocKey);
+        if (self) {
+            return self;
+        }
+    }
+
+    pthread_mutex_lock(&global->gAllocLock);
+    if (!global->gAllocKeyCreated) {
+        global->gAllocKeyCreated = pthread_key_create(&global->gAllocKey,
+                                       ParcelAlloc_threadExit)
+            == 0;
+    }
+    if (global->gAllocKeyCreated) {
+        self = zalloc(sizeof(ParcelAllocCounters));
+        if (self) {
+            global->gAllocThreads.push(&global->gAllocThreads, self);
+            pthread_setspecific(global->gAllocKey, self);
+        }
+    }
+    pthread_mutex_unlock(&global->gAllocLock);
+    return self;
+}
+
+static void ParcelAlloc_peak(Parcel_global* global, long total)
+{
+    long peak = atomic_load_explicit(&global->gAllocPeak, memory_order_relaxed);
+
+    while (total > peak
+        && !atomic_compare_exchange_weak_explicit(&global->gAllocPeak, &peak, total,
+            memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+/* Account `bytes` and `buffers` of a data buffer (or of an objects array
+ * when `objects` is set) allocated or freed by this parcel. Only the
+ * calling thread writes its counters, so no read-modify-write atomics
+ * are needed; frees on another thread than the allocation show up as
+ * negative values that cancel out when the counters are summed.
+ */
+
+static void ParcelAlloc_account(const Parcel* this, bool objects, long bytes, long buffers)
+{
+    Parcel_global* global = Parcel_global_get();
+    ParcelAllocCounters* self = ParcelAlloc_self(global);
+    int kind;
+
+    if (self == NULL || (bytes == 0 && buffers == 0)) {
+        return;
+    }
+
+    if (objects) {
+        kind = PARCEL_ALLOC_OBJECTS_BYTES;
+    } else if (this->mPooled) {
+        kind = PARCEL_ALLOC_POOLED_BYTES;
+    } else {
+        kind = PARCEL_ALLOC_DATA_BYTES;
+    }
+
+    atomic_store_explicit(&self->counters[kind],
+        atomic_load_explicit(&self->counters[kind], memory_order_relaxed) + bytes,
+        memory_order_relaxed);
+    atomic_store_explicit(&self->counters[kind + 1],
+        atomic_load_explicit(&self->counters[kind + 1], memory_order_relaxed) + buffers,
+        memory_order_relaxed);
+
+    self->unflushed += bytes;
+    if (self->unflushed >= PARCEL_ALLOC_BATCH || self->unflushed <= -PARCEL_ALLOC_BATCH) {
+        long total = atomic_fetch_add_explicit(&global->gAllocTotal, self->unflushed,
+                         memory_order_relaxed)
+            + self->unflushed;
+        self->unflushed = 0;
+        ParcelAlloc_peak(global, total);
+    }
+}
+
 static uint8_t* reallocZeroFree(uint8_t* data, size_t oldCapacity,
     size_t newCapacity, bool zero)
 {
@@ -156,8 +260,10 @@ static int32_t continueWrite(Parcel* this, size_t desired)
 
         BINDER_LOGD("Parcel %p: taking ownership of %zu capacity", this, desired);
 
-        gParcelGlobalAllocSize += desired;
-        gParcelGlobalAllocCount++;
+        ParcelAlloc_account(this, false, desired, 1);
+        if (objects) {
+            ParcelAlloc_account(this, true, objectsSize * sizeof(binder_size_t), 1);
+        }
 
         this->mData = data;
         this->mObjects = objects;
@@ -187,11 +293,15 @@ static int32_t continueWrite(Parcel* this, size_t desired)
 
             if (objectsSize == 0) {
                 free(this->mObjects);
+                ParcelAlloc_account(this, true,
+                    -(long)(this->mObjectsCapacity * sizeof(binder_size_t)), -1);
                 this->mObjects = NULL;
                 this->mObjectsCapacity = 0;
             } else {
                 binder_size_t* objects = (binder_size_t*)realloc(this->mObjects, objectsSize * sizeof(binder_size_t));
                 if (objects) {
+                    ParcelAlloc_account(this, true,
+                        ((long)objectsSize - (long)this->mObjectsCapacity) * (long)sizeof(binder_size_t), 0);
                     this->mObjects = objects;
                     this->mObjectsCapacity = objectsSize;
                 }
@@ -210,8 +320,7 @@ static int32_t continueWrite(Parcel* this, size_t desired)
             if (data) {
                 BINDER_LOGV("Parcel %p: continue from %zu to %zu capacity", this, this->mDataCapacity,
                     desired);
-                gParcelGlobalAllocSize += desired;
-                gParcelGlobalAllocSize -= this->mDataCapacity;
+                ParcelAlloc_account(this, false, (long)desired - (long)this->mDataCapacity, 0);
                 this->mData = data;
                 this->mDataCapacity = desired;
             } else {
@@ -243,8 +352,7 @@ static int32_t continueWrite(Parcel* this, size_t desired)
         }
 
         BINDER_LOGV("Parcel %p: allocating with %zu capacity", this, desired);
-        gParcelGlobalAllocSize += desired;
-        gParcelGlobalAllocCount++;
+        ParcelAlloc_account(this, false, desired, 1);
 
         this->mData = data;
         this->mDataSize = this->mDataPos = 0;
@@ -554,6 +662,9 @@ int32_t Parcel_writeObject(Parcel* this, struct flat_binder_object* val, bool nu
         binder_size_t* objects = (binder_size_t*)realloc(this->mObjects, newSize * sizeof(binder_size_t));
         if (objects == NULL)
             return STATUS_NO_MEMORY;
+        ParcelAlloc_account(this, true,
+            ((long)newSize - (long)this->mObjectsCapacity) * (long)sizeof(binder_size_t),
+            this->mObjects == NULL ? 1 : 0);
         this->mObjects = objects;
         this->mObjectsCapacity = newSize;
     }
@@ -726,7 +837,12 @@ static int32_t Parcel_unflattenBinder(Parcel* this, IBinder** out)
         switch (flat->hdr.type) {
         case BINDER_TYPE_BINDER: {
             IBinder* binder = (IBinder*)(flat->cookie);
-            binder->incStrongRequireStrong(binder, (void*)binder);
+
+            /* A NULL binder is written as an empty local object */
+
+            if (binder != NULL) {
+                binder->incStrongRequireStrong(binder, (void*)binder);
+            }
             return Parcel_finishUnflattenBinder(this, binder, out);
         }
         case BINDER_TYPE_HANDLE: {
@@ -753,6 +869,16 @@ int32_t Parcel_writeInt32(Parcel* this, int32_t val)
     return writeAligned(this, (uint8_t*)&val, sizeof(int32_t));
 }
 
+int32_t Parcel_readInt64(Parcel* this, int64_t* pArg)
+{
+    return readAligned(this, (uint8_t*)pArg, sizeof(int64_t));
+}
+
+int32_t Parcel_writeInt64(Parcel* this, int64_t val)
+{
+    return writeAligned(this, (uint8_t*)&val, sizeof(int64_t));
+}
+
 int32_t Parcel_writePointer(Parcel* this, uintptr_t val)
 {
     return writeAligned(this, (uint8_t*)&val, sizeof(binder_uintptr_t));
@@ -937,36 +1063,28 @@ void Parcel_initState(Parcel* this)
     this->mFdsKnown = true;
     this->mAllowFds = true;
     this->mDeallocZero = false;
+    this->mPooled = false;
     this->mOwner = NULL;
     this->mWorkSourceRequestHeaderPosition = 0;
     this->mRequestHeaderPresent = false;
 }
 
-int32_t Parcel_dup(Parcel* new, const Parcel* old)
+Parcel* ParcelCursor_begin(ParcelCursor* this, const Parcel* parcel)
 {
-    // Parcel_setDataCapacity(new, old->mDataCapacity);
-    // memcpy(new->mData, old->mData, old->mDataSize);
-    new->mData = old->mData;
-    new->mDataSize = old->mDataSize;
-    new->mDataCapacity = old->mDataCapacity;
-    new->mDataPos = old->mDataPos;
-    new->mError = old->mError;
+    /* Reading only moves mDataPos and the object lookup hint, which live
+     * in the copy. The buffers are shared, nothing frees them through it.
+     */
 
-    new->mObjects = old->mObjects;
-    new->mObjectsSize = old->mObjectsSize;
-    new->mObjectsCapacity = old->mObjectsCapacity;
-    new->mNextObjectHint = old->mNextObjectHint;
-    new->mObjectsSorted = old->mObjectsSorted;
-    new->mHasFds = old->mHasFds;
-    new->mFdsKnown = old->mFdsKnown;
-    new->mAllowFds = old->mAllowFds;
-    new->mDeallocZero = old->mDeallocZero;
-    new->mOwner = old->mOwner;
+    this->mParcel = *parcel;
+    this->mParcel.mOwner = NULL;
+    Parcel_setDataPosition(&this->mParcel, 0);
 
-    new->mWorkSourceRequestHeaderPosition = old->mWorkSourceRequestHeaderPosition;
-    new->mRequestHeaderPresent = old->mRequestHeaderPresent;
+    return &this->mParcel;
+}
 
-    return STATUS_OK;
+void ParcelCursor_end(ParcelCursor* this)
+{
+    Parcel_initState(&this->mParcel);
 }
 
 void Parcel_releaseObjects(Parcel* this)
@@ -1019,23 +1137,95 @@ void Parcel_freeDataNoInit(Parcel* this)
         Parcel_releaseObjects(this);
         if (this->mData) {
             BINDER_LOGV("Parcel %p: freeing with %zu capacity", this, this->mDataCapacity);
-            gParcelGlobalAllocSize -= this->mDataCapacity;
-            gParcelGlobalAllocCount--;
+            ParcelAlloc_account(this, false, -(long)this->mDataCapacity, -1);
             if (this->mDeallocZero) {
                 memset(this->mData, 0x0, this->mDataSize);
             }
             free(this->mData);
         }
-        if (this->mObjects)
+        if (this->mObjects) {
+            ParcelAlloc_account(this, true,
+                -(long)(this->mObjectsCapacity * sizeof(binder_size_t)), -1);
             free(this->mObjects);
+        }
     }
 }
 
 void Parcel_freeData(Parcel* this)
 {
+    bool pooled = this->mPooled;
+
     Parcel_freeDataNoInit(this);
     Parcel_initState(this);
-    ;
+    this->mPooled = pooled;
+}
+
+void Parcel_setPooled(Parcel* this, bool pooled)
+{
+    LOG_FATAL_IF(this->mData != NULL || this->mObjects != NULL,
+        "Parcel %p: pooled state must be set before the first allocation", this);
+    this->mPooled = pooled;
+}
+
+void Parcel_getAllocStats(ParcelAllocStats* stats)
+{
+    Parcel_global* global = Parcel_global_get();
+    long sum[PARCEL_ALLOC_NR];
+    long total;
+
+    pthread_mutex_lock(&global->gAllocLock);
+    memcpy(sum, global->gAllocRetired, sizeof(sum));
+    for (size_t i = 0; i < global->gAllocThreads.size(&global->gAllocThreads); i++) {
+        ParcelAllocCounters* counters = global->gAllocThreads.get(&global->gAllocThreads, i);
+        for (int j = 0; j < PARCEL_ALLOC_NR; j++) {
+            sum[j] += atomic_load_explicit(&counters->counters[j], memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&global->gAllocLock);
+
+    for (int j = 0; j < PARCEL_ALLOC_NR; j++) {
+        if (sum[j] < 0) {
+            sum[j] = 0;
+        }
+    }
+
+    total = sum[PARCEL_ALLOC_DATA_BYTES] + sum[PARCEL_ALLOC_OBJECTS_BYTES]
+        + sum[PARCEL_ALLOC_POOLED_BYTES];
+    ParcelAlloc_peak(global, total);
+
+    stats->dataBytes = sum[PARCEL_ALLOC_DATA_BYTES];
+    stats->dataBuffers = sum[PARCEL_ALLOC_DATA_BUFFERS];
+    stats->objectsBytes = sum[PARCEL_ALLOC_OBJECTS_BYTES];
+    stats->objectsArrays = sum[PARCEL_ALLOC_OBJECTS_ARRAYS];
+    stats->pooledBytes = sum[PARCEL_ALLOC_POOLED_BYTES];
+    stats->pooledBuffers = sum[PARCEL_ALLOC_POOLED_BUFFERS];
+    stats->totalBytes = total;
+    stats->peakBytes = atomic_load_explicit(&global->gAllocPeak, memory_order_relaxed);
+}
+
+void Parcel_resetAllocPeak(void)
+{
+    Parcel_global* global = Parcel_global_get();
+    ParcelAllocStats stats;
+
+    atomic_store_explicit(&global->gAllocPeak, 0, memory_order_relaxed);
+    Parcel_getAllocStats(&stats);
+}
+
+size_t Parcel_getGlobalAllocSize(void)
+{
+    ParcelAllocStats stats;
+
+    Parcel_getAllocStats(&stats);
+    return stats.dataBytes + stats.pooledBytes;
+}
+
+size_t Parcel_getGlobalAllocCount(void)
+{
+    ParcelAllocStats stats;
+
+    Parcel_getAllocStats(&stats);
+    return stats.dataBuffers + stats.pooledBuffers;
 }
 
 int Parcel_readFileDescriptor(Parcel* this)
@@ -1225,14 +1415,48 @@ int32_t Parcel_readStrongBinder(Parcel* this, IBinder** val)
 
 int32_t Parcel_writeStringVector(Parcel* this, VectorString* strVtor)
 {
-    PANIC();
-    return 0;
+    size_t size = strVtor->size(strVtor);
+    int32_t status;
+
+    if (size > INT32_MAX) {
+        return STATUS_BAD_VALUE;
+    }
+
+    status = Parcel_writeInt32(this, (int32_t)size);
+    for (size_t i = 0; status == STATUS_OK && i < size; i++) {
+        status = Parcel_writeString16(this, strVtor->get(strVtor, i));
+    }
+    return status;
 }
 
 int32_t Parcel_readUtf8VectorFromUtf16Vector(Parcel* this, VectorString* strVtor)
 {
-    PANIC();
-    return 0;
+    int32_t size;
+    int32_t status;
+    String str;
+
+    status = Parcel_readInt32(this, &size);
+    if (status != STATUS_OK) {
+        return status;
+    }
+    if (size < 0) {
+        return STATUS_UNEXPECTED_NULL;
+    }
+
+    /* Each element takes at least its length, don't trust a bogus size */
+
+    if ((size_t)size > Parcel_dataAvail(this) / sizeof(int32_t)) {
+        return STATUS_BAD_VALUE;
+    }
+
+    for (int32_t i = 0; i < size; i++) {
+        status = Parcel_readString16_to(this, &str);
+        if (status != STATUS_OK) {
+            return status;
+        }
+        strVtor->add(strVtor, &str);
+    }
+    return STATUS_OK;
 }
 
 int32_t Parcel_writeUtf8VectorAsUtf16Vector(Parcel* this, VectorString* strVtor)
@@ -67,9 +67,37 @@ struct Parcel {
     bool mHasFds;
     bool mAllowFds;
     bool mDeallocZero;
+    bool mPooled;
     release_func mOwner;
 };
 
+/* Heap used by parcels of the calling process, see Parcel_getAllocStats() */
+
+struct ParcelAllocStats {
+    size_t dataBytes;     /* Data buffers of ordinary parcels */
+    size_t dataBuffers;
+    size_t objectsBytes;  /* Object offset arrays */
+    size_t objectsArrays;
+    size_t pooledBytes;   /* Buffers of long-lived parcels, e.g. IPCThreadState mIn/mOut */
+    size_t pooledBuffers;
+    size_t totalBytes;    /* dataBytes + objectsBytes + pooledBytes */
+    size_t peakBytes;     /* Highest totalBytes seen since start or last reset */
+};
+
+typedef struct ParcelAllocStats ParcelAllocStats;
+
+/* Read cursor over the incoming data of a transaction. The Parcel stays
+ * owned by whoever received it (normally the IPC thread); the cursor reads
+ * its buffers in place through a shallow copy holding its own position,
+ * so the caller's const Parcel is never written.
+ */
+
+struct ParcelCursor {
+    Parcel mParcel;
+};
+
+typedef struct ParcelCursor ParcelCursor;
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -77,12 +105,34 @@ struct Parcel {
 /* Misc function */
 
 void Parcel_initState(Parcel* this);
-int32_t Parcel_dup(Parcel* new, const Parcel* old);
 void Parcel_freeData(Parcel* this);
 
+/* Start reading a const Parcel from its beginning, returns the Parcel to
+ * pass to the read functions until ParcelCursor_end().
+ */
+
+Parcel* ParcelCursor_begin(ParcelCursor* this, const Parcel* parcel);
+void ParcelCursor_end(ParcelCursor* this);
+
+/* Mark a parcel whose buffers are kept for reuse, must be called
+ * before anything is written to it.
+ */
+
+void Parcel_setPooled(Parcel* this, bool pooled);
+
+/* Allocation accounting. Counters are kept per thread and summed on read,
+ * the peak is exact to within PARCEL_ALLOC_BATCH bytes per thread.
+ */
+
+void Parcel_getAllocStats(ParcelAllocStats* stats);
+void Parcel_resetAllocPeak(void);
+size_t Parcel_getGlobalAllocSize(void);
+size_t Parcel_getGlobalAllocCount(void);
+
 /* Read functions */
 
 int32_t Parcel_readInt32(Parcel* this, int32_t* pArg);
+int32_t Parcel_readInt64(Parcel* this, int64_t* pArg);
 const char* Parcel_readString16(Parcel* this);
 int32_t Parcel_readString16_to(Parcel* this, String* pArg);
 int Parcel_readFileDescriptor(Parcel* this);
@@ -101,6 +151,7 @@ void Parcel_acquireObjects(Parcel* this);
 /* Write functions */
 
 int32_t Parcel_writeInt32(Parcel* this, int32_t val);
+int32_t Parcel_writeInt64(Parcel* this, int64_t val);
 int32_t Parcel_writeString16(Parcel* this, String* str);
 int32_t Parcel_writeStringVector(Parcel* this, VectorString* str);
 int32_t Parcel_writeFileDescriptor(Parcel* this, int fd, bool takeOwnership /* = false */);
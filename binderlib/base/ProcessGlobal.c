@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/prctl.h>
@@ -43,6 +44,8 @@
 #include <nuttx/tls.h>
 
 #include "AidlServiceManager.h"
+#include "Binder.h"
+#include "BpBinder.h"
 #include "IPCThreadState.h"
 #include "IServiceManager.h"
 #include "ProcessGlobal.h"
@@ -54,6 +57,14 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/****************************************************************************
+ * Public Data
+ ****************************************************************************/
+
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+_Thread_local ProcessGlobal* gProcessGlobalCache;
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -66,6 +77,9 @@ static void ServiceManager_global_ctor(ServiceManager_global* this)
 {
     this->gSmOnce = false;
     this->gDefaultServiceManager = NULL;
+    atomic_init(&this->sCacheHits, 0);
+    atomic_init(&this->sCacheMisses, 0);
+    atomic_init(&this->sCacheInvalidations, 0);
 
     this->dtor = ServiceManager_global_dtor;
 }
@@ -84,38 +98,144 @@ static void IAIDLServiceManager_global_ctor(IAIDLServiceManager_global* this)
 
 static void BpBinder_global_dtor(BpBinder_global* this)
 {
-    this->sTrackingMap.dtor(&this->sTrackingMap);
-    this->sLastLimitCallbackMap.dtor(&this->sLastLimitCallbackMap);
-    pthread_mutex_destroy(&this->sTrackingLock);
 }
 
 static void BpBinder_global_ctor(BpBinder_global* this)
 {
-    HashMap_ctor(&this->sTrackingMap);
-    HashMap_ctor(&this->sLastLimitCallbackMap);
-    pthread_mutex_init(&this->sTrackingLock, NULL);
+    for (size_t i = 0; i < BPBINDER_UID_SLOTS; i++) {
+        atomic_init(&this->sUidCounts[i].mUid, -1);
+        atomic_init(&this->sUidCounts[i].mValue, 0);
+        atomic_init(&this->sUidCounts[i].mLastLimitCallbackAt, 0);
+    }
 
-    this->sNumTrackedUids = 0;
+    atomic_init(&this->sNumTrackedUids, 0);
     this->sCountByUidEnabled = false;
     this->sLimitCallback = NULL;
     this->sBinderProxyThrottleCreate = false;
     this->sBinderProxyCountHighWatermark = 2500;
     this->sBinderProxyCountLowWatermark = 2000;
+    atomic_init(&this->sDeadCallsAvoided, 0);
 
     this->dtor = BpBinder_global_dtor;
 }
 
 static void Parcel_global_dtor(Parcel_global* this)
 {
-    this->gParcelGlobalAllocCount = 0;
-    this->gParcelGlobalAllocSize = 0;
+    /* Counters of threads that never ran their key destructor */
+
+    this->gAllocThreads.m_VectorBase.clear(&this->gAllocThreads.m_VectorBase, free);
+    this->gAllocThreads.dtor(&this->gAllocThreads);
+    if (this->gAllocKeyCreated) {
+        pthread_key_delete(this->gAllocKey);
+        this->gAllocKeyCreated = false;
+    }
+    pthread_mutex_destroy(&this->gAllocLock);
 }
 
 static void Parcel_global_ctor(Parcel_global* this)
 {
+    pthread_mutex_init(&this->gAllocLock, NULL);
+    VectorImpl_ctor(&this->gAllocThreads);
+    this->gAllocKeyCreated = false;
+    memset(this->gAllocRetired, 0, sizeof(this->gAllocRetired));
+    atomic_init(&this->gAllocTotal, 0);
+    atomic_init(&this->gAllocPeak, 0);
+
     this->dtor = Parcel_global_dtor;
 }
 
+static void BinderThread_global_dtor(BinderThread_global* this)
+{
+    this->sLiveStacks.dtor(&this->sLiveStacks);
+    pthread_mutex_destroy(&this->sStackLock);
+}
+
+static void BinderThread_global_ctor(BinderThread_global* this)
+{
+    VectorImpl_ctor(&this->sLiveStacks);
+    pthread_mutex_init(&this->sStackLock, NULL);
+
+    this->sStackSize = 0;
+    this->sStackThreadsSampled = 0;
+    this->sStackHighWater = 0;
+
+    this->dtor = BinderThread_global_dtor;
+}
+
+static void ObituaryExecutor_global_dtor(ObituaryExecutor_global* this)
+{
+    BinderThread* thread = this->sThread;
+    PendingObituaries* p;
+
+    /* Wake the executor and wait for it to leave before its lock, cond
+     * and queue go away. A thread the group exit already took down is
+     * not waited for.
+     */
+
+    pthread_mutex_lock(&this->sLock);
+    this->sExitPending = true;
+    pthread_cond_broadcast(&this->sCond);
+    pthread_mutex_unlock(&this->sLock);
+
+    if (thread != NULL) {
+        if (thread->isRunning(thread) && thread->mTid > 0 && kill(thread->mTid, 0) == 0) {
+            thread->join(thread);
+        }
+        free(thread);
+        this->sThread = NULL;
+    }
+
+    /* The task group is going away, nobody is left to notify */
+
+    while (!RingBuffer_isEmpty(&this->sQueue)) {
+        RefBase_weakref* weakref;
+
+        p = RingBuffer_pop(&this->sQueue);
+        weakref = p->mProxy->getWeakRefs(p->mProxy);
+        BpBinder_freeObituaries(p->mObituaries);
+        weakref->decWeak(weakref, p);
+        free(p);
+    }
+
+    RingBuffer_destroy(&this->sQueue);
+    pthread_cond_destroy(&this->sCond);
+    pthread_mutex_destroy(&this->sLock);
+}
+
+static void ObituaryExecutor_global_ctor(ObituaryExecutor_global* this)
+{
+    pthread_mutex_init(&this->sLock, NULL);
+    pthread_cond_init(&this->sCond, NULL);
+    RingBuffer_init(&this->sQueue);
+    this->sThread = NULL;
+    this->sExitPending = false;
+    memset(&this->sStats, 0, sizeof(this->sStats));
+
+    this->dtor = ObituaryExecutor_global_dtor;
+}
+
+static void Slab_global_dtor(Slab_global* this)
+{
+    SlabCache_destroy(&this->sBpBinder);
+    SlabCache_destroy(&this->sBpBinderExtras);
+    SlabCache_destroy(&this->sBBinderExtras);
+    SlabCache_destroy(&this->sHandleEntry);
+    SlabCache_destroy(&this->sObituary);
+    SlabGroup_destroy(&this->sGroup);
+}
+
+static void Slab_global_ctor(Slab_global* this)
+{
+    SlabGroup_init(&this->sGroup);
+    SlabCache_init(&this->sBpBinder, &this->sGroup, "BpBinder", sizeof(BpBinder));
+    SlabCache_init(&this->sBpBinderExtras, &this->sGroup, "BpBinder_Extras", sizeof(BpBinder_Extras));
+    SlabCache_init(&this->sBBinderExtras, &this->sGroup, "BBinder_Extras", sizeof(BBinder_Extras));
+    SlabCache_init(&this->sHandleEntry, &this->sGroup, "handle_entry", sizeof(handle_entry));
+    SlabCache_init(&this->sObituary, &this->sGroup, "Obituary", sizeof(Obituary));
+
+    this->dtor = Slab_global_dtor;
+}
+
 static void ProcessState_global_dtor(ProcessState_global* this)
 {
     if (this->gProcessState) {
@@ -143,15 +263,23 @@ static void ProcessGlobal_dtor(ProcessGlobal* this)
     this->gBpBinder_global.dtor(&this->gBpBinder_global);
     this->gServiceManager_global.dtor(&this->gServiceManager_global);
     this->gIAIDLServiceManager_global.dtor(&this->gIAIDLServiceManager_global);
+    this->gBinderThread_global.dtor(&this->gBinderThread_global);
+    this->gObituaryExecutor_global.dtor(&this->gObituaryExecutor_global);
+
+    /* last, the other globals may still free objects into the caches */
+    this->gSlab_global.dtor(&this->gSlab_global);
 }
 
 static void ProcessGlobal_ctor(ProcessGlobal* this)
 {
+    Slab_global_ctor(&this->gSlab_global);
     ProcessState_global_ctor(&this->gProcessState_global);
     Parcel_global_ctor(&this->gParcel_global);
     BpBinder_global_ctor(&this->gBpBinder_global);
     ServiceManager_global_ctor(&this->gServiceManager_global);
     IAIDLServiceManager_global_ctor(&this->gIAIDLServiceManager_global);
+    BinderThread_global_ctor(&this->gBinderThread_global);
+    ObituaryExecutor_global_ctor(&this->gObituaryExecutor_global);
 
     this->dtor = ProcessGlobal_dtor;
 }
@@ -172,10 +300,13 @@ static void ProcessGlobal_free(void* global)
         ProcessGlobal* this = (ProcessGlobal*)global;
         this->dtor(this);
         free(this);
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+        gProcessGlobalCache = NULL;
+#endif
     }
 }
 
-ProcessGlobal* ProcessGlobal_get(void)
+ProcessGlobal* ProcessGlobal_lookup(void)
 {
     static int index = -1;
     ProcessGlobal* global = NULL;
@@ -195,5 +326,19 @@ ProcessGlobal* ProcessGlobal_get(void)
     }
 
     ASSERT(global != NULL);
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+    gProcessGlobalCache = global;
+#endif
     return global;
 }
+
+void ProcessGlobal_dumpSlabStats(int fd)
+{
+    Slab_global* global = Slab_global_get();
+
+    SlabCache_dump(&global->sBpBinder, fd);
+    SlabCache_dump(&global->sBpBinderExtras, fd);
+    SlabCache_dump(&global->sBBinderExtras, fd);
+    SlabCache_dump(&global->sHandleEntry, fd);
+    SlabCache_dump(&global->sObituary, fd);
+}
@@ -25,11 +25,14 @@
 #include <stdatomic.h>
 
 #include "AidlServiceManager.h"
+#include "BpBinder.h"
 #include "IBinder.h"
 #include "IClientCallback.h"
 #include "IPCThreadState.h"
 #include "IServiceManager.h"
+#include "ObituaryExecutor.h"
 #include "ProcessState.h"
+#include "utils/Slab.h"
 
 /****************************************************************************
  * Public Types
@@ -49,6 +52,12 @@ struct ServiceManager_global {
 
     bool gSmOnce;
     IServiceManager* gDefaultServiceManager;
+
+    /* Service lookup cache of ServiceManagerShim, see getServiceCacheStats() */
+
+    atomic_ulong sCacheHits;
+    atomic_ulong sCacheMisses;
+    atomic_ulong sCacheInvalidations;
 };
 
 /* Global data for IAIDLServiceManager */
@@ -71,15 +80,14 @@ typedef struct BpBinder_global BpBinder_global;
 struct BpBinder_global {
     void (*dtor)(BpBinder_global* this);
 
-    pthread_mutex_t sTrackingLock;
-    int sNumTrackedUids;
+    atomic_int sNumTrackedUids;
     atomic_bool sCountByUidEnabled;
     uint32_t sBinderProxyCountHighWatermark;
     uint32_t sBinderProxyCountLowWatermark;
     bool sBinderProxyThrottleCreate;
-    HashMap sTrackingMap;
-    HashMap sLastLimitCallbackMap;
+    BpBinder_UidCount sUidCounts[BPBINDER_UID_SLOTS];
     binder_proxy_limit_callback sLimitCallback;
+    atomic_ulong sDeadCallsAvoided;
 };
 
 struct ProcessState_global;
@@ -95,6 +103,31 @@ struct ProcessState_global {
     bool gProcessInit;
 };
 
+/* Parcel heap accounting, every thread owns one ParcelAllocCounters and
+ * is the only writer of it, readers sum all of them.
+ */
+
+enum {
+    PARCEL_ALLOC_DATA_BYTES,
+    PARCEL_ALLOC_DATA_BUFFERS,
+    PARCEL_ALLOC_OBJECTS_BYTES,
+    PARCEL_ALLOC_OBJECTS_ARRAYS,
+    PARCEL_ALLOC_POOLED_BYTES,
+    PARCEL_ALLOC_POOLED_BUFFERS,
+    PARCEL_ALLOC_NR,
+};
+
+struct ParcelAllocCounters;
+typedef struct ParcelAllocCounters ParcelAllocCounters;
+
+struct ParcelAllocCounters {
+    atomic_long counters[PARCEL_ALLOC_NR];
+
+    /* Bytes not yet folded into Parcel_global::gAllocTotal, owner only */
+
+    long unflushed;
+};
+
 struct Parcel_global;
 typedef struct Parcel_global Parcel_global;
 
@@ -102,8 +135,61 @@ typedef struct Parcel_global Parcel_global;
 
 struct Parcel_global {
     void (*dtor)(Parcel_global* this);
-    size_t gParcelGlobalAllocCount;
-    size_t gParcelGlobalAllocSize;
+
+    pthread_mutex_t gAllocLock;
+    pthread_key_t gAllocKey;
+    bool gAllocKeyCreated;
+    VectorImpl gAllocThreads;
+    long gAllocRetired[PARCEL_ALLOC_NR];
+    atomic_long gAllocTotal;
+    atomic_long gAllocPeak;
+};
+
+struct BinderThread_global;
+typedef struct BinderThread_global BinderThread_global;
+
+/* Global data for binder thread stack accounting */
+
+struct BinderThread_global {
+    void (*dtor)(BinderThread_global* this);
+
+    pthread_mutex_t sStackLock;
+    VectorImpl sLiveStacks;
+    size_t sStackSize;
+    size_t sStackThreadsSampled;
+    size_t sStackHighWater;
+};
+
+struct Slab_global;
+typedef struct Slab_global Slab_global;
+
+/* Slab caches of the runtime objects, see utils/Slab.h */
+
+struct Slab_global {
+    void (*dtor)(Slab_global* this);
+
+    SlabGroup sGroup;
+    SlabCache sBpBinder;
+    SlabCache sBpBinderExtras;
+    SlabCache sBBinderExtras;
+    SlabCache sHandleEntry;
+    SlabCache sObituary;
+};
+
+struct ObituaryExecutor_global;
+typedef struct ObituaryExecutor_global ObituaryExecutor_global;
+
+/* Global data for the obituary executor, see ObituaryExecutor.h */
+
+struct ObituaryExecutor_global {
+    void (*dtor)(ObituaryExecutor_global* this);
+
+    pthread_mutex_t sLock;
+    pthread_cond_t sCond;
+    RingBuffer sQueue; /* PendingObituaries* */
+    struct BinderThread* sThread;
+    bool sExitPending;
+    ObituaryExecutorStats sStats;
 };
 
 /* NuttX Process Binderlib Global Data */
@@ -114,11 +200,14 @@ typedef struct ProcessGlobal ProcessGlobal;
 struct ProcessGlobal {
     void (*dtor)(ProcessGlobal* this);
 
+    Slab_global gSlab_global;
     ProcessState_global gProcessState_global;
     Parcel_global gParcel_global;
     BpBinder_global gBpBinder_global;
     ServiceManager_global gServiceManager_global;
     IAIDLServiceManager_global gIAIDLServiceManager_global;
+    BinderThread_global gBinderThread_global;
+    ObituaryExecutor_global gObituaryExecutor_global;
 
     IClientCallback* IClientCallback_impl;
     IServiceCallback* IServiceCallback_impl;
@@ -128,13 +217,51 @@ struct ProcessGlobal {
  * Public Function Prototypes
  ****************************************************************************/
 
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+/* Per-thread copy of the task TLS slot, filled by ProcessGlobal_lookup() */
+
+extern _Thread_local ProcessGlobal* gProcessGlobalCache;
+#endif
+
+/****************************************************************************
+ * Name: ProcessGlobal_lookup
+ *
+ * Description:
+ *     Slow path of ProcessGlobal_get(), fetch (and create on first use)
+ *  the binder global data of the current task from task TLS.
+ *
+ ****************************************************************************/
+
+ProcessGlobal* ProcessGlobal_lookup(void);
+
+/****************************************************************************
+ * Name: ProcessGlobal_dumpSlabStats
+ *
+ * Description:
+ *     Print the statistics of the slab caches of the current process.
+ *
+ ****************************************************************************/
+
+void ProcessGlobal_dumpSlabStats(int fd);
+
 /****************************************************************************
  * Name: ProcessGlobal_get
  *
  * Description:
  *
  ****************************************************************************/
-ProcessGlobal* ProcessGlobal_get(void);
+
+static inline ProcessGlobal* ProcessGlobal_get(void)
+{
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+    ProcessGlobal* global = gProcessGlobalCache;
+
+    if (global) {
+        return global;
+    }
+#endif
+    return ProcessGlobal_lookup();
+}
 
 static inline ProcessState_global* ProcessState_global_get(void)
 {
@@ -161,4 +288,19 @@ static inline IAIDLServiceManager_global* IAIDLServiceManager_global_get(void)
     return &(ProcessGlobal_get()->gIAIDLServiceManager_global);
 }
 
+static inline Slab_global* Slab_global_get(void)
+{
+    return &(ProcessGlobal_get()->gSlab_global);
+}
+
+static inline BinderThread_global* BinderThread_global_get(void)
+{
+    return &(ProcessGlobal_get()->gBinderThread_global);
+}
+
+static inline ObituaryExecutor_global* ObituaryExecutor_global_get(void)
+{
+    return &(ProcessGlobal_get()->gObituaryExecutor_global);
+}
+
 #endif /* __BINDER_INCLUDE_BINDER_PROCESSGLOBAL_H__ */
@@ -56,6 +56,14 @@
 #define DEFAULT_BINDER_VM_SIZE (4 * 1024)
 #define DEFAULT_MAX_BINDER_THREADS 2
 
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+static _Thread_local ProcessState* gProcessStateCache;
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -156,14 +164,17 @@ static void ProcessState_setCallRestriction(ProcessState* this, int restriction)
 
 static handle_entry* ProcessState_lookupHandleLocked(ProcessState* this, int32_t handle)
 {
-    const size_t N = this->mHandleToObject.size(&this->mHandleToObject);
-    if (N <= (size_t)handle) {
-        handle_entry* e = zalloc(sizeof(handle_entry));
-        e->binder = NULL;
-        e->refs = NULL;
-        int32_t err = this->mHandleToObject.append(&this->mHandleToObject, (void*)e, handle + 1 - N);
-        if (err < STATUS_OK)
+    SlabCache* cache = &Slab_global_get()->sHandleEntry;
+    size_t N = this->mHandleToObject.size(&this->mHandleToObject);
+
+    /* every handle needs its own entry, the slab hands them out zeroed */
+
+    for (; N <= (size_t)handle; N++) {
+        handle_entry* e = SlabCache_alloc(cache);
+        if (e == NULL || this->mHandleToObject.append(&this->mHandleToObject, (void*)e, 1) < STATUS_OK) {
+            SlabCache_free(cache, e);
             return NULL;
+        }
     }
     return this->mHandleToObject.editItemAt(&this->mHandleToObject, handle);
 }
@@ -271,7 +282,10 @@ static void ProcessState_spawnPooledThread(ProcessState* this, bool isMain)
         char name[32];
         this->makeBinderThreadName(this, name, 32);
         BinderThread* t = (BinderThread*)IPCThreadPool_new(isMain);
-        t->run(t, name, SCHED_PRIORITY_DEFAULT, CONFIG_DEFAULT_TASK_STACKSIZE);
+        pthread_mutex_lock(&this->mThreadCountLock);
+        this->mThreadPoolStats.threadsSpawned++;
+        pthread_mutex_unlock(&this->mThreadCountLock);
+        t->run(t, name, SCHED_PRIORITY_DEFAULT, this->mThreadStackSize);
     }
 }
 
@@ -280,8 +294,17 @@ static int32_t ProcessState_setThreadPoolMaxThreadCount(ProcessState* this, int
     LOG_FATAL_IF(this->mThreadPoolStarted && maxThreads < this->mMaxThreads,
         "Binder threadpool cannot be shrunk after starting");
     int32_t result = STATUS_OK;
+    uint32_t driverMax;
 
-    if (ioctl(this->mDriverFD, BINDER_SET_MAX_THREADS, &maxThreads) != -1) {
+    /* The driver counts every thread it asked for and never forgets the
+     * ones that retired, give it back that headroom.
+     */
+
+    pthread_mutex_lock(&this->mThreadCountLock);
+    driverMax = maxThreads + this->mThreadPoolStats.threadsRetired;
+    pthread_mutex_unlock(&this->mThreadCountLock);
+
+    if (ioctl(this->mDriverFD, BINDER_SET_MAX_THREADS, &driverMax) != -1) {
         this->mMaxThreads = maxThreads;
     } else {
         result = -errno;
@@ -290,6 +313,13 @@ static int32_t ProcessState_setThreadPoolMaxThreadCount(ProcessState* this, int
     return result;
 }
 
+static void ProcessState_getThreadPoolStats(ProcessState* this, ThreadPoolStats* stats)
+{
+    pthread_mutex_lock(&this->mThreadCountLock);
+    *stats = this->mThreadPoolStats;
+    pthread_mutex_unlock(&this->mThreadCountLock);
+}
+
 static const char* ProcessState_getDriverName(ProcessState* this)
 {
     return this->mDriverName;
@@ -321,6 +351,11 @@ void ProcessState_forceIncStrong(ProcessState* this, const void* id)
 
 static void ProcessState_dtor(ProcessState* this)
 {
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+    if (gProcessStateCache == this) {
+        gProcessStateCache = NULL;
+    }
+#endif
     pthread_key_delete(this->mTLS);
 
     if (this->mDriverFD >= 0) {
@@ -350,6 +385,8 @@ static void ProcessState_ctor(ProcessState* this, const char* driver)
     this->mMaxThreads = DEFAULT_MAX_BINDER_THREADS;
     this->mCurrentThreads = 0;
     this->mKernelStartedThreads = 0;
+    this->mThreadStackSize = CONFIG_BINDER_LIB_THREAD_STACKSIZE;
+    memset(&this->mThreadPoolStats, 0, sizeof(this->mThreadPoolStats));
     this->mContextObject = 0;
 
     atomic_init(&this->mShutdown, false);
@@ -374,6 +411,7 @@ static void ProcessState_ctor(ProcessState* this, const char* driver)
     this->becomeContextManager = ProcessState_becomeContextManager;
     this->startThreadPool = ProcessState_startThreadPool;
     this->setThreadPoolMaxThreadCount = ProcessState_setThreadPoolMaxThreadCount;
+    this->getThreadPoolStats = ProcessState_getThreadPoolStats;
 
     pthread_key_create(&this->mTLS, IPCThreadState_threadDestructor);
 
@@ -426,6 +464,9 @@ static ProcessState* ProcessState_init(const char* driver)
     }
     pthread_mutex_unlock(&global->gProcessMutex);
 
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+    gProcessStateCache = global->gProcessState;
+#endif
     return global->gProcessState;
 }
 
@@ -446,5 +487,12 @@ ProcessState* ProcessState_initWithDriver(const char* driver)
 
 ProcessState* ProcessState_self(void)
 {
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+    ProcessState* proc = gProcessStateCache;
+
+    if (proc) {
+        return proc;
+    }
+#endif
     return ProcessState_init("/dev/binder");
 }
@@ -44,6 +44,19 @@ struct handle_entry {
 
 typedef struct handle_entry handle_entry;
 
+/* Thread pool bookkeeping, protected by ProcessState::mThreadCountLock */
+
+struct ThreadPoolStats {
+    size_t threadsSpawned;
+    size_t threadsRetired;
+    size_t peakThreads;
+    int64_t totalLifetimeMs;
+    int64_t maxLifetimeMs;
+    size_t reclaimedStackBytes;
+};
+
+typedef struct ThreadPoolStats ThreadPoolStats;
+
 struct ProcessState;
 typedef struct ProcessState ProcessState;
 
@@ -71,6 +84,7 @@ struct ProcessState {
     void (*setCallRestriction)(ProcessState* this, int restriction);
     void (*makeBinderThreadName)(ProcessState* this, char* name, int namelen);
     handle_entry* (*lookupHandleLocked)(ProcessState* this, int32_t handle);
+    void (*getThreadPoolStats)(ProcessState* this, ThreadPoolStats* stats);
 
     /* data for process context */
 
@@ -89,6 +103,8 @@ struct ProcessState {
     size_t mCurrentThreads;
     size_t mKernelStartedThreads;
     int64_t mStarvationStartTimeMs;
+    size_t mThreadStackSize;
+    ThreadPoolStats mThreadPoolStats;
 
     /*mLock: protects everything below */
 
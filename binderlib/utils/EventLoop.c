@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "EventLoop"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "utils/Binderlog.h"
+#include "utils/EventLoop.h"
+#include <android/binder_status.h>
+
+static EventLoopFd* EventLoop_findFd(EventLoop* this, int fd)
+{
+    size_t size = this->mFds.size(&this->mFds);
+
+    for (size_t i = 0; i < size; i++) {
+        EventLoopFd* handler = this->mFds.get(&this->mFds, i);
+
+        if (handler->fd == fd && !handler->removed) {
+            return handler;
+        }
+    }
+    return NULL;
+}
+
+static int32_t EventLoop_addFd(EventLoop* this, int fd, uint32_t events,
+    EventLoop_fdCallback callback, void* data)
+{
+    struct epoll_event ev;
+    EventLoopFd* handler;
+
+    if (fd < 0 || callback == NULL || EventLoop_findFd(this, fd) != NULL) {
+        return STATUS_BAD_VALUE;
+    }
+
+    handler = zalloc(sizeof(EventLoopFd));
+    if (handler == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+    handler->fd = fd;
+    handler->callback = callback;
+    handler->data = data;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = handler;
+    if (epoll_ctl(this->mEpollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        BINDER_LOGE("Could not watch fd %d: %d\n", fd, errno);
+        free(handler);
+        return -errno;
+    }
+
+    this->mFds.push(&this->mFds, handler);
+    return STATUS_OK;
+}
+
+/* The handler may still sit in the events of the running wake-up, so it
+ * is only marked here and freed once those are handled.
+ */
+
+static int32_t EventLoop_removeFd(EventLoop* this, int fd)
+{
+    EventLoopFd* handler = EventLoop_findFd(this, fd);
+
+    if (handler == NULL) {
+        return STATUS_NAME_NOT_FOUND;
+    }
+
+    epoll_ctl(this->mEpollFd, EPOLL_CTL_DEL, fd, NULL);
+    handler->removed = true;
+    return STATUS_OK;
+}
+
+static void EventLoop_reapFds(EventLoop* this)
+{
+    for (int i = this->mFds.size(&this->mFds) - 1; i >= 0; i--) {
+        EventLoopFd* handler = this->mFds.get(&this->mFds, i);
+
+        if (handler->removed) {
+            this->mFds.removeAt(&this->mFds, i);
+            free(handler);
+        }
+    }
+}
+
+static void EventLoop_insertTimer(EventLoop* this, EventLoopTimer* timer)
+{
+    EventLoopTimer** link = &this->mTimers;
+
+    while (*link != NULL && (*link)->deadline <= timer->deadline) {
+        link = &(*link)->next;
+    }
+    timer->next = *link;
+    *link = timer;
+}
+
+static void EventLoop_unlinkTimer(EventLoop* this, EventLoopTimer* timer)
+{
+    EventLoopTimer** link = &this->mTimers;
+
+    while (*link != NULL && *link != timer) {
+        link = &(*link)->next;
+    }
+    if (*link != NULL) {
+        *link = timer->next;
+        timer->next = NULL;
+    }
+}
+
+/* Point the timerfd at the earliest deadline, or disarm it */
+
+static void EventLoop_armTimers(EventLoop* this)
+{
+    struct itimerspec spec;
+
+    if (this->mTimerFd < 0) {
+        return;
+    }
+
+    memset(&spec, 0, sizeof(spec));
+    if (this->mTimers != NULL) {
+        nsecs_t deadline = this->mTimers->deadline;
+
+        /* An all zero it_value disarms, keep a due deadline armed */
+
+        if (deadline <= 0) {
+            deadline = 1;
+        }
+        spec.it_value.tv_sec = deadline / 1000000000LL;
+        spec.it_value.tv_nsec = deadline % 1000000000LL;
+    }
+
+    if (timerfd_settime(this->mTimerFd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        BINDER_LOGE("Could not arm timerfd: %d\n", errno);
+    }
+}
+
+static void EventLoop_fireTimers(EventLoop* this)
+{
+    nsecs_t now = uptimeNanos();
+
+    while (this->mTimers != NULL && this->mTimers->deadline <= now) {
+        EventLoopTimer* timer = this->mTimers;
+
+        this->mTimers = timer->next;
+        timer->next = NULL;
+
+        this->mFiring = timer;
+        timer->callback(timer->data);
+        this->mFiring = NULL;
+
+        if (timer->cancelled || timer->interval == 0) {
+            free(timer);
+            continue;
+        }
+
+        /* Keep the period, unless the callback overran it */
+
+        timer->deadline += timer->interval;
+        if (timer->deadline <= now) {
+            timer->deadline = now + timer->interval;
+        }
+        this->insertTimer(this, timer);
+    }
+
+    this->armTimers(this);
+}
+
+static void EventLoop_handleTimerFd(int fd, uint32_t events, void* data)
+{
+    EventLoop* this = data;
+    uint64_t expirations;
+
+    (void)events;
+    while (read(fd, &expirations, sizeof(expirations)) > 0) {
+    }
+    this->fireTimers(this);
+}
+
+static EventLoopTimer* EventLoop_addTimer(EventLoop* this, int64_t delayMs, int64_t intervalMs,
+    EventLoop_timerCallback callback, void* data)
+{
+    EventLoopTimer* timer;
+
+    if (callback == NULL || delayMs < 0 || intervalMs < 0) {
+        return NULL;
+    }
+
+    timer = zalloc(sizeof(EventLoopTimer));
+    if (timer == NULL) {
+        return NULL;
+    }
+    timer->deadline = uptimeNanos() + milliseconds_to_nanoseconds(delayMs);
+    timer->interval = milliseconds_to_nanoseconds(intervalMs);
+    timer->callback = callback;
+    timer->data = data;
+
+    this->insertTimer(this, timer);
+    if (this->mTimers == timer) {
+        this->armTimers(this);
+    }
+    return timer;
+}
+
+static void EventLoop_cancelTimer(EventLoop* this, EventLoopTimer* timer)
+{
+    if (timer == NULL) {
+        return;
+    }
+
+    /* A timer cancelling itself is freed by fireTimers() */
+
+    if (timer == this->mFiring) {
+        timer->cancelled = true;
+        return;
+    }
+
+    bool wasFirst = this->mTimers == timer;
+
+    EventLoop_unlinkTimer(this, timer);
+    free(timer);
+    if (wasFirst) {
+        this->armTimers(this);
+    }
+}
+
+static int32_t EventLoop_runOnce(EventLoop* this, int timeoutMs)
+{
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    int numEvents;
+
+    if (this->mTimerFd < 0 && this->mTimers != NULL) {
+        int delay = toMillisecondTimeoutDelay(uptimeNanos(), this->mTimers->deadline);
+
+        if (timeoutMs < 0 || delay < timeoutMs) {
+            timeoutMs = delay;
+        }
+    }
+
+    numEvents = epoll_wait(this->mEpollFd, events, EVENT_LOOP_MAX_EVENTS, timeoutMs);
+    if (numEvents < 0) {
+        if (errno == EINTR) {
+            return STATUS_OK;
+        }
+        BINDER_LOGE("epoll_wait failed: %d\n", errno);
+        return -errno;
+    }
+
+    for (int i = 0; i < numEvents; i++) {
+        EventLoopFd* handler = events[i].data.ptr;
+
+        if (!handler->removed) {
+            handler->callback(handler->fd, events[i].events, handler->data);
+        }
+    }
+    EventLoop_reapFds(this);
+
+    if (this->mTimerFd < 0) {
+        this->fireTimers(this);
+    }
+    return STATUS_OK;
+}
+
+static int32_t EventLoop_run(EventLoop* this)
+{
+    int32_t status = STATUS_OK;
+
+    this->mQuit = false;
+    while (!this->mQuit && status == STATUS_OK) {
+        status = this->runOnce(this, -1);
+    }
+    return status;
+}
+
+static void EventLoop_quit(EventLoop* this)
+{
+    this->mQuit = true;
+}
+
+static void EventLoop_dtor(EventLoop* this)
+{
+    while (this->mTimers != NULL) {
+        EventLoopTimer* timer = this->mTimers;
+
+        this->mTimers = timer->next;
+        free(timer);
+    }
+
+    for (size_t i = 0; i < this->mFds.size(&this->mFds); i++) {
+        free(this->mFds.get(&this->mFds, i));
+    }
+    this->mFds.dtor(&this->mFds);
+
+    if (this->mTimerFd >= 0) {
+        close(this->mTimerFd);
+    }
+    if (this->mEpollFd >= 0) {
+        close(this->mEpollFd);
+    }
+}
+
+static int32_t EventLoop_ctor(EventLoop* this)
+{
+    this->dtor = EventLoop_dtor;
+    this->addFd = EventLoop_addFd;
+    this->removeFd = EventLoop_removeFd;
+    this->addTimer = EventLoop_addTimer;
+    this->cancelTimer = EventLoop_cancelTimer;
+    this->runOnce = EventLoop_runOnce;
+    this->run = EventLoop_run;
+    this->quit = EventLoop_quit;
+    this->insertTimer = EventLoop_insertTimer;
+    this->armTimers = EventLoop_armTimers;
+    this->fireTimers = EventLoop_fireTimers;
+
+    VectorImpl_ctor(&this->mFds);
+    this->mTimers = NULL;
+    this->mFiring = NULL;
+    this->mQuit = false;
+    this->mTimerFd = -1;
+
+    this->mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (this->mEpollFd < 0) {
+        BINDER_LOGE("Could not create epoll: %d\n", errno);
+        return -errno;
+    }
+
+    /* uptimeNanos() is CLOCK_MONOTONIC, so deadlines arm it as they are */
+
+    this->mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (this->mTimerFd < 0) {
+        BINDER_LOGW("No timerfd (%d), timers run off the epoll_wait timeout\n", errno);
+    } else if (this->addFd(this, this->mTimerFd, EPOLLIN, EventLoop_handleTimerFd, this)
+        != STATUS_OK) {
+        close(this->mTimerFd);
+        this->mTimerFd = -1;
+    }
+    return STATUS_OK;
+}
+
+EventLoop* EventLoop_new(void)
+{
+    EventLoop* this;
+
+    this = zalloc(sizeof(EventLoop));
+    if (this == NULL) {
+        return NULL;
+    }
+    if (EventLoop_ctor(this) != STATUS_OK) {
+        EventLoop_delete(this);
+        return NULL;
+    }
+    return this;
+}
+
+void EventLoop_delete(EventLoop* this)
+{
+    this->dtor(this);
+    free(this);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BINDER_INCLUDE_UTILS_EVENTLOOP_H__
+#define __BINDER_INCLUDE_UTILS_EVENTLOOP_H__
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utils/Timers.h"
+#include "utils/Vector.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Ready fds taken from one epoll_wait() */
+
+#define EVENT_LOOP_MAX_EVENTS 8
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Single-threaded loop over epoll: fd handlers and timers, all called
+ * from run() on the thread that owns the loop. Timers are kept sorted
+ * by deadline and share one timerfd armed for the earliest of them.
+ */
+
+typedef void (*EventLoop_fdCallback)(int fd, uint32_t events, void* data);
+typedef void (*EventLoop_timerCallback)(void* data);
+
+struct EventLoopFd;
+typedef struct EventLoopFd EventLoopFd;
+
+struct EventLoopFd {
+    int fd;
+    bool removed; /* Freed after the events of this wake-up are handled */
+    EventLoop_fdCallback callback;
+    void* data;
+};
+
+struct EventLoopTimer;
+typedef struct EventLoopTimer EventLoopTimer;
+
+struct EventLoopTimer {
+    EventLoopTimer* next;
+    nsecs_t deadline; /* uptimeNanos() */
+    nsecs_t interval; /* 0 for a one shot timer */
+    bool cancelled;
+    EventLoop_timerCallback callback;
+    void* data;
+};
+
+struct EventLoop;
+typedef struct EventLoop EventLoop;
+
+struct EventLoop {
+    void (*dtor)(EventLoop* this);
+
+    /* events are EPOLL* bits, one handler per fd */
+    int32_t (*addFd)(EventLoop* this, int fd, uint32_t events,
+        EventLoop_fdCallback callback, void* data);
+    int32_t (*removeFd)(EventLoop* this, int fd);
+
+    /* Fires delayMs from now, then every intervalMs unless that is 0.
+     * The timer stays valid until cancelled or, if one shot, fired.
+     */
+    EventLoopTimer* (*addTimer)(EventLoop* this, int64_t delayMs, int64_t intervalMs,
+        EventLoop_timerCallback callback, void* data);
+    void (*cancelTimer)(EventLoop* this, EventLoopTimer* timer);
+
+    /* Waits up to timeoutMs (-1 forever) and handles what is ready */
+    int32_t (*runOnce)(EventLoop* this, int timeoutMs);
+    /* runOnce() until quit() or an error */
+    int32_t (*run)(EventLoop* this);
+    void (*quit)(EventLoop* this);
+
+    /* Member function */
+    void (*insertTimer)(EventLoop* this, EventLoopTimer* timer);
+    void (*armTimers)(EventLoop* this);
+    void (*fireTimers)(EventLoop* this);
+
+    int mEpollFd;
+    int mTimerFd; /* -1 without timerfd, epoll_wait() times out instead */
+    VectorImpl mFds; /* EventLoopFd* */
+    EventLoopTimer* mTimers; /* Sorted by deadline */
+    EventLoopTimer* mFiring;
+    bool mQuit;
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+EventLoop* EventLoop_new(void);
+void EventLoop_delete(EventLoop* this);
+
+#endif /* __BINDER_INCLUDE_UTILS_EVENTLOOP_H__ */
@@ -40,9 +40,10 @@
 #include "utils/BinderString.h"
 #include "utils/Binderlog.h"
 #include "utils/HashMap.h"
+#include "utils/StringArena.h"
 #include <android/binder_status.h>
 
-/* start with 4 buckets */
+/* start with 4 slots */
 #define HASHMAP_MIN_CAP_BITS 2
 
 static bool hashmap_needs_to_grow(HashMapBase* this)
@@ -51,101 +52,223 @@ static bool hashmap_needs_to_grow(HashMapBase* this)
     return (this->capacity == 0) || ((this->size + 1) * 4 / 3 > this->capacity);
 }
 
-static void hashmap_add_entry(HashMap_Entry** pprev,
-    HashMap_Entry* entry)
+static size_t HashMapBase_hash(void* this, long key)
+{
+    return key;
+}
+
+static bool HashMapBase_equal(void* this, long key1, long key2)
 {
-    entry->next = *pprev;
-    *pprev = entry;
+    return key1 == key2;
+}
+
+/* integer keys are the common case, call the default hash/equal inline */
+
+static inline size_t hashmap_hash(HashMapBase* this, long key)
+{
+    if (this->hash == HashMapBase_hash)
+        return (size_t)key;
+    return this->hash(this, key);
 }
 
-static void hashmap_del_entry(HashMap_Entry** pprev,
-    HashMap_Entry* entry)
+static inline bool hashmap_equal(HashMapBase* this, long key1, long key2)
 {
-    *pprev = entry->next;
-    entry->next = NULL;
+    if (this->equal == HashMapBase_equal)
+        return key1 == key2;
+    return this->equal(this, key1, key2);
 }
 
-static bool hashmap_find_entry(HashMapBase* this,
-    const long key, size_t hash,
-    HashMap_Entry*** pprev,
-    HashMap_Entry** entry)
+static bool hashmap_find_slot(HashMapBase* this,
+    const long key, size_t hash, size_t* slot)
 {
-    HashMap_Entry *cur, **prev_ptr;
+    size_t mask, i;
+    unsigned int dist;
 
-    if (!this->buckets)
+    if (this->size == 0)
         return false;
 
-    for (prev_ptr = &this->buckets[hash], cur = *prev_ptr;
-         cur;
-         prev_ptr = &cur->next, cur = cur->next) {
-        if (this->equal((void*)this, cur->key, key)) {
-            if (pprev)
-                *pprev = prev_ptr;
-            *entry = cur;
+    mask = this->capacity - 1;
+    i = hash_bits(hash, this->cap_bits);
+
+    for (dist = 1;; dist++, i = (i + 1) & mask) {
+        /* an empty slot, or an entry closer to its home than we are to
+         * ours, ends the probe: robin hood would have placed key here.
+         */
+        if (this->meta[i] < dist)
+            return false;
+
+        if (this->meta[i] == dist && this->entries[i].hash == hash
+            && hashmap_equal(this, this->entries[i].key, key)) {
+            *slot = i;
             return true;
         }
     }
-
-    return false;
 }
 
-static int hashmap_grow(HashMapBase* this)
+/* Robin hood insert: the entry takes the first slot whose occupant is
+ * closer to its home, and the rest of that cluster shifts one slot on.
+ * Returns -E2BIG, leaving the table untouched, if any probe distance
+ * would overflow the metadata byte.
+ */
+
+static int hashmap_place(HashMapBase* this, const HashMap_Entry* entry)
 {
-    HashMap_Entry** new_buckets;
-    HashMap_Entry* cur;
-    HashMap_Entry* tmp;
-    size_t new_cap_bits, new_cap;
-    size_t h, bkt;
+    size_t mask, i, j, prev;
+    unsigned int dist;
 
-    new_cap_bits = this->cap_bits + 1;
-    if (new_cap_bits < HASHMAP_MIN_CAP_BITS)
-        new_cap_bits = HASHMAP_MIN_CAP_BITS;
+    mask = this->capacity - 1;
+    i = hash_bits(entry->hash, this->cap_bits);
+
+    for (dist = 1; this->meta[i] >= dist; dist++, i = (i + 1) & mask) {
+        if (dist == HASHMAP_MAX_PROBE)
+            return -E2BIG;
+    }
+
+    for (j = i; this->meta[j] != HASHMAP_SLOT_EMPTY; j = (j + 1) & mask) {
+        if (this->meta[j] == HASHMAP_MAX_PROBE)
+            return -E2BIG;
+    }
+
+    for (; j != i; j = prev) {
+        prev = (j - 1) & mask;
+        this->entries[j] = this->entries[prev];
+        this->meta[j] = this->meta[prev] + 1;
+    }
+
+    this->entries[i] = *entry;
+    this->meta[i] = dist;
+    return 0;
+}
+
+static int hashmap_resize(HashMapBase* this, size_t new_cap_bits)
+{
+    HashMap_Entry* old_entries = this->entries;
+    uint8_t* old_meta = this->meta;
+    size_t old_cap = this->capacity;
+    size_t old_cap_bits = this->cap_bits;
+    size_t new_cap, i;
 
     new_cap = 1UL << new_cap_bits;
-    new_buckets = calloc(new_cap, sizeof(new_buckets[0]));
-    if (!new_buckets)
+    this->entries = calloc(new_cap, sizeof(HashMap_Entry) + sizeof(uint8_t));
+    if (!this->entries) {
+        this->entries = old_entries;
         return -ENOMEM;
-
-    HashMap_for_each_entry_safe(this, cur, tmp, bkt)
-    {
-        h = hash_bits(this->hash(this, cur->key), new_cap_bits);
-        hashmap_add_entry(&new_buckets[h], cur);
     }
 
+    this->meta = (uint8_t*)(this->entries + new_cap);
     this->capacity = new_cap;
     this->cap_bits = new_cap_bits;
-    free(this->buckets);
-    this->buckets = new_buckets;
 
+    for (i = 0; i < old_cap; i++) {
+        if (old_meta[i] != HASHMAP_SLOT_EMPTY
+            && hashmap_place(this, &old_entries[i]) < 0) {
+            free(this->entries);
+            this->entries = old_entries;
+            this->meta = old_meta;
+            this->capacity = old_cap;
+            this->cap_bits = old_cap_bits;
+            return -E2BIG;
+        }
+    }
+
+    free(old_entries);
     return 0;
 }
 
-static size_t HashMapBase_hash(void* this, long key)
+/* a probe longer than HASHMAP_MAX_PROBE only happens with heavily
+ * colliding hashes; growing up to 2^3 times sparser than the load factor
+ * spreads distinct hashes, but identical ones never fit and fail instead
+ */
+#define HASHMAP_MAX_SPARSE_BITS 3
+
+static bool hashmap_may_grow(HashMapBase* this, size_t cap_bits)
 {
-    return key;
+    return ((1UL << cap_bits) >> HASHMAP_MAX_SPARSE_BITS) <= this->size + 1;
 }
 
-static bool HashMapBase_equal(void* this, long key1, long key2)
+static int hashmap_grow(HashMapBase* this)
 {
-    return key1 == key2;
+    size_t new_cap_bits;
+    int err;
+
+    new_cap_bits = this->cap_bits + 1;
+    if (new_cap_bits < HASHMAP_MIN_CAP_BITS)
+        new_cap_bits = HASHMAP_MIN_CAP_BITS;
+
+    do {
+        err = hashmap_resize(this, new_cap_bits++);
+    } while (err == -E2BIG && hashmap_may_grow(this, new_cap_bits));
+
+    return err;
+}
+
+static void hashmap_del_slot(HashMapBase* this, size_t i)
+{
+    size_t mask = this->capacity - 1;
+    size_t next = (i + 1) & mask;
+
+    /* backward shift: pull the following entries of the cluster one slot
+     * closer to home, so no tombstones are needed
+     */
+    while (this->meta[next] > 1) {
+        this->entries[i] = this->entries[next];
+        this->meta[i] = this->meta[next] - 1;
+        i = next;
+        next = (next + 1) & mask;
+    }
+
+    this->meta[i] = HASHMAP_SLOT_EMPTY;
+}
+
+/* String keys: lookups hash the caller's String once, the stored hash
+ * and length reject mismatches before any byte compare
+ */
+
+static inline size_t HashMap_String_length(const String* str)
+{
+    return strnlen(str->mData, sizeof(str->mData));
 }
 
 static size_t HashMap_String_hash(void* this, long key)
 {
-    return str_hash(((String*)key)->mData);
+    const String* str = (const String*)key;
+    size_t h = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(str->mData) && str->mData[i]; i++) {
+        h = h * 31 + str->mData[i];
+    }
+    return h;
 }
 
 static bool HashMap_String_equal(void* this, long key1, long key2)
 {
-    return strcmp(((String*)key1)->mData, ((String*)key2)->mData) == 0;
+    const ArenaString* stored = (const ArenaString*)key1;
+    const String* str = (const String*)key2;
+
+    return stored->mSize == HashMap_String_length(str)
+        && memcmp(stored->mData, str->mData, stored->mSize) == 0;
+}
+
+static long HashMap_String_keyDup(HashMapBase* this, long key)
+{
+    const String* str = (const String*)key;
+
+    return (long)StringArena_intern(&((HashMap*)this)->mKeys,
+        str->mData, HashMap_String_length(str));
+}
+
+static void HashMap_String_keyFree(HashMapBase* this, long key)
+{
+    StringArena_release(&((HashMap*)this)->mKeys, (const ArenaString*)key);
 }
 
 static int HashMapBase_insert(HashMapBase* this, long key, long value,
     enum hashmap_insert_strategy strategy,
     long* old_key, long* old_value)
 {
-    HashMap_Entry* entry;
-    size_t h;
+    HashMap_Entry entry;
+    size_t h, slot;
     int err;
 
     if (old_key)
@@ -153,16 +276,18 @@ static int HashMapBase_insert(HashMapBase* this, long key, long value,
     if (old_value)
         *old_value = 0;
 
-    h = hash_bits(this->hash(this, key), this->cap_bits);
-    if (strategy != HASHMAP_APPEND && hashmap_find_entry(this, key, h, NULL, &entry)) {
+    h = hashmap_hash(this, key);
+    if (strategy != HASHMAP_APPEND && hashmap_find_slot(this, key, h, &slot)) {
         if (old_key)
-            *old_key = entry->key;
+            *old_key = this->entries[slot].key;
         if (old_value)
-            *old_value = entry->value;
+            *old_value = this->entries[slot].value;
 
         if (strategy == HASHMAP_SET || strategy == HASHMAP_UPDATE) {
-            entry->key = key;
-            entry->value = value;
+            /* an owned key stays, it is equal to the new one anyway */
+            if (!this->keyDup)
+                this->entries[slot].key = key;
+            this->entries[slot].value = value;
             return 0;
         } else if (strategy == HASHMAP_ADD) {
             return -EEXIST;
@@ -176,38 +301,53 @@ static int HashMapBase_insert(HashMapBase* this, long key, long value,
         err = hashmap_grow(this);
         if (err)
             return err;
-        h = hash_bits(this->hash(this, key), this->cap_bits);
     }
 
-    entry = malloc(sizeof(struct HashMap_Entry));
-    if (!entry)
-        return -ENOMEM;
+    entry.key = key;
+    entry.value = value;
+    entry.hash = h;
 
-    entry->key = key;
-    entry->value = value;
-    hashmap_add_entry(&this->buckets[h], entry);
-    this->size++;
+    if (this->keyDup) {
+        entry.key = this->keyDup(this, key);
+        if (!entry.key)
+            return -ENOMEM;
+    }
+
+    if (hashmap_place(this, &entry) < 0) {
+        err = -E2BIG;
+        if (hashmap_may_grow(this, this->cap_bits + 1))
+            err = hashmap_grow(this);
+        if (err == 0)
+            err = hashmap_place(this, &entry);
+        if (err) {
+            BINDER_LOGE("HashMap insert failed, too many colliding keys: %d\n", err);
+            if (this->keyFree)
+                this->keyFree(this, entry.key);
+            return err;
+        }
+    }
 
+    this->size++;
     return 0;
 }
 
 static bool HashMapBase_delete(HashMapBase* this, long key,
     long* old_key, long* old_value)
 {
-    HashMap_Entry **pprev, *entry;
-    size_t h;
+    size_t slot;
 
-    h = hash_bits(this->hash(this, key), this->cap_bits);
-    if (!hashmap_find_entry(this, key, h, &pprev, &entry))
+    if (!hashmap_find_slot(this, key, hashmap_hash(this, key), &slot))
         return false;
 
+    /* an owned key is released here, don't hand it out */
     if (old_key)
-        *old_key = entry->key;
+        *old_key = this->keyFree ? 0 : this->entries[slot].key;
     if (old_value)
-        *old_value = entry->value;
+        *old_value = this->entries[slot].value;
 
-    hashmap_del_entry(pprev, entry);
-    free(entry);
+    if (this->keyFree)
+        this->keyFree(this, this->entries[slot].key);
+    hashmap_del_slot(this, slot);
     this->size--;
 
     return true;
@@ -215,60 +355,64 @@ static bool HashMapBase_delete(HashMapBase* this, long key,
 
 static bool HashMapBase_find(HashMapBase* this, long key, long* value)
 {
-    HashMap_Entry* entry;
-    size_t h;
+    size_t slot;
 
-    h = hash_bits(this->hash(this, key), this->cap_bits);
-    if (!hashmap_find_entry(this, key, h, NULL, &entry))
+    if (!hashmap_find_slot(this, key, hashmap_hash(this, key), &slot))
         return false;
 
     if (value)
-        *value = entry->value;
+        *value = this->entries[slot].value;
     return true;
 }
 
 static void HashMapBase_iterator(HashMapBase* this, HashMap_Entry_Callback callback)
 {
     HashMap_Entry* cur;
-    HashMap_Entry* tmp;
     size_t bkt;
 
-    HashMap_for_each_entry_safe(this, cur, tmp, bkt)
+    HashMap_for_each_entry(this, cur, bkt)
     {
         callback(cur->pkey, cur->pvalue);
     }
 }
 
-static void HashMapBase_clear(HashMapBase* this)
+static void hashmap_free_keys(HashMapBase* this)
 {
     HashMap_Entry* cur;
-    HashMap_Entry* tmp;
     size_t bkt;
 
-    HashMap_for_each_entry_safe(this, cur, tmp, bkt)
+    if (!this->keyFree)
+        return;
+
+    HashMap_for_each_entry(this, cur, bkt)
     {
-        this->delete (this, cur->key, NULL, NULL);
+        this->keyFree(this, cur->key);
     }
 }
 
-static void HashMapBase_dtor(HashMapBase* this)
+static void HashMapBase_clear(HashMapBase* this)
 {
-    HashMap_Entry* cur;
-    HashMap_Entry* tmp;
-    size_t bkt;
+    /* keep the slot array, the map is usually refilled to a similar size */
 
-    HashMap_for_each_entry_safe(this, cur, tmp, bkt)
-    {
-        free(cur);
+    hashmap_free_keys(this);
+    if (this->meta) {
+        memset(this->meta, HASHMAP_SLOT_EMPTY, this->capacity);
     }
-    if (this->buckets) {
-        free(this->buckets);
+    this->size = 0;
+}
+
+static void HashMapBase_dtor(HashMapBase* this)
+{
+    hashmap_free_keys(this);
+    if (this->entries) {
+        free(this->entries);
     }
 }
 
 void HashMapBase_ctor(HashMapBase* this)
 {
-    this->buckets = NULL;
+    this->entries = NULL;
+    this->meta = NULL;
     this->capacity = 0;
     this->cap_bits = 0;
     this->size = 0;
@@ -283,6 +427,8 @@ void HashMapBase_ctor(HashMapBase* this)
 
     this->hash = HashMapBase_hash;
     this->equal = HashMapBase_equal;
+    this->keyDup = NULL;
+    this->keyFree = NULL;
 
     this->dtor = HashMapBase_dtor;
 }
@@ -303,7 +449,7 @@ static uint32_t HashMap_put(HashMap* this, long key, long value)
 {
     HashMapBase* base = &this->m_HashMap;
 
-    if (base->insert(base, key, value, HASHMAP_ADD, NULL, NULL) < 0) {
+    if (base->insert(base, key, value, HASHMAP_SET, NULL, NULL) < 0) {
         return STATUS_INVALID_OPERATION;
     }
     return STATUS_OK;
@@ -312,11 +458,8 @@ static uint32_t HashMap_put(HashMap* this, long key, long value)
 static uint32_t HashMap_erase(HashMap* this, long key)
 {
     HashMapBase* base = &this->m_HashMap;
-    long value;
 
-    value = this->get(this, key);
-    if (value != STATUS_NAME_NOT_FOUND) {
-        base->delete (base, (long)key, (long*)(&key), (long*)(&value));
+    if (base->delete (base, key, NULL, NULL)) {
         return STATUS_OK;
     } else {
         return STATUS_NAME_NOT_FOUND;
@@ -365,11 +508,13 @@ static uint32_t HashMap_size(HashMap* this)
 static void HashMap_dtor(HashMap* this)
 {
     this->m_HashMap.dtor(&this->m_HashMap);
+    StringArena_clear(&this->mKeys);
 }
 
 void HashMap_ctor(HashMap* this)
 {
     HashMapBase_ctor(&this->m_HashMap);
+    StringArena_init(&this->mKeys);
 
     this->get = HashMap_get;
     this->find = HashMap_find;
@@ -391,4 +536,6 @@ void HashMap_String_ctor(HashMap* this)
 
     this->m_HashMap.hash = HashMap_String_hash;
     this->m_HashMap.equal = HashMap_String_equal;
+    this->m_HashMap.keyDup = HashMap_String_keyDup;
+    this->m_HashMap.keyFree = HashMap_String_keyFree;
 }
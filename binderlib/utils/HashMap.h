@@ -24,6 +24,9 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#include "utils/StringArena.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -36,51 +39,25 @@ enum hashmap_insert_strategy {
     HASHMAP_APPEND,
 };
 
-/*
- * HashMap_for_each_entry - iterate over all entries in hashmap
- * @this: hashmap object to iterate
- * @cur:  HashMap_Entry * used as a loop cursor
- * @bkt:  integer used as a bucket loop cursor
+/* Slot metadata: 0 marks an empty slot, otherwise the probe distance
+ * from the home slot plus one.
  */
-#define HashMap_for_each_entry(this, cur, bkt) \
-    for (bkt = 0; bkt < this->capacity; bkt++) \
-        for (cur = this->buckets[bkt]; cur; cur = cur->next)
+#define HASHMAP_SLOT_EMPTY 0
+#define HASHMAP_MAX_PROBE UINT8_MAX
 
 /*
- * HashMap_for_each_entry_safe - iterate over all entries in hashmap,
- * safe against removals
+ * HashMap_for_each_entry - iterate over all entries in hashmap
  * @this: hashmap object to iterate
  * @cur:  HashMap_Entry * used as a loop cursor
- * @tmp:  HashMap_Entry * used as a temporary next cursor storage
- * @bkt:  integer used as a bucket loop cursor
- */
-#define HashMap_for_each_entry_safe(this, cur, tmp, bkt) \
-    for (bkt = 0; bkt < this->capacity; bkt++)           \
-        for (cur = this->buckets[bkt];                   \
-             cur && ({ tmp = cur->next;true; });                               \
-             cur = tmp)
-
-/*
- * HashMap_for_each_key_entry - iterate over entries associated with given key
- * @map: hashmap to iterate
- * @cur: HashMap_Entry* used as a loop cursor
- * @key: key to iterate entries for
+ * @bkt:  integer used as a slot loop cursor
+ *
+ * Entries live inline in the slot array and are moved on insert/delete,
+ * so the map must not be modified while iterating.
  */
-#define HashMap_for_each_key_entry(this, cur, _key)                               \
-    for (cur = this->buckets                                                      \
-             ? this->buckets[hash_bits(this->hash(this, (_key)), this->cap_bits)] \
-             : NULL;                                                              \
-         cur;                                                                     \
-         cur = cur->next)                                                         \
-        if (this->equal(this, cur->key, (_key)))
-
-#define HashMap_for_each_key_entrysafe(this, cur, tmp, _key)                      \
-    for (cur = this->buckets                                                      \
-             ? this->buckets[hash_bits(this->hash(this, (_key)), this->cap_bits)] \
-             : NULL;                                                              \
-         cur && ({ tmp = cur->next;true; });                                                            \
-         cur = tmp)                                                               \
-        if (this->equal(cur->key, (_key), this->ctx))
+#define HashMap_for_each_entry(this, cur, bkt)     \
+    for (bkt = 0; bkt < (this)->capacity; bkt++)   \
+        if ((this)->meta[bkt] != HASHMAP_SLOT_EMPTY \
+            && ((cur = &(this)->entries[bkt]), true))
 
 /****************************************************************************
  * Private Function
@@ -134,7 +111,8 @@ struct HashMap_Entry {
         void* pvalue;
     };
 
-    struct HashMap_Entry* next;
+    /* full hash of key, so probing and growing never rehash the key */
+    size_t hash;
 };
 
 typedef void (*HashMap_Entry_Callback)(const void* key, void* value);
@@ -157,7 +135,18 @@ struct HashMapBase {
     size_t (*hash)(void* this, long key);
     bool (*equal)(void* this, long key1, long key2);
 
-    struct HashMap_Entry** buckets;
+    /* optional key ownership: keyDup copies a new key on insert and
+     * keyFree releases it on delete/clear. equal() is then called with
+     * the stored copy first and the caller's key second.
+     */
+    long (*keyDup)(HashMapBase* this, long key);
+    void (*keyFree)(HashMapBase* this, long key);
+
+    /* open addressing with robin hood probing: one allocation holds
+     * the inline entries followed by one metadata byte per slot
+     */
+    HashMap_Entry* entries;
+    uint8_t* meta;
     size_t capacity;
     size_t cap_bits;
     size_t size;
@@ -181,8 +170,16 @@ struct HashMap {
     void (*clear)(HashMap* this);
     void (*iterator)(HashMap* this, HashMap_Entry_Callback cb);
     uint32_t (*size)(HashMap* this);
+
+    /* backing store of owned keys, used by HashMap_String */
+    StringArena mKeys;
 };
 
+/* HashMap_String is looked up with String* keys and copies each inserted
+ * name into its own arena, so callers may pass temporary Strings. Entries
+ * and iterator callbacks see the stored `const ArenaString*` key.
+ */
+
 void HashMap_String_ctor(HashMap* this);
 void HashMap_ctor(HashMap* this);
 
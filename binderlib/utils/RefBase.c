@@ -142,22 +142,13 @@ static void RefBase_weakref_impl_ctor(RefBase_weakref_impl* this, RefBase* base)
     this->dtor = RefBase_weakref_impl_dtor;
 }
 
-RefBase_weakref_impl* RefBase_weakref_impl_new(RefBase* base)
-{
-    RefBase_weakref_impl* this;
-    this = zalloc(sizeof(RefBase_weakref_impl));
-
-    RefBase_weakref_impl_ctor(this, base);
-    return this;
-}
+/* The counters are embedded in the object, whoever owns the object
+ * owns their memory too.
+ */
 
 void RefBase_weakref_impl_delete(RefBase_weakref_impl* this)
 {
-    BINDER_LOGE("need to check");
-    /*
     this->dtor(this);
-    free(this);
-    */
 }
 
 static RefBase* RefBase_weakref_refBase(RefBase_weakref* this)
@@ -334,12 +325,12 @@ static void RefBase_onLastWeakRef(RefBase* this, const void* id)
 
 static void RefBase_extendObjectLifetime(RefBase* this, int32_t mode)
 {
-    atomic_fetch_or_explicit(&this->mRefs->mFlags, mode, memory_order_relaxed);
+    atomic_fetch_or_explicit(&this->mRefs.mFlags, mode, memory_order_relaxed);
 }
 
 static void RefBase_incStrong(RefBase* this, const void* id)
 {
-    RefBase_weakref_impl* const refs = this->mRefs;
+    RefBase_weakref_impl* const refs = &this->mRefs;
 
     refs->incWeak(refs, id);
     refs->addStrongRef(refs, id);
@@ -360,7 +351,7 @@ static void RefBase_incStrong(RefBase* this, const void* id)
 
 static void RefBase_incStrongRequireStrong(RefBase* this, const void* id)
 {
-    RefBase_weakref_impl* const refs = this->mRefs;
+    RefBase_weakref_impl* const refs = &this->mRefs;
 
     refs->incWeak(refs, id);
     refs->addStrongRef(refs, id);
@@ -373,7 +364,7 @@ static void RefBase_incStrongRequireStrong(RefBase* this, const void* id)
 
 static void RefBase_decStrong(RefBase* this, const void* id)
 {
-    RefBase_weakref_impl* const refs = this->mRefs;
+    RefBase_weakref_impl* const refs = &this->mRefs;
 
     refs->removeStrongRef(refs, id);
 
@@ -394,7 +385,7 @@ static void RefBase_decStrong(RefBase* this, const void* id)
 
 void RefBase_forceIncStrong(RefBase* this, const void* id)
 {
-    RefBase_weakref_impl* const refs = this->mRefs;
+    RefBase_weakref_impl* const refs = &this->mRefs;
     refs->incWeak(refs, id);
     refs->addStrongRef(refs, id);
 
@@ -413,18 +404,18 @@ void RefBase_forceIncStrong(RefBase* this, const void* id)
 
 static int32_t RefBase_getStrongCount(RefBase* this)
 {
-    return atomic_load_explicit(&this->mRefs->mStrong, memory_order_relaxed);
+    return atomic_load_explicit(&this->mRefs.mStrong, memory_order_relaxed);
 }
 
 static RefBase_weakref* RefBase_createWeak(RefBase* this, const void* id)
 {
-    this->mRefs->incWeak(this->mRefs, id);
-    return (RefBase_weakref*)this->mRefs;
+    this->mRefs.incWeak(&this->mRefs, id);
+    return (RefBase_weakref*)&this->mRefs;
 }
 
 static RefBase_weakref* RefBase_getWeakRefs(RefBase* this)
 {
-    return (RefBase_weakref*)this->mRefs;
+    return (RefBase_weakref*)&this->mRefs;
 }
 
 static void RefBase_printRefs(RefBase* this)
@@ -441,29 +432,23 @@ static void RefBase_trackMe(RefBase* this, bool enable, bool retain)
 
 static void RefBase_dtor(RefBase* this)
 {
-    int32_t flags = atomic_load_explicit(&this->mRefs->mFlags, memory_order_relaxed);
-    if ((flags & OBJECT_LIFETIME_MASK) == OBJECT_LIFETIME_WEAK) {
-        int32_t Weak = atomic_load_explicit(&this->mRefs->mWeak, memory_order_relaxed);
-        if (Weak == 0) {
-            RefBase_weakref_impl_delete(this->mRefs);
-        }
-    } else {
-        int32_t strongs = atomic_load_explicit(&this->mRefs->mStrong, memory_order_relaxed);
+    int32_t flags = atomic_load_explicit(&this->mRefs.mFlags, memory_order_relaxed);
+    if ((flags & OBJECT_LIFETIME_MASK) == OBJECT_LIFETIME_STRONG) {
+        int32_t strongs = atomic_load_explicit(&this->mRefs.mStrong, memory_order_relaxed);
         if (strongs == INITIAL_STRONG_VALUE) {
             BINDER_LOGE("RefBase: Explicit destruction, weak count = %d (in %p). "
                         "Use sp<> to manage this object.",
-                this->mRefs->mWeak, this);
+                this->mRefs.mWeak, this);
         } else if (strongs != 0) {
             LOG_FATAL("RefBase: object %p with strong count %" PRIi32 " deleted. Double owned?",
                 this, strongs);
         }
     }
-    this->mRefs = NULL;
 }
 
 void RefBase_ctor(RefBase* this)
 {
-    this->mRefs = RefBase_weakref_impl_new(this);
+    RefBase_weakref_impl_ctor(&this->mRefs, this);
 
     /* public */
     this->incStrong = RefBase_incStrong;
@@ -499,9 +484,7 @@ RefBase* RefBase_new(void)
 
 void RefBase_delete(RefBase* this)
 {
-    BINDER_LOGE("need to check");
-    /*
-    this->dtor(this);
-    free(this);
-    */
+    /* Objects are freed by their owners, not by their reference counts */
+
+    BINDER_LOGV("RefBase: %p no longer referenced\n", this);
 }
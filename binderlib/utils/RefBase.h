@@ -78,7 +78,6 @@ struct RefBase_weakref_impl {
     RefBase* mBase;
 };
 
-RefBase_weakref_impl* RefBase_weakref_impl_new(RefBase* base);
 void RefBase_weakref_impl_delete(RefBase_weakref_impl* this);
 
 struct RefBase {
@@ -105,7 +104,11 @@ struct RefBase {
     bool (*onIncStrongAttempted)(RefBase* v_this, uint32_t flags, const void* id);
     void (*onLastWeakRef)(RefBase* v_this, const void* id);
 
-    RefBase_weakref_impl* mRefs;
+    /* Counters live inside the object, one allocation per object, and
+     * are released together with it by the owner.
+     */
+
+    RefBase_weakref_impl mRefs;
 };
 
 void RefBase_ctor(RefBase* this);
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "RingBuffer"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/Binderlog.h"
+#include "utils/RingBuffer.h"
+
+void RingBuffer_init(RingBuffer* this)
+{
+    this->mItems = this->mInline;
+    this->mMask = RING_BUFFER_INLINE_CAPACITY - 1;
+    this->mHead = 0;
+    this->mTail = 0;
+}
+
+void RingBuffer_destroy(RingBuffer* this)
+{
+    if (this->mItems != this->mInline) {
+        free(this->mItems);
+    }
+    RingBuffer_init(this);
+}
+
+int RingBuffer_grow(RingBuffer* this)
+{
+    size_t capacity = this->mMask + 1;
+    size_t head = this->mHead & this->mMask;
+    size_t size = RingBuffer_size(this);
+    void** items;
+
+    items = malloc(sizeof(void*) * capacity * 2);
+    if (items == NULL) {
+        BINDER_LOGE("No memory to grow ring buffer %p to %zu\n", this, capacity * 2);
+        return -ENOMEM;
+    }
+
+    /* unwrap so the items start at index 0 of the new buffer */
+
+    memcpy(items, this->mItems + head, sizeof(void*) * (capacity - head));
+    memcpy(items + capacity - head, this->mItems, sizeof(void*) * head);
+
+    if (this->mItems != this->mInline) {
+        free(this->mItems);
+    }
+
+    BINDER_LOGV("Ring buffer %p grown to %zu\n", this, capacity * 2);
+    this->mItems = items;
+    this->mMask = capacity * 2 - 1;
+    this->mHead = 0;
+    this->mTail = size;
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BINDER_INCLUDE_UTILS_RINGBUFFER_H__
+#define __BINDER_INCLUDE_UTILS_RINGBUFFER_H__
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Slots embedded in the queue itself, must be a power of two */
+
+#define RING_BUFFER_INLINE_CAPACITY 16
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* FIFO of pointers with power-of-two capacity. Pushes and pops are O(1);
+ * a full queue doubles into a heap buffer that is kept until the queue is
+ * destroyed, so bursts don't cause reallocation churn.
+ */
+
+struct RingBuffer;
+typedef struct RingBuffer RingBuffer;
+
+struct RingBuffer {
+    void** mItems;
+    size_t mMask; /* capacity - 1 */
+    size_t mHead; /* free running, masked on access */
+    size_t mTail;
+    void* mInline[RING_BUFFER_INLINE_CAPACITY];
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+void RingBuffer_init(RingBuffer* this);
+void RingBuffer_destroy(RingBuffer* this);
+int RingBuffer_grow(RingBuffer* this);
+
+static inline size_t RingBuffer_size(const RingBuffer* this)
+{
+    return this->mTail - this->mHead;
+}
+
+static inline bool RingBuffer_isEmpty(const RingBuffer* this)
+{
+    return this->mTail == this->mHead;
+}
+
+static inline int RingBuffer_push(RingBuffer* this, void* item)
+{
+    int ret;
+
+    if (RingBuffer_size(this) > this->mMask) {
+        ret = RingBuffer_grow(this);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    this->mItems[this->mTail++ & this->mMask] = item;
+    return 0;
+}
+
+/* Callers check RingBuffer_isEmpty() first */
+
+static inline void* RingBuffer_pop(RingBuffer* this)
+{
+    return this->mItems[this->mHead++ & this->mMask];
+}
+
+#endif //__BINDER_INCLUDE_UTILS_RINGBUFFER_H__
@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "Slab"
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/Binderlog.h"
+#include "utils/Slab.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#if defined(CONFIG_BINDER_LIB_SLAB) && CONFIG_BINDER_LIB_SLAB_MAGAZINE_SIZE > 0
+#define SLAB_MAGAZINE_SIZE CONFIG_BINDER_LIB_SLAB_MAGAZINE_SIZE
+#endif
+
+#define SLAB_ALIGN alignof(max_align_t)
+#define SLAB_ROUND(x) (((x) + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1))
+
+/* Every object is preceded by its slab pointer, padded to keep the
+ * object max aligned
+ */
+
+#define SLAB_OBJECT_HEADER SLAB_ROUND(sizeof(struct Slab*))
+#define SLAB_HEADER SLAB_ROUND(sizeof(struct Slab))
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct SlabFree {
+    struct SlabFree* next;
+};
+
+struct Slab {
+    struct Slab* next;
+    struct Slab* prev;
+    struct SlabFree* freeList;
+    size_t inUse;
+};
+
+#ifdef SLAB_MAGAZINE_SIZE
+/* Freed objects a thread keeps per cache of its process group */
+
+struct SlabMagazines {
+    SlabGroup* group;
+    uint8_t count[SLAB_GROUP_MAX_CACHES];
+    void* objects[SLAB_GROUP_MAX_CACHES][SLAB_MAGAZINE_SIZE];
+};
+#endif
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+#ifdef CONFIG_BINDER_LIB_SLAB
+static void slab_list_add(struct Slab** head, struct Slab* slab)
+{
+    slab->prev = NULL;
+    slab->next = *head;
+    if (*head) {
+        (*head)->prev = slab;
+    }
+    *head = slab;
+}
+
+static void slab_list_del(struct Slab** head, struct Slab* slab)
+{
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        *head = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+static void slab_list_release(SlabCache* this, struct Slab** head)
+{
+    struct Slab* slab = *head;
+    struct Slab* next;
+
+    while (slab) {
+        next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    *head = NULL;
+}
+
+static size_t SlabCache_slabBytes(SlabCache* this)
+{
+    return SLAB_HEADER + this->mStride * CONFIG_BINDER_LIB_SLAB_OBJECTS;
+}
+
+static struct Slab* SlabCache_newSlab(SlabCache* this)
+{
+    struct Slab* slab;
+    char* base;
+    int i;
+
+    slab = malloc(SlabCache_slabBytes(this));
+    if (slab == NULL) {
+        return NULL;
+    }
+
+    slab->freeList = NULL;
+    slab->inUse = 0;
+    base = (char*)slab + SLAB_HEADER;
+
+    /* thread the free list in address order */
+
+    for (i = CONFIG_BINDER_LIB_SLAB_OBJECTS - 1; i >= 0; i--) {
+        char* header = base + i * this->mStride;
+        struct SlabFree* object = (struct SlabFree*)(header + SLAB_OBJECT_HEADER);
+
+        *(struct Slab**)header = slab;
+        object->next = slab->freeList;
+        slab->freeList = object;
+    }
+
+    this->mStats.slabs++;
+    this->mStats.slabBytes += SlabCache_slabBytes(this);
+    return slab;
+}
+
+static void SlabCache_releaseSlab(SlabCache* this, struct Slab* slab)
+{
+    this->mStats.slabs--;
+    this->mStats.slabBytes -= SlabCache_slabBytes(this);
+    free(slab);
+}
+
+static void* SlabCache_allocLocked(SlabCache* this)
+{
+    struct Slab* slab = this->mPartial;
+    struct SlabFree* object;
+
+    if (slab == NULL) {
+        slab = this->mEmpty;
+        if (slab) {
+            this->mEmpty = NULL;
+        } else {
+            slab = SlabCache_newSlab(this);
+            if (slab == NULL) {
+                return NULL;
+            }
+        }
+        slab_list_add(&this->mPartial, slab);
+    }
+
+    object = slab->freeList;
+    slab->freeList = object->next;
+    slab->inUse++;
+
+    if (slab->freeList == NULL) {
+        slab_list_del(&this->mPartial, slab);
+        slab_list_add(&this->mFull, slab);
+    }
+
+    this->mStats.allocs++;
+    if (++this->mStats.inUse > this->mStats.peakInUse) {
+        this->mStats.peakInUse = this->mStats.inUse;
+    }
+    return object;
+}
+
+static void SlabCache_freeLocked(SlabCache* this, void* ptr)
+{
+    struct Slab* slab = *(struct Slab**)((char*)ptr - SLAB_OBJECT_HEADER);
+    struct SlabFree* object = (struct SlabFree*)ptr;
+
+    if (slab->freeList == NULL) {
+        slab_list_del(&this->mFull, slab);
+        slab_list_add(&this->mPartial, slab);
+    }
+
+    object->next = slab->freeList;
+    slab->freeList = object;
+    this->mStats.frees++;
+    this->mStats.inUse--;
+
+    if (--slab->inUse == 0) {
+        slab_list_del(&this->mPartial, slab);
+        if (this->mEmpty == NULL) {
+            this->mEmpty = slab;
+        } else {
+            SlabCache_releaseSlab(this, slab);
+        }
+    }
+}
+#endif /* CONFIG_BINDER_LIB_SLAB */
+
+#ifdef SLAB_MAGAZINE_SIZE
+static void SlabMagazines_flush(void* arg)
+{
+    struct SlabMagazines* mags = (struct SlabMagazines*)arg;
+    SlabGroup* group = mags->group;
+    SlabCache* cache;
+    size_t i;
+
+    for (i = 0; i < group->mCount; i++) {
+        cache = group->mCaches[i];
+        if (cache == NULL || mags->count[i] == 0) {
+            continue;
+        }
+
+        pthread_mutex_lock(&cache->mLock);
+        while (mags->count[i] > 0) {
+            SlabCache_freeLocked(cache, mags->objects[i][--mags->count[i]]);
+        }
+        pthread_mutex_unlock(&cache->mLock);
+    }
+    free(mags);
+}
+
+static struct SlabMagazines* SlabCache_magazines(SlabCache* this, bool create)
+{
+    SlabGroup* group = this->mGroup;
+    struct SlabMagazines* mags;
+
+    if (group == NULL || !group->mMagazineKeyCreated) {
+        return NULL;
+    }
+
+    mags = (struct SlabMagazines*)pthread_getspecific(group->mMagazineKey);
+    if (mags == NULL && create) {
+        mags = zalloc(sizeof(struct SlabMagazines));
+        if (mags == NULL) {
+            return NULL;
+        }
+        mags->group = group;
+        if (pthread_setspecific(group->mMagazineKey, mags) != 0) {
+            free(mags);
+            return NULL;
+        }
+    }
+    return mags;
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void SlabGroup_init(SlabGroup* this)
+{
+    memset(this, 0, sizeof(SlabGroup));
+#ifdef SLAB_MAGAZINE_SIZE
+    this->mMagazineKeyCreated = pthread_key_create(&this->mMagazineKey,
+                                    SlabMagazines_flush)
+        == 0;
+#endif
+}
+
+void SlabGroup_destroy(SlabGroup* this)
+{
+#ifdef SLAB_MAGAZINE_SIZE
+    if (this->mMagazineKeyCreated) {
+        /* the caches are gone, only the calling thread's block is freed */
+
+        free(pthread_getspecific(this->mMagazineKey));
+        pthread_key_delete(this->mMagazineKey);
+        this->mMagazineKeyCreated = false;
+    }
+#endif
+    this->mCount = 0;
+}
+
+void SlabCache_init(SlabCache* this, SlabGroup* group, const char* name,
+    size_t objectSize)
+{
+    memset(this, 0, sizeof(SlabCache));
+    pthread_mutex_init(&this->mLock, NULL);
+
+    this->mName = name;
+    this->mObjectSize = objectSize;
+#ifdef CONFIG_BINDER_LIB_SLAB
+    if (objectSize < sizeof(struct SlabFree)) {
+        objectSize = sizeof(struct SlabFree);
+    }
+    this->mStride = SLAB_OBJECT_HEADER + SLAB_ROUND(objectSize);
+#endif
+    this->mStats.objectSize = this->mObjectSize;
+
+    if (group && group->mCount < SLAB_GROUP_MAX_CACHES) {
+        this->mGroup = group;
+        this->mIndex = group->mCount;
+        group->mCaches[group->mCount++] = this;
+    }
+}
+
+void SlabCache_destroy(SlabCache* this)
+{
+    if (this->mStats.inUse > 0) {
+        BINDER_LOGW("Slab cache %s destroyed with %zu objects in use\n",
+            this->mName, this->mStats.inUse);
+    }
+
+    if (this->mGroup) {
+        this->mGroup->mCaches[this->mIndex] = NULL;
+        this->mGroup = NULL;
+    }
+
+#ifdef CONFIG_BINDER_LIB_SLAB
+    slab_list_release(this, &this->mPartial);
+    slab_list_release(this, &this->mFull);
+    free(this->mEmpty);
+    this->mEmpty = NULL;
+#endif
+    pthread_mutex_destroy(&this->mLock);
+}
+
+void* SlabCache_alloc(SlabCache* this)
+{
+    void* object = NULL;
+
+#ifdef SLAB_MAGAZINE_SIZE
+    struct SlabMagazines* mags = SlabCache_magazines(this, false);
+
+    if (mags && mags->count[this->mIndex] > 0) {
+        object = mags->objects[this->mIndex][--mags->count[this->mIndex]];
+    }
+#endif
+
+    if (object == NULL) {
+#ifdef CONFIG_BINDER_LIB_SLAB
+        pthread_mutex_lock(&this->mLock);
+        object = SlabCache_allocLocked(this);
+        pthread_mutex_unlock(&this->mLock);
+#else
+        object = malloc(this->mObjectSize);
+        if (object) {
+            pthread_mutex_lock(&this->mLock);
+            this->mStats.allocs++;
+            if (++this->mStats.inUse > this->mStats.peakInUse) {
+                this->mStats.peakInUse = this->mStats.inUse;
+            }
+            pthread_mutex_unlock(&this->mLock);
+        }
+#endif
+    }
+
+    if (object) {
+        memset(object, 0, this->mObjectSize);
+    }
+    return object;
+}
+
+void SlabCache_free(SlabCache* this, void* object)
+{
+    if (object == NULL) {
+        return;
+    }
+
+#ifdef SLAB_MAGAZINE_SIZE
+    struct SlabMagazines* mags = SlabCache_magazines(this, true);
+
+    if (mags && mags->count[this->mIndex] < SLAB_MAGAZINE_SIZE) {
+        mags->objects[this->mIndex][mags->count[this->mIndex]++] = object;
+        return;
+    }
+#endif
+
+    pthread_mutex_lock(&this->mLock);
+#ifdef CONFIG_BINDER_LIB_SLAB
+    SlabCache_freeLocked(this, object);
+#else
+    free(object);
+    this->mStats.frees++;
+    this->mStats.inUse--;
+#endif
+    pthread_mutex_unlock(&this->mLock);
+}
+
+void SlabCache_getStats(SlabCache* this, SlabStats* stats)
+{
+    pthread_mutex_lock(&this->mLock);
+    *stats = this->mStats;
+    pthread_mutex_unlock(&this->mLock);
+}
+
+void SlabCache_dump(SlabCache* this, int fd)
+{
+    SlabStats stats;
+
+    SlabCache_getStats(this, &stats);
+    dprintf(fd, "%-16s obj %4zu in use %6zu peak %6zu allocs %8zu frees %8zu slabs %4zu (%zu bytes)\n",
+        this->mName, stats.objectSize, stats.inUse, stats.peakInUse,
+        stats.allocs, stats.frees, stats.slabs, stats.slabBytes);
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BINDER_INCLUDE_UTILS_SLAB_H__
+#define __BINDER_INCLUDE_UTILS_SLAB_H__
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define SLAB_GROUP_MAX_CACHES 8
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct SlabStats;
+typedef struct SlabStats SlabStats;
+
+struct SlabStats {
+    size_t objectSize;
+    size_t allocs;
+    size_t frees;
+    size_t inUse; /* includes objects parked in thread magazines */
+    size_t peakInUse;
+    size_t slabs;
+    size_t slabBytes;
+};
+
+struct Slab;
+
+struct SlabCache;
+typedef struct SlabCache SlabCache;
+
+struct SlabGroup;
+typedef struct SlabGroup SlabGroup;
+
+/* Caches of one process. They share a single pthread key for the thread
+ * magazines, as keys are a scarce per task group resource on NuttX.
+ */
+
+struct SlabGroup {
+    pthread_key_t mMagazineKey;
+    bool mMagazineKeyCreated;
+    size_t mCount;
+    SlabCache* mCaches[SLAB_GROUP_MAX_CACHES];
+};
+
+/* Cache of equally sized objects. Objects are carved from slabs of
+ * CONFIG_BINDER_LIB_SLAB_OBJECTS objects, each object is preceded by a
+ * pointer to its slab so it can be freed without a lookup.
+ */
+
+struct SlabCache {
+    const char* mName;
+    size_t mObjectSize;
+    size_t mStride;
+    pthread_mutex_t mLock;
+
+    struct Slab* mPartial; /* slabs with free and used objects */
+    struct Slab* mFull;
+    struct Slab* mEmpty; /* at most one, kept to absorb churn */
+
+    SlabGroup* mGroup; /* NULL: no thread magazines */
+    size_t mIndex; /* in mGroup->mCaches */
+
+    SlabStats mStats;
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: SlabGroup_init / SlabGroup_destroy
+ *
+ * Description:
+ *     Set up the shared magazine key. Destroy the group after all of its
+ *  caches; magazines of threads still alive are dropped with the slabs.
+ *
+ ****************************************************************************/
+
+void SlabGroup_init(SlabGroup* this);
+void SlabGroup_destroy(SlabGroup* this);
+
+/****************************************************************************
+ * Name: SlabCache_init
+ *
+ * Description:
+ *     Create an empty cache for objects of `objectSize` bytes, `name` is
+ *  only used in statistics and must stay valid. Caches joining a `group`
+ *  get thread magazines, `group` may be NULL.
+ *
+ ****************************************************************************/
+
+void SlabCache_init(SlabCache* this, SlabGroup* group, const char* name,
+    size_t objectSize);
+
+/****************************************************************************
+ * Name: SlabCache_destroy
+ *
+ * Description:
+ *     Release every slab of the cache, objects still in use are gone.
+ *
+ ****************************************************************************/
+
+void SlabCache_destroy(SlabCache* this);
+
+/****************************************************************************
+ * Name: SlabCache_alloc
+ *
+ * Description:
+ *     Return a zeroed object, like zalloc(), or NULL on out of memory.
+ *
+ ****************************************************************************/
+
+void* SlabCache_alloc(SlabCache* this);
+
+/****************************************************************************
+ * Name: SlabCache_free
+ *
+ * Description:
+ *     Give an object returned by SlabCache_alloc() of this cache back.
+ *
+ ****************************************************************************/
+
+void SlabCache_free(SlabCache* this, void* object);
+
+/****************************************************************************
+ * Name: SlabCache_getStats / SlabCache_dump
+ *
+ * Description:
+ *     Snapshot the cache statistics, or print them to `fd`.
+ *
+ ****************************************************************************/
+
+void SlabCache_getStats(SlabCache* this, SlabStats* stats);
+void SlabCache_dump(SlabCache* this, int fd);
+
+#endif //__BINDER_INCLUDE_UTILS_SLAB_H__
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#define LOG_TAG "StringArena"
+
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/Binderlog.h"
+#include "utils/StringArena.h"
+
+struct StringArenaChunk {
+    struct StringArenaChunk* next;
+    size_t size; /* bytes available in mData */
+    size_t used;
+    size_t live; /* strings not released yet */
+    alignas(ArenaString) char mData[];
+};
+
+typedef struct StringArenaChunk StringArenaChunk;
+
+static size_t StringArena_footprint(size_t len)
+{
+    size_t bytes = sizeof(ArenaString) + len + 1;
+
+    return (bytes + alignof(ArenaString) - 1) & ~(alignof(ArenaString) - 1);
+}
+
+static StringArenaChunk* StringArena_newChunk(StringArena* this, size_t need)
+{
+    StringArenaChunk* chunk = this->mChunks;
+    size_t size = need > STRING_ARENA_CHUNK_SIZE ? need : STRING_ARENA_CHUNK_SIZE;
+
+    /* an empty head chunk is too small for this string, drop it */
+
+    if (chunk != NULL && chunk->live == 0) {
+        this->mChunks = chunk->next;
+        free(chunk);
+    }
+
+    chunk = malloc(sizeof(StringArenaChunk) + size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->live = 0;
+    chunk->next = this->mChunks;
+    this->mChunks = chunk;
+    return chunk;
+}
+
+void StringArena_init(StringArena* this)
+{
+    this->mChunks = NULL;
+}
+
+void StringArena_clear(StringArena* this)
+{
+    StringArenaChunk* chunk = this->mChunks;
+    StringArenaChunk* next;
+
+    while (chunk != NULL) {
+        next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    this->mChunks = NULL;
+}
+
+const ArenaString* StringArena_intern(StringArena* this, const char* data, size_t len)
+{
+    StringArenaChunk* chunk = this->mChunks;
+    size_t need = StringArena_footprint(len);
+    ArenaString* str;
+
+    if (len > UINT32_MAX) {
+        return NULL;
+    }
+
+    if (chunk == NULL || chunk->size - chunk->used < need) {
+        chunk = StringArena_newChunk(this, need);
+        if (chunk == NULL) {
+            BINDER_LOGE("No memory to intern a %zu bytes string\n", len);
+            return NULL;
+        }
+    }
+
+    str = (ArenaString*)(chunk->mData + chunk->used);
+    str->mSize = len;
+    memcpy(str->mData, data, len);
+    str->mData[len] = '\0';
+
+    chunk->used += need;
+    chunk->live++;
+    return str;
+}
+
+void StringArena_release(StringArena* this, const ArenaString* str)
+{
+    StringArenaChunk** pprev = &this->mChunks;
+    StringArenaChunk* chunk;
+    const char* addr = (const char*)str;
+
+    /* registries hold a handful of chunks, a linear walk is enough */
+
+    for (chunk = *pprev; chunk != NULL; pprev = &chunk->next, chunk = chunk->next) {
+        if (addr >= chunk->mData && addr < chunk->mData + chunk->used) {
+            break;
+        }
+    }
+
+    if (chunk == NULL) {
+        BINDER_LOGE("Releasing %p which is not in arena %p\n", str, this);
+        return;
+    }
+
+    if (--chunk->live > 0) {
+        return;
+    }
+
+    /* the head chunk is still being filled, rewind it instead */
+
+    if (chunk == this->mChunks) {
+        chunk->used = 0;
+    } else {
+        *pprev = chunk->next;
+        free(chunk);
+    }
+}
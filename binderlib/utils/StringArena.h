@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __BINDER_INCLUDE_UTILS_STRINGARENA_H__
+#define __BINDER_INCLUDE_UTILS_STRINGARENA_H__
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Strings are packed into chunks of this size, longer ones get a chunk
+ * of their own
+ */
+
+#define STRING_ARENA_CHUNK_SIZE 1024
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct ArenaString;
+typedef struct ArenaString ArenaString;
+
+struct ArenaString {
+    uint32_t mSize; /* length without the terminating NUL */
+    char mData[];
+};
+
+struct StringArenaChunk;
+
+struct StringArena;
+typedef struct StringArena StringArena;
+
+struct StringArena {
+    /* newest first, only the head chunk is appended to */
+    struct StringArenaChunk* mChunks;
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+static inline const char* ArenaString_data(const ArenaString* this)
+{
+    return this->mData;
+}
+
+void StringArena_init(StringArena* this);
+void StringArena_clear(StringArena* this);
+const ArenaString* StringArena_intern(StringArena* this, const char* data, size_t len);
+void StringArena_release(StringArena* this, const ArenaString* str);
+
+#endif //__BINDER_INCLUDE_UTILS_STRINGARENA_H__
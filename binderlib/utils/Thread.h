@@ -72,4 +72,21 @@ struct IPCThreadPool {
 
 IPCThreadPool* IPCThreadPool_new(bool isMain);
 
+/* Stack usage of binder threads, filled in when
+ * CONFIG_BINDER_LIB_THREAD_STACK_COLORATION is enabled.
+ */
+
+struct BinderStackStats {
+    size_t stackSize;       /* Largest stack handed to a binder thread */
+    size_t threadsSampled;  /* Exited or live threads measured so far */
+    size_t liveThreads;     /* Threads currently running with a colored stack */
+    size_t highWater;       /* Worst-case stack bytes used by any thread */
+    size_t recommended;     /* Suggested CONFIG_BINDER_LIB_THREAD_STACKSIZE */
+};
+
+typedef struct BinderStackStats BinderStackStats;
+
+void BinderThread_getStackStats(BinderStackStats* stats);
+void BinderThread_dumpStackStats(int fd);
+
 #endif // _LIBS_UTILS_THREAD_H
@@ -43,8 +43,28 @@
 #include <android/binder_status.h>
 
 #include "base/IPCThreadState.h"
+#include "base/ProcessGlobal.h"
 #include "base/ProcessState.h"
 
+/* Same pattern as the NuttX kernel stack coloration, so stacks that the
+ * kernel already painted look identical to ours.
+ */
+
+#define STACK_COLOR 0xdeadbeefu
+
+/* Bytes left unpainted below the painting frame, they hold the frames of
+ * the painting loop itself and are always counted as used.
+ */
+
+#define STACK_COLOR_MARGIN 512
+
+/* Headroom and rounding applied to the measured high-water mark when
+ * recommending a stack size.
+ */
+
+#define STACK_HEADROOM_PERCENT 25
+#define STACK_SIZE_ALIGN 256
+
 typedef void* (*binder_pthread_entry)(void*);
 
 struct thread_data_t;
@@ -67,12 +87,112 @@ static void SetThreadName(const char* name)
     prctl(PR_SET_NAME, (unsigned long)name, 0, 0, 0);
 }
 
+#ifdef CONFIG_BINDER_LIB_THREAD_STACK_COLORATION
+struct StackColorRecord;
+typedef struct StackColorRecord StackColorRecord;
+
+struct StackColorRecord {
+    uint32_t* base;
+    uint32_t* top;
+};
+
+static size_t StackColor_highWater(const StackColorRecord* rec)
+{
+    const volatile uint32_t* p = rec->base;
+
+    while (p < rec->top && *p == STACK_COLOR) {
+        p++;
+    }
+    return (uintptr_t)rec->top - (uintptr_t)p;
+}
+
+static size_t StackColor_recommend(size_t highWater, size_t stackSize)
+{
+    size_t size;
+
+    if (highWater == 0) {
+        return stackSize;
+    }
+
+    size = highWater + highWater * STACK_HEADROOM_PERCENT / 100;
+    return (size + STACK_SIZE_ALIGN - 1) & ~(STACK_SIZE_ALIGN - 1);
+}
+
+static void __attribute__((noinline)) StackColor_paint(StackColorRecord* rec)
+{
+    volatile uint32_t* p = rec->base;
+    uint32_t* end = (uint32_t*)(((uintptr_t)&p - STACK_COLOR_MARGIN) & ~(uintptr_t)3);
+
+    while (p < end) {
+        *p++ = STACK_COLOR;
+    }
+}
+
+static StackColorRecord* StackColor_begin(void)
+{
+    BinderThread_global* global = BinderThread_global_get();
+    StackColorRecord* rec;
+    pthread_attr_t attr;
+    void* addr = NULL;
+    size_t size = 0;
+
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        return NULL;
+    }
+    pthread_attr_getstack(&attr, &addr, &size);
+    pthread_attr_destroy(&attr);
+    if (addr == NULL || size <= STACK_COLOR_MARGIN) {
+        return NULL;
+    }
+
+    rec = zalloc(sizeof(StackColorRecord));
+    if (rec == NULL) {
+        return NULL;
+    }
+    rec->base = (uint32_t*)(((uintptr_t)addr + 3) & ~(uintptr_t)3);
+    rec->top = (uint32_t*)(((uintptr_t)addr + size) & ~(uintptr_t)3);
+    StackColor_paint(rec);
+
+    pthread_mutex_lock(&global->sStackLock);
+    global->sLiveStacks.push(&global->sLiveStacks, rec);
+    if (size > global->sStackSize) {
+        global->sStackSize = size;
+    }
+    pthread_mutex_unlock(&global->sStackLock);
+    return rec;
+}
+
+static void StackColor_end(StackColorRecord* rec)
+{
+    BinderThread_global* global = BinderThread_global_get();
+    size_t used = StackColor_highWater(rec);
+
+    pthread_mutex_lock(&global->sStackLock);
+    for (size_t i = 0; i < global->sLiveStacks.size(&global->sLiveStacks); i++) {
+        if (global->sLiveStacks.get(&global->sLiveStacks, i) == rec) {
+            global->sLiveStacks.removeAt(&global->sLiveStacks, i);
+            break;
+        }
+    }
+    global->sStackThreadsSampled++;
+    if (used > global->sStackHighWater) {
+        global->sStackHighWater = used;
+    }
+    pthread_mutex_unlock(&global->sStackLock);
+
+    BINDER_LOGV("Thread %d used %zu of %zu stack bytes\n", gettid(), used,
+        (size_t)((uintptr_t)rec->top - (uintptr_t)rec->base));
+    free(rec);
+}
+#endif
+
 static int thread_trampoline(thread_data_t* t)
 {
     binder_thread_func_t f = t->entryFunction;
     void* u = t->userData;
     int prio = t->priority;
     char* name = t->threadName;
+    int ret;
     free(t);
 
     setpriority(PRIO_PROCESS, 0, prio);
@@ -81,7 +201,17 @@ static int thread_trampoline(thread_data_t* t)
         SetThreadName(name);
         free(name);
     }
-    return f(u);
+
+#ifdef CONFIG_BINDER_LIB_THREAD_STACK_COLORATION
+    StackColorRecord* rec = StackColor_begin();
+    ret = f(u);
+    if (rec) {
+        StackColor_end(rec);
+    }
+#else
+    ret = f(u);
+#endif
+    return ret;
 }
 
 static int CreateRawBinderThreadEtc(binder_thread_func_t entryFunction,
@@ -92,7 +222,15 @@ static int CreateRawBinderThreadEtc(binder_thread_func_t entryFunction,
     pthread_attr_init(&attr);
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
 
-    if (threadPriority != PRIORITY_DEFAULT || threadName != NULL) {
+#ifdef CONFIG_BINDER_LIB_THREAD_STACK_COLORATION
+    /* The trampoline paints and measures the stack, always go through it */
+
+    bool trampoline = true;
+#else
+    bool trampoline = threadPriority != PRIORITY_DEFAULT || threadName != NULL;
+#endif
+
+    if (trampoline) {
         thread_data_t* t = malloc(sizeof(thread_data_t));
         t->priority = threadPriority;
         t->threadName = threadName ? strdup(threadName) : NULL;
@@ -154,6 +292,12 @@ static int BinderThread_threadLoop(void* user)
             self->mRunning = false;
             self->mThread = -1;
             pthread_cond_broadcast(&self->mThreadExitedCondition);
+
+            /* A joiner may free self once it holds mLock, don't touch
+             * self after this.
+             */
+
+            pthread_mutex_unlock(&self->mLock);
             break;
         }
         pthread_mutex_unlock(&self->mLock);
@@ -349,3 +493,44 @@ IPCThreadPool* IPCThreadPool_new(bool isMain)
     IPCThreadPool_ctor(this, isMain);
     return this;
 }
+
+void BinderThread_getStackStats(BinderStackStats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+#ifdef CONFIG_BINDER_LIB_THREAD_STACK_COLORATION
+    BinderThread_global* global = BinderThread_global_get();
+
+    pthread_mutex_lock(&global->sStackLock);
+    stats->stackSize = global->sStackSize;
+    stats->threadsSampled = global->sStackThreadsSampled;
+    stats->highWater = global->sStackHighWater;
+    stats->liveThreads = global->sLiveStacks.size(&global->sLiveStacks);
+
+    /* Live threads are sampled in place, their marks can still grow */
+
+    for (size_t i = 0; i < stats->liveThreads; i++) {
+        StackColorRecord* rec = global->sLiveStacks.get(&global->sLiveStacks, i);
+        size_t used = StackColor_highWater(rec);
+        if (used > stats->highWater) {
+            stats->highWater = used;
+        }
+    }
+    pthread_mutex_unlock(&global->sStackLock);
+
+    stats->threadsSampled += stats->liveThreads;
+    stats->recommended = StackColor_recommend(stats->highWater, stats->stackSize);
+#endif
+}
+
+void BinderThread_dumpStackStats(int fd)
+{
+    BinderStackStats stats;
+
+    BinderThread_getStackStats(&stats);
+    dprintf(fd, "Binder thread stacks of process %d:\n", getpid());
+    dprintf(fd, "  stack size:       %zu bytes\n", stats.stackSize);
+    dprintf(fd, "  threads sampled:  %zu (%zu live)\n", stats.threadsSampled, stats.liveThreads);
+    dprintf(fd, "  high-water mark:  %zu bytes\n", stats.highWater);
+    dprintf(fd, "  recommended size: %zu bytes\n", stats.recommended);
+}
@@ -54,18 +54,20 @@ static int VectorBase_capacity(const VectorBase* this)
 static int VectorBase_resize(VectorBase* this, int capacity)
 {
     Vector_Entry* items = realloc(this->m_items, sizeof(Vector_Entry) * capacity);
-    if (items) {
-        this->m_items = items;
-        this->capacity = capacity;
+    if (items == NULL) {
         return -ENOMEM;
     }
+
+    this->m_items = items;
+    this->capacity = capacity;
     return 0;
 }
 
 static size_t VectorBase_add(VectorBase* this, long value)
 {
-    if (this->capacity == this->total) {
-        this->resize(this, this->capacity * 2);
+    if (this->capacity == this->total && this->resize(this, this->capacity * 2) < 0) {
+        BINDER_LOGE("No memory to grow vector %p\n", this);
+        return this->total;
     }
     this->m_items[this->total++].value = value;
     return this->total;
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/logging.h>
+
+#include "RegistrationNotifier.h"
+
+namespace android {
+
+RegistrationNotifier::RegistrationNotifier()
+    : mThread(&RegistrationNotifier::threadLoop, this)
+{
+}
+
+RegistrationNotifier::~RegistrationNotifier()
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mExit = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+void RegistrationNotifier::enqueue(const std::string& name, const sp<IBinder>& binder,
+    std::vector<sp<os::IServiceCallback>> listeners)
+{
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        if (auto it = mPending.find(name); it != mPending.end()) {
+            it->second.binder = binder;
+            it->second.listeners = std::move(listeners);
+            mStats.coalesced++;
+            return;
+        }
+
+        mPending[name] = Pending {
+            .binder = binder,
+            .listeners = std::move(listeners),
+            .queuedAt = Clock::now(),
+        };
+        mQueue.push_back(name);
+        mStats.queued++;
+        mStats.maxDepth = std::max(mStats.maxDepth, mQueue.size());
+    }
+    mCondition.notify_one();
+}
+
+RegistrationNotifier::Stats RegistrationNotifier::stats()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    Stats stats = mStats;
+
+    stats.depth = mQueue.size();
+    return stats;
+}
+
+// The calls are oneway and made without mLock, a dead listener only
+// fails its own onRegistration().
+void RegistrationNotifier::threadLoop()
+{
+    std::unique_lock<std::mutex> lock(mLock);
+
+    while (true) {
+        mCondition.wait(lock, [this] { return mExit || !mQueue.empty(); });
+        if (mExit) {
+            return;
+        }
+
+        std::string name = std::move(mQueue.front());
+        mQueue.pop_front();
+        Pending pending = std::move(mPending.extract(name).mapped());
+
+        lock.unlock();
+        for (const sp<os::IServiceCallback>& cb : pending.listeners) {
+            cb->onRegistration(name, pending.binder);
+        }
+        auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - pending.queuedAt);
+        pending = Pending(); // Drop the references outside mLock too
+        lock.lock();
+
+        mStats.delivered++;
+        mStats.totalLatency += latency;
+        mStats.maxLatency = std::max(mStats.maxLatency, latency);
+        if (mQueue.empty()) {
+            LOG(DEBUG) << "Notified " << mStats.delivered << " registrations, "
+                       << mStats.coalesced << " coalesced, max depth " << mStats.maxDepth
+                       << ", max latency "
+                       << std::chrono::duration_cast<std::chrono::milliseconds>(mStats.maxLatency)
+                              .count()
+                       << "ms";
+        }
+    }
+}
+
+} // namespace android
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android/os/IServiceCallback.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+// Tells registration listeners about new services from a thread of its
+// own, so that addService() returns without waiting on any of them.
+// A name added again before its turn coalesces into the pending entry,
+// the listeners then hear once, with what was queued last.
+class RegistrationNotifier {
+public:
+    struct Stats {
+        uint64_t queued = 0;
+        uint64_t coalesced = 0;
+        uint64_t delivered = 0; // Names fanned out, not calls made
+        size_t depth = 0;
+        size_t maxDepth = 0;
+        std::chrono::nanoseconds totalLatency {0};
+        std::chrono::nanoseconds maxLatency {0};
+    };
+
+    RegistrationNotifier();
+    ~RegistrationNotifier();
+
+    RegistrationNotifier(const RegistrationNotifier&) = delete;
+    RegistrationNotifier& operator=(const RegistrationNotifier&) = delete;
+
+    void enqueue(const std::string& name, const sp<IBinder>& binder,
+        std::vector<sp<os::IServiceCallback>> listeners);
+    Stats stats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        sp<IBinder> binder;
+        std::vector<sp<os::IServiceCallback>> listeners;
+        Clock::time_point queuedAt; // Of the first enqueue(), kept on coalescing
+    };
+
+    void threadLoop();
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<std::string> mQueue;
+    std::map<std::string, Pending> mPending;
+    Stats mStats;
+    bool mExit = false;
+    std::thread mThread;
+};
+
+} // namespace android
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <android-base/logging.h>
+
+#include <endian.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ServiceManifest.h"
+
+namespace android {
+
+ServiceManifest::~ServiceManifest()
+{
+    unload();
+}
+
+bool ServiceManifest::load(const char* path)
+{
+    unload();
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG(INFO) << "No service manifest at " << path;
+        return true;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        LOG(ERROR) << "Could not stat service manifest " << path;
+        return false;
+    }
+
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        LOG(ERROR) << "Could not map service manifest " << path;
+        return false;
+    }
+
+    mBase = base;
+    mSize = st.st_size;
+    if (!validate()) {
+        LOG(ERROR) << "Malformed service manifest " << path;
+        unload();
+        return false;
+    }
+
+    LOG(INFO) << "Loaded " << mCount << " declared services from " << path;
+    return true;
+}
+
+// Checked once here, so that lookups can trust every offset.
+bool ServiceManifest::validate()
+{
+    const Header* header = static_cast<const Header*>(mBase);
+
+    if (mSize < sizeof(Header) || le32toh(header->magic) != kMagic
+        || le32toh(header->version) != kVersion) {
+        return false;
+    }
+
+    // The entries sit between the header and the string table.
+    uint32_t strings = le32toh(header->strings);
+    uint32_t count = le32toh(header->count);
+    if (strings < sizeof(Header) || strings > mSize
+        || count > (strings - sizeof(Header)) / sizeof(Entry)) {
+        return false;
+    }
+
+    mEntries = reinterpret_cast<const Entry*>(header + 1);
+    mStrings = static_cast<const char*>(mBase) + strings;
+    mCount = count;
+    size_t stringsSize = mSize - strings;
+
+    for (uint32_t i = 0; i < mCount; i++) {
+        uint32_t offset = le32toh(mEntries[i].offset);
+        uint32_t length = le32toh(mEntries[i].length);
+
+        if (offset >= stringsSize || length >= stringsSize - offset
+            || mStrings[offset + length] != '\0') {
+            return false;
+        }
+        if (i > 0 && nameAt(i - 1) >= nameAt(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ServiceManifest::unload()
+{
+    if (mBase != nullptr) {
+        munmap(mBase, mSize);
+    }
+    mBase = nullptr;
+    mSize = 0;
+    mEntries = nullptr;
+    mStrings = nullptr;
+    mCount = 0;
+}
+
+std::string_view ServiceManifest::nameAt(size_t index) const
+{
+    return std::string_view(mStrings + le32toh(mEntries[index].offset),
+        le32toh(mEntries[index].length));
+}
+
+// Index of the first entry not sorting before name.
+size_t ServiceManifest::lowerBound(std::string_view name) const
+{
+    size_t low = 0;
+    size_t high = mCount;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if (nameAt(mid) < name) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool ServiceManifest::isDeclared(std::string_view name) const
+{
+    size_t index = lowerBound(name);
+
+    return index < mCount && nameAt(index) == name;
+}
+
+std::vector<std::string> ServiceManifest::getDeclaredInstances(std::string_view interface) const
+{
+    std::string prefix = std::string(interface) + "/";
+    std::vector<std::string> instances;
+
+    for (size_t index = lowerBound(prefix); index < mCount; index++) {
+        std::string_view name = nameAt(index);
+
+        if (name.substr(0, prefix.size()) != prefix) {
+            break;
+        }
+        instances.emplace_back(name.substr(prefix.size()));
+    }
+    return instances;
+}
+
+} // namespace android
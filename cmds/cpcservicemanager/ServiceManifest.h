@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace android {
+
+// The services a product declares, in the layout that
+// cmds/svcmanager/mkmanifest.py generates and the C servicemanager
+// reads too. Mapped read-only, looked up with binary search.
+class ServiceManifest {
+public:
+    ServiceManifest() = default;
+    ~ServiceManifest();
+
+    ServiceManifest(const ServiceManifest&) = delete;
+    ServiceManifest& operator=(const ServiceManifest&) = delete;
+
+    // A missing file leaves the manifest empty, which is not an error.
+    bool load(const char* path);
+
+    bool isDeclared(std::string_view name) const;
+    std::vector<std::string> getDeclaredInstances(std::string_view interface) const;
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t count;
+        uint32_t strings;
+    };
+
+    struct Entry {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    static constexpr uint32_t kMagic = 0x4d435653; // "SVCM"
+    static constexpr uint32_t kVersion = 1;
+
+    bool validate();
+    void unload();
+    std::string_view nameAt(size_t index) const;
+    size_t lowerBound(std::string_view name) const;
+
+    void* mBase = nullptr;
+    size_t mSize = 0;
+    const Entry* mEntries = nullptr;
+    const char* mStrings = nullptr;
+    uint32_t mCount = 0;
+};
+
+} // namespace android
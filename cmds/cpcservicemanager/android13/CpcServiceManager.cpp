@@ -16,12 +16,26 @@
 
 #include <android-base/logging.h>
 
+#include <inttypes.h>
+#include <stdio.h>
+
 #include "CpcServiceManager.h"
 
 using android::binder::Status;
 
+#ifndef CONFIG_CPC_SERVICEMANAGER_MANIFEST
+#define CONFIG_CPC_SERVICEMANAGER_MANIFEST "/etc/cpcservicemanifest.bin"
+#endif
+
 namespace android {
 
+CpcServiceManager::CpcServiceManager()
+{
+    if (CONFIG_CPC_SERVICEMANAGER_MANIFEST[0] != '\0') {
+        mManifest.load(CONFIG_CPC_SERVICEMANAGER_MANIFEST);
+    }
+}
+
 Status CpcServiceManager::getService(const std::string& name, sp<IBinder>* outBinder)
 {
     if (auto it = mNameToService.find(name); it != mNameToService.end()) {
@@ -61,10 +75,9 @@ Status CpcServiceManager::addService(const std::string& name, const sp<IBinder>&
         .cpuname = cpuname,
     };
 
+    // Listeners hear from mNotifier's thread, not within this transaction
     if (auto it = mNameToCallback.find(servname); it != mNameToCallback.end()) {
-        for (const sp<IServiceCallback>& cb : it->second) {
-            cb->onRegistration(servname, IInterface::asBinder(this));
-        }
+        mNotifier.enqueue(servname, IInterface::asBinder(this), it->second);
     }
 
     return Status::ok();
@@ -115,6 +128,23 @@ Status CpcServiceManager::unregisterForNotifications(const std::string& name,
     return Status::fromExceptionCode(Status::EX_ILLEGAL_STATE);
 }
 
+status_t CpcServiceManager::dump(int fd, [[maybe_unused]] const Vector<String16>& args)
+{
+    RegistrationNotifier::Stats stats = mNotifier.stats();
+    auto toMs = [](std::chrono::nanoseconds ns) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(ns).count();
+    };
+
+    dprintf(fd, "services: %zu\n", mNameToService.size());
+    dprintf(fd, "notifications: queued %" PRIu64 " coalesced %" PRIu64 " delivered %" PRIu64 "\n",
+        stats.queued, stats.coalesced, stats.delivered);
+    dprintf(fd, "notification queue: depth %zu max %zu\n", stats.depth, stats.maxDepth);
+    dprintf(fd, "notification latency: avg %lldms max %lldms\n",
+        static_cast<long long>(stats.delivered > 0 ? toMs(stats.totalLatency) / stats.delivered : 0),
+        static_cast<long long>(toMs(stats.maxLatency)));
+    return OK;
+}
+
 void CpcServiceManager::binderDied(const wp<IBinder>& who)
 {
     LOG(DEBUG) << "binderDied: " << who.get_refs();
@@ -129,12 +159,14 @@ void CpcServiceManager::binderDied(const wp<IBinder>& who)
 
 Status CpcServiceManager::isDeclared(const std::string& name, bool* outReturn)
 {
-    return Status::fromExceptionCode(Status::EX_UNSUPPORTED_OPERATION);
+    *outReturn = mManifest.isDeclared(name);
+    return Status::ok();
 }
 
 Status CpcServiceManager::getDeclaredInstances(const std::string& interface, std::vector<std::string>* outReturn)
 {
-    return Status::fromExceptionCode(Status::EX_UNSUPPORTED_OPERATION);
+    *outReturn = mManifest.getDeclaredInstances(interface);
+    return Status::ok();
 }
 
 Status CpcServiceManager::updatableViaApex(const std::string& name,
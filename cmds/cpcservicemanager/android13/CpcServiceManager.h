@@ -22,6 +22,9 @@
 
 #include <map>
 
+#include "../RegistrationNotifier.h"
+#include "../ServiceManifest.h"
+
 namespace android {
 
 using os::ConnectionInfo;
@@ -31,6 +34,8 @@ using os::ServiceDebugInfo;
 
 class CpcServiceManager : public os::BnServiceManager, public IBinder::DeathRecipient {
 public:
+    CpcServiceManager();
+
     binder::Status getService(const std::string& name, sp<IBinder>* outBinder) override;
     binder::Status checkService(const std::string& name, sp<IBinder>* outBinder) override;
     binder::Status addService(const std::string& name, const sp<IBinder>& binder,
@@ -53,6 +58,7 @@ public:
     binder::Status getServiceDebugInfo(std::vector<ServiceDebugInfo>* outReturn) override;
 
     void binderDied(const wp<IBinder>& who) override;
+    status_t dump(int fd, const Vector<String16>& args) override;
 
 private:
     struct Service {
@@ -64,6 +70,8 @@ private:
 
     ServiceMap mNameToService;
     ServiceCallbackMap mNameToCallback;
+    ServiceManifest mManifest;
+    RegistrationNotifier mNotifier;
 };
 
 } // namespace android
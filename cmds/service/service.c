@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/Timers.h"
+#include <android/binder_status.h>
+
+#include "base/AidlServiceManager.h"
+#include "base/IPCThreadState.h"
+#include "base/IServiceManager.h"
+
+static int list_services(IServiceManager* sm, const char* prog_name)
+{
+    VectorString services;
+    int32_t status;
+
+    VectorString_ctor(&services);
+    status = sm->listServices(sm, DUMP_FLAG_PRIORITY_ALL, &services);
+    if (status != STATUS_OK) {
+        fprintf(stderr, "%s: listServices failed: %" PRId32 "\n", prog_name, status);
+        services.dtor(&services);
+        return 20;
+    }
+
+    printf("Found %zu services:\n", services.size(&services));
+    for (size_t i = 0; i < services.size(&services); i++) {
+        printf("%zu\t%s\n", i, String_data(services.get(&services, i)));
+    }
+
+    services.dtor(&services);
+    return 0;
+}
+
+static int compare_lookups(const void* a, const void* b)
+{
+    const ServiceDebugInfo* ia = *(const ServiceDebugInfo* const*)a;
+    const ServiceDebugInfo* ib = *(const ServiceDebugInfo* const*)b;
+
+    if (ia->lookups != ib->lookups) {
+        return ia->lookups < ib->lookups ? 1 : -1;
+    }
+    return strcmp(String_data(&ia->name), String_data(&ib->name));
+}
+
+/* The hottest services first */
+
+static int dump_stats(IServiceManager* sm, const char* prog_name)
+{
+    ServiceDebugInfo** sorted;
+    VectorImpl infos;
+    int64_t now;
+    size_t count;
+    int32_t status;
+
+    VectorImpl_ctor(&infos);
+    status = sm->getServiceDebugInfo(sm, &infos);
+    if (status != STATUS_OK) {
+        fprintf(stderr, "%s: getServiceDebugInfo failed: %" PRId32 "\n", prog_name, status);
+        ServiceDebugInfo_clearVector(&infos);
+        infos.dtor(&infos);
+        return 20;
+    }
+
+    count = infos.size(&infos);
+    sorted = malloc((count + 1) * sizeof(ServiceDebugInfo*));
+    if (sorted == NULL) {
+        ServiceDebugInfo_clearVector(&infos);
+        infos.dtor(&infos);
+        return 20;
+    }
+    for (size_t i = 0; i < count; i++) {
+        sorted[i] = infos.get(&infos, i);
+    }
+    qsort(sorted, count, sizeof(ServiceDebugInfo*), compare_lookups);
+
+    now = uptimeMillis();
+    printf("Found %zu services:\n", count);
+    printf("%-32s %6s %7s %10s %14s\n", "NAME", "PID", "CLIENTS", "LOOKUPS", "LAST LOOKUP");
+    for (size_t i = 0; i < count; i++) {
+        ServiceDebugInfo* info = sorted[i];
+        char clients[12];
+        char last[24];
+
+        if (info->clients < 0) {
+            snprintf(clients, sizeof(clients), "-");
+        } else {
+            snprintf(clients, sizeof(clients), "%d", info->clients);
+        }
+        if (info->lastLookupMs == 0) {
+            snprintf(last, sizeof(last), "never");
+        } else {
+            snprintf(last, sizeof(last), "%" PRId64 " ms ago", now - info->lastLookupMs);
+        }
+        printf("%-32s %6d %7s %10" PRId64 " %14s\n", String_data(&info->name), info->pid,
+            clients, info->lookups, last);
+    }
+
+    free(sorted);
+    ServiceDebugInfo_clearVector(&infos);
+    infos.dtor(&infos);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    bool wantsUsage = false;
+    int result = 0;
+    IServiceManager* sm;
+
+    /* Strip path off the program name. */
+    char* prog_name = basename(argv[0]);
+
+    while (1) {
+        int ic = getopt(argc, argv, "h?");
+        if (ic < 0)
+            break;
+
+        switch (ic) {
+        case 'h':
+        case '?':
+            wantsUsage = true;
+            break;
+        default:
+            fprintf(stderr, "%s: Unknown option -%c\n", prog_name, ic);
+            wantsUsage = true;
+            result = 10;
+            break;
+        }
+    }
+
+    if (IPCThreadState_self() == NULL) {
+        fprintf(stderr, "%s: Unable to get IPCThreadState!\n", prog_name);
+        return 20;
+    }
+
+    sm = defaultServiceManager();
+    if (sm == NULL) {
+        fprintf(stderr, "%s: Unable to get default service manager!\n", prog_name);
+        return 20;
+    }
+
+    if (optind >= argc) {
+        wantsUsage = true;
+    } else if (!wantsUsage) {
+        if (strcmp(argv[optind], "list") == 0) {
+            result = list_services(sm, prog_name);
+        } else if (strcmp(argv[optind], "stats") == 0) {
+            result = dump_stats(sm, prog_name);
+        } else {
+            fprintf(stderr, "%s: Unknown command %s\n", prog_name, argv[optind]);
+            wantsUsage = true;
+            result = 10;
+        }
+    }
+
+    if (wantsUsage) {
+        printf("Usage: %s [-h|-?]\n"
+               "       %s list\n"
+               "       %s stats\n",
+            prog_name, prog_name, prog_name);
+        return result;
+    }
+
+    return result;
+}
@@ -18,9 +18,13 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <nuttx/android/binder.h>
 #include <nuttx/tls.h>
 #include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,17 +39,25 @@
 #include "base/ProcessState.h"
 #include "base/Status.h"
 #include "utils/Binderlog.h"
+#include "utils/Timers.h"
 #include <android/binder_status.h>
 
 #include "ServiceManager.h"
 
+/* Matches every service in the sorted walk, even one added with no
+ * dumpPriority bit set.
+ */
+
+#define DUMP_PRIORITY_ANY (-1)
+
 static ssize_t BinderService_getNodeStrongRefCount(BinderService* this)
 {
     IBinder* binder = this->binder;
     BpBinder* bpBinder;
     ProcessState* self;
 
-    binder->incStrongRequireStrong(binder, (const void*)binder);
+    /* servicemanager's own reference is the one the service holds */
+
     bpBinder = binder->remoteBinder(binder);
 
     if (bpBinder == NULL) {
@@ -57,27 +69,42 @@ static ssize_t BinderService_getNodeStrongRefCount(BinderService* this)
 
 static void BinderService_dtor(BinderService* this)
 {
+    if (this->binder != NULL) {
+        this->binder->decStrong(this->binder, this);
+    }
 }
 
 void BinderService_ctor(BinderService* this)
 {
+    this->binder = NULL;
     this->hasClients = false;
     this->guaranteeClient = false;
     this->debugPid = 0;
+    this->lookups = 0;
+    this->lastLookupMs = 0;
 
     this->getNodeStrongRefCount = BinderService_getNodeStrongRefCount;
     this->dtor = BinderService_dtor;
 }
 
-BinderService* BinderService_new()
+BinderService* BinderService_new(SlabCache* cache)
 {
     BinderService* this;
-    this = zalloc(sizeof(BinderService));
+    this = SlabCache_alloc(cache);
+    if (this == NULL) {
+        return NULL;
+    }
 
     BinderService_ctor(this);
     return this;
 }
 
+static void BinderService_delete(BinderService* this, SlabCache* cache)
+{
+    this->dtor(this);
+    SlabCache_free(cache, this);
+}
+
 static bool isValidServiceName(const char* name)
 {
     int i;
@@ -105,15 +132,14 @@ static bool isValidServiceName(const char* name)
 
 static IBinder* ServiceManager_tryGetService(ServiceManager* this, String* name, bool startIfNotFound)
 {
-    uint32_t status;
     IBinder* out = NULL;
     BinderService* service = NULL;
 
-    status = this->mNameToService.find(&this->mNameToService, (long)name, (long*)&service);
-    if (status != STATUS_OK) {
-        return NULL;
-    }
+    /* Unregistering and dying erase the name, so a lazy service that is
+     * not running is simply a miss here.
+     */
 
+    this->mNameToService.find(&this->mNameToService, (long)name, (long*)&service);
     if (service != NULL) {
         out = service->binder;
     }
@@ -123,6 +149,8 @@ static IBinder* ServiceManager_tryGetService(ServiceManager* this, String* name,
     }
     if (out) {
         service->guaranteeClient = true;
+        service->lookups++;
+        service->lastLookupMs = uptimeMillis();
     }
     return out;
 }
@@ -139,6 +167,23 @@ static int32_t ServiceManager_checkService(ServiceManager* this, String* name, I
     return STATUS_OK;
 }
 
+static int32_t ServiceManager_getServices(ServiceManager* this, VectorString* names,
+    VectorImpl* aidl_return)
+{
+    size_t count = names->size(names);
+
+    if (count > AIDL_SERVICE_MANAGER_MAX_GET_SERVICES) {
+        BINDER_LOGE("getServices asked for %zu names, at most %d\n", count,
+            AIDL_SERVICE_MANAGER_MAX_GET_SERVICES);
+        return STATUS_BAD_VALUE;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        aidl_return->push(aidl_return, this->tryGetService(this, names->get(names, i), true));
+    }
+    return STATUS_OK;
+}
+
 static int32_t ServiceManager_addService(ServiceManager* this, String* name, IBinder* binder,
     bool allowIsolated, int32_t dumpPriority)
 {
@@ -154,65 +199,398 @@ static int32_t ServiceManager_addService(ServiceManager* this, String* name, IBi
         return STATUS_BAD_VALUE;
     }
 
-    /* implicitly unlinked when the binder is removed */
+    /* Linked to death on first sight, the death evicts all its services */
 
-    if (binder->remoteBinder(binder) != NULL && binder->linkToDeath((void*)this, (void*)(&this->m_DeathRecipient), NULL, 0) != OK) {
+    BinderRegistrations* regs = this->getRegistrations(this, binder);
+
+    if (regs == NULL) {
         BINDER_LOGE("Could not linkToDeath when adding %s\n", String_data(name));
         return STATUS_BAD_TYPE;
     }
 
-    /* Overwrite the old service if it exists */
+    /* Overwrite the old service if it exists, the map keeps its own copy
+     * of name, which only lives as long as this transaction.
+     */
+
+    BinderService* oldService = NULL;
+    BinderService* Service = BinderService_new(&this->mServiceCache);
 
-    BinderService* Service = BinderService_new();
+    if (Service == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+
+    /* Keeps the node's strong count at one for servicemanager, which
+     * the client checks expect, until removeService() or binderDied().
+     */
 
+    binder->incStrong(binder, Service);
+    String_dup(&Service->name, name);
     Service->binder = binder,
     Service->allowIsolated = allowIsolated,
     Service->dumpPriority = dumpPriority,
     Service->debugPid = callingPid,
-    this->mNameToService.put(&this->mNameToService, (long)name, (long)Service);
+    this->mNameToService.find(&this->mNameToService, (long)name, (long*)&oldService);
+    if (this->mNameToService.put(&this->mNameToService, (long)name, (long)Service) != STATUS_OK) {
+        BINDER_LOGE("Could not add %s\n", String_data(name));
+        BinderService_delete(Service, &this->mServiceCache);
+        return STATUS_NO_MEMORY;
+    }
+    regs->mServices.push(&regs->mServices, Service);
 
-    IServiceCallback* callback = NULL;
+    if (oldService != NULL) {
+        Service->lookups = oldService->lookups;
+        Service->lastLookupMs = oldService->lastLookupMs;
+        this->removeService(this, oldService);
+    }
 
-    this->mNameToRegistrationCallback.find(&this->mNameToRegistrationCallback,
-        (long)name, (long*)&callback);
-    if (callback != NULL) {
-        callback->onRegistration(callback, name, binder);
+    /* Listeners hear about it once the reply is out, see drainNotifications() */
+
+    if (this->mNameToRegistrationCallback.find(&this->mNameToRegistrationCallback,
+            (long)name, NULL)
+        == STATUS_OK) {
+        this->queueNotification(this, name);
+    }
+
+    return STATUS_OK;
+}
+
+static void ServiceManager_queueNotification(ServiceManager* this, String* name)
+{
+    NotificationStats* stats = &this->mNotificationStats;
+    PendingNotification* pending = NULL;
+
+    this->mNameToPendingNotification.find(&this->mNameToPendingNotification,
+        (long)name, (long*)&pending);
+    if (pending != NULL) {
+        stats->coalesced++;
+        return;
+    }
+
+    pending = zalloc(sizeof(PendingNotification));
+    if (pending == NULL) {
+        BINDER_LOGE("No memory to queue notification for %s\n", String_data(name));
+        return;
+    }
+    String_dup(&pending->name, name);
+    pending->queuedAt = uptimeNanos();
+
+    if (this->mNameToPendingNotification.put(&this->mNameToPendingNotification,
+            (long)&pending->name, (long)pending)
+            != STATUS_OK
+        || RingBuffer_push(&this->mNotificationQueue, pending) < 0) {
+        BINDER_LOGE("Could not queue notification for %s\n", String_data(name));
+        this->mNameToPendingNotification.erase(&this->mNameToPendingNotification,
+            (long)&pending->name);
+        free(pending);
+        return;
+    }
+
+    stats->queued++;
+    if (RingBuffer_size(&this->mNotificationQueue) > stats->maxDepth) {
+        stats->maxDepth = RingBuffer_size(&this->mNotificationQueue);
+    }
+}
+
+/* Runs outside any transaction, every onRegistration() is oneway and
+ * a dead listener only fails its own call.
+ */
+
+static size_t ServiceManager_drainNotifications(ServiceManager* this, size_t maxCount)
+{
+    NotificationStats* stats = &this->mNotificationStats;
+
+    while (maxCount-- > 0 && !RingBuffer_isEmpty(&this->mNotificationQueue)) {
+        PendingNotification* pending = RingBuffer_pop(&this->mNotificationQueue);
+        BinderService* service = NULL;
+        VectorImpl* callbacks = NULL;
+
+        this->mNameToPendingNotification.erase(&this->mNameToPendingNotification,
+            (long)&pending->name);
+        this->mNameToService.find(&this->mNameToService, (long)&pending->name,
+            (long*)&service);
+        this->mNameToRegistrationCallback.find(&this->mNameToRegistrationCallback,
+            (long)&pending->name, (long*)&callbacks);
+
+        if (service == NULL || service->binder == NULL) {
+            stats->dropped++;
+        } else {
+            nsecs_t latency;
+
+            for (int i = 0; callbacks != NULL && i < callbacks->size(callbacks); i++) {
+                BpServiceCallback* cb = callbacks->get(callbacks, i);
+                cb->onRegistration(cb, &pending->name, service->binder);
+            }
+
+            latency = uptimeNanos() - pending->queuedAt;
+            stats->delivered++;
+            stats->totalLatency += latency;
+            if (latency > stats->maxLatency) {
+                stats->maxLatency = latency;
+            }
+        }
+
+        free(pending);
+    }
+
+    return RingBuffer_size(&this->mNotificationQueue);
+}
+
+static void ServiceManager_logNotificationStats(ServiceManager* this)
+{
+    NotificationStats* stats = &this->mNotificationStats;
+
+    if (stats->delivered == stats->reported) {
+        return;
+    }
+    stats->reported = stats->delivered;
+
+    BINDER_LOGI("notifications: queued %" PRIu64 " coalesced %" PRIu64 " delivered %" PRIu64
+                " dropped %" PRIu64 ", depth %zu max %zu, latency avg %" PRId64
+                "ms max %" PRId64 "ms\n",
+        stats->queued, stats->coalesced, stats->delivered, stats->dropped,
+        RingBuffer_size(&this->mNotificationQueue), stats->maxDepth,
+        nanoseconds_to_milliseconds(stats->totalLatency / (nsecs_t)stats->delivered),
+        nanoseconds_to_milliseconds(stats->maxLatency));
+}
+
+static int ServiceManager_compareServiceName(const void* a, const void* b)
+{
+    const BinderService* sa = *(const BinderService* const*)a;
+    const BinderService* sb = *(const BinderService* const*)b;
+
+    return strcmp(String_data(&sa->name), String_data(&sb->name));
+}
+
+/* The services matching dumpPriority that sort after startAfter, in
+ * name order. Ordered by name instead of by the hash map, so a page
+ * boundary stays put while services come and go. The caller frees
+ * *services.
+ */
+
+static int32_t ServiceManager_sortServices(ServiceManager* this, int32_t dumpPriority,
+    const char* startAfter, BinderService*** services, size_t* count)
+{
+    HashMapBase* base = &this->mNameToService.m_HashMap;
+    uint32_t total = this->mNameToService.size(&this->mNameToService);
+    BinderService** matches;
+    HashMap_Entry* cur;
+    size_t bkt;
+
+    *services = NULL;
+    *count = 0;
+    if (total == 0) {
+        return STATUS_OK;
+    }
+
+    matches = malloc(total * sizeof(BinderService*));
+    if (matches == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+
+    HashMap_for_each_entry(base, cur, bkt)
+    {
+        BinderService* service = cur->pvalue;
+
+        if (dumpPriority != DUMP_PRIORITY_ANY && (service->dumpPriority & dumpPriority) == 0) {
+            continue;
+        }
+        if (strcmp(String_data(&service->name), startAfter) <= 0) {
+            continue;
+        }
+        matches[(*count)++] = service;
+    }
+
+    qsort(matches, *count, sizeof(BinderService*), ServiceManager_compareServiceName);
+    *services = matches;
+    return STATUS_OK;
+}
+
+static int32_t ServiceManager_collectServices(ServiceManager* this, int32_t dumpPriority,
+    const char* startAfter, size_t maxCount, VectorString* aidl_return)
+{
+    BinderService** services;
+    size_t count;
+    int32_t status;
+
+    status = ServiceManager_sortServices(this, dumpPriority, startAfter, &services, &count);
+    if (status != STATUS_OK) {
+        return status;
     }
 
+    for (size_t i = 0; i < count && i < maxCount; i++) {
+        aidl_return->add(aidl_return, &services[i]->name);
+    }
+
+    free(services);
     return STATUS_OK;
 }
 
 static int32_t ServiceManager_listServices(ServiceManager* this, int32_t dumpPriority,
     VectorString* aidl_return)
 {
-    BINDER_LOGE("Not support still\n");
-    return STATUS_OK;
+    return ServiceManager_collectServices(this, dumpPriority, "", SIZE_MAX, aidl_return);
+}
+
+static int32_t ServiceManager_listServicesPaged(ServiceManager* this, int32_t dumpPriority,
+    String* startAfter, int32_t maxCount, VectorString* aidl_return)
+{
+    if (maxCount <= 0 || maxCount > AIDL_SERVICE_MANAGER_MAX_LIST_SERVICES) {
+        BINDER_LOGE("listServicesPaged asked for %" PRId32 " names, at most %d\n",
+            maxCount, AIDL_SERVICE_MANAGER_MAX_LIST_SERVICES);
+        return STATUS_BAD_VALUE;
+    }
+
+    return ServiceManager_collectServices(this, dumpPriority, String_data(startAfter),
+        maxCount, aidl_return);
+}
+
+static void ServiceManager_freeRegistrations(BinderRegistrations* regs)
+{
+    regs->mServices.dtor(&regs->mServices);
+    regs->mCallbackLists.dtor(&regs->mCallbackLists);
+    regs->mClientCallbackLists.dtor(&regs->mClientCallbackLists);
+    free(regs);
+}
+
+static int ServiceManager_indexOfList(const VectorImpl* lists, const VectorImpl* callbacks)
+{
+    for (int i = 0; i < lists->size(lists); i++) {
+        if (lists->get(lists, i) == callbacks) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* A binder with nothing left registered drops its death link, or every
+ * callback object a client ever passed would stay linked. Its last
+ * strong reference would unlink it anyway.
+ */
+
+static void ServiceManager_releaseRegistrations(ServiceManager* this, IBinder* who,
+    BinderRegistrations* regs)
+{
+    if (regs->mServices.size(&regs->mServices) == 0
+        && regs->mCallbackLists.size(&regs->mCallbackLists) == 0
+        && regs->mClientCallbackLists.size(&regs->mClientCallbackLists) == 0) {
+        this->mBinderToRegistrations.erase(&this->mBinderToRegistrations, (long)who);
+        if (who->remoteBinder(who) != NULL) {
+            who->unlinkToDeath(who, &this->m_DeathRecipient, NULL, 0, NULL);
+        }
+        ServiceManager_freeRegistrations(regs);
+    }
+}
+
+/* The callback has left callbacks, so its death no longer has to visit
+ * the list.
+ */
+
+static void ServiceManager_forgetCallbackList(ServiceManager* this, IBinder* who,
+    VectorImpl* callbacks)
+{
+    BinderRegistrations* regs = NULL;
+    int index;
+
+    if (this->mBinderToRegistrations.find(&this->mBinderToRegistrations,
+            (long)who, (long*)&regs)
+        != STATUS_OK) {
+        return;
+    }
+
+    index = ServiceManager_indexOfList(&regs->mCallbackLists, callbacks);
+    if (index >= 0) {
+        regs->mCallbackLists.removeAt(&regs->mCallbackLists, index);
+    }
+    ServiceManager_releaseRegistrations(this, who, regs);
 }
 
 static int32_t ServiceManager_registerForNotifications(ServiceManager* this, String* name,
     const IServiceCallback* callback)
 {
-    BINDER_LOGE("Not support still\n");
+    IBinder* binder = (IBinder*)callback;
+    VectorImpl* callbacks = NULL;
+    BinderService* service = NULL;
+    BpServiceCallback* cb;
+
+    if (binder == NULL || !isValidServiceName(String_data(name))) {
+        BINDER_LOGE("Invalid service name or callback: %s\n", String_data(name));
+        return STATUS_BAD_VALUE;
+    }
+
+    /* A dead client never unregisters, its callbacks go in binderDied() */
+
+    BinderRegistrations* regs = this->getRegistrations(this, binder);
+
+    if (regs == NULL) {
+        BINDER_LOGE("Could not linkToDeath when registering for %s\n", String_data(name));
+        return STATUS_BAD_VALUE;
+    }
+
+    cb = BpServiceCallback_new(binder);
+    if (cb == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+
+    this->mNameToRegistrationCallback.find(&this->mNameToRegistrationCallback,
+        (long)name, (long*)&callbacks);
+    if (callbacks == NULL) {
+        callbacks = VectorImpl_new();
+        if (this->mNameToRegistrationCallback.put(&this->mNameToRegistrationCallback,
+                (long)name, (long)callbacks)
+            != STATUS_OK) {
+            VectorImpl_delete(callbacks);
+            BpServiceCallback_delete(cb);
+            return STATUS_NO_MEMORY;
+        }
+    }
+    callbacks->push(callbacks, cb);
+    if (ServiceManager_indexOfList(&regs->mCallbackLists, callbacks) < 0) {
+        regs->mCallbackLists.push(&regs->mCallbackLists, callbacks);
+    }
+
+    /* The service may have been added before the caller asked, tell it
+     * right away so it never has to poll.
+     */
+
+    this->mNameToService.find(&this->mNameToService, (long)name, (long*)&service);
+    if (service != NULL && service->binder != NULL) {
+        cb->onRegistration(cb, name, service->binder);
+    }
+
     return STATUS_OK;
 }
 
 static int32_t ServiceManager_unregisterForNotifications(ServiceManager* this, String* name,
     const IServiceCallback* callback)
 {
-    BINDER_LOGE("Not support still\n");
+    VectorImpl* callbacks = NULL;
+    bool found = false;
+
+    this->mNameToRegistrationCallback.find(&this->mNameToRegistrationCallback,
+        (long)name, (long*)&callbacks);
+    if (callbacks != NULL) {
+        this->removeRegistrationCallback(this, (IBinder*)callback, callbacks, &found);
+    }
+
+    if (!found) {
+        BINDER_LOGE("Trying to unregister callback, but none exists %s\n", String_data(name));
+        return STATUS_BAD_VALUE;
+    }
+
+    ServiceManager_forgetCallbackList(this, (IBinder*)callback, callbacks);
     return STATUS_OK;
 }
 
 static int32_t ServiceManager_isDeclared(ServiceManager* this, String* name, bool* _aidl_return)
 {
-    BINDER_LOGE("Not support still\n");
+    *_aidl_return = this->mManifest.isDeclared(&this->mManifest, String_data(name));
     return STATUS_OK;
 }
 
 static int32_t ServiceManager_getDeclaredInstances(ServiceManager* this, String* iface,
     VectorString* aidl_return)
 {
-    BINDER_LOGE("Not support still\n");
+    this->mManifest.getDeclaredInstances(&this->mManifest, String_data(iface), aidl_return);
     return STATUS_OK;
 }
 
@@ -220,60 +598,430 @@ static int32_t ServiceManager_registerClientCallback(ServiceManager* this, Strin
     const IBinder* service,
     const IClientCallback* callback)
 {
-    BINDER_LOGE("Not support still\n");
+    IBinder* binder = (IBinder*)callback;
+    VectorImpl* callbacks = NULL;
+    BinderService* registered = NULL;
+    BpClientCallback* cb;
+
+    if (binder == NULL) {
+        return STATUS_BAD_VALUE;
+    }
+
+    this->mNameToService.find(&this->mNameToService, (long)name, (long*)&registered);
+    if (registered == NULL || registered->binder != service) {
+        BINDER_LOGE("Could not add client callback for %s, service not registered "
+                    "with this binder\n",
+            String_data(name));
+        return STATUS_BAD_VALUE;
+    }
+
+    /* The callback usually lives in the service process, and goes
+     * with it in binderDied().
+     */
+
+    BinderRegistrations* regs = this->getRegistrations(this, binder);
+
+    if (regs == NULL) {
+        BINDER_LOGE("Could not linkToDeath when adding client callback for %s\n", String_data(name));
+        return STATUS_BAD_VALUE;
+    }
+
+    cb = BpClientCallback_new(binder);
+    if (cb == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+
+    this->mNameToClientCallback.find(&this->mNameToClientCallback,
+        (long)name, (long*)&callbacks);
+    if (callbacks == NULL) {
+        callbacks = VectorImpl_new();
+        if (this->mNameToClientCallback.put(&this->mNameToClientCallback,
+                (long)name, (long)callbacks)
+            != STATUS_OK) {
+            VectorImpl_delete(callbacks);
+            BpClientCallback_delete(cb);
+            return STATUS_NO_MEMORY;
+        }
+    }
+    callbacks->push(callbacks, cb);
+    if (ServiceManager_indexOfList(&regs->mClientCallbackLists, callbacks) < 0) {
+        regs->mClientCallbackLists.push(&regs->mClientCallbackLists, callbacks);
+    }
+
+    /* Make sure all callbacks have been told about a consistent state */
+
+    if (registered->hasClients) {
+        cb->onClients(cb, registered->binder, true);
+    }
+
     return STATUS_OK;
 }
 
 static int32_t ServiceManager_tryUnregisterService(ServiceManager* this, String* name,
-    const IBinder* service)
+    const IBinder* binder)
 {
-    BINDER_LOGE("Not support still\n");
+    BinderService* service = NULL;
+    LazyService* lazy = NULL;
+    ssize_t clients;
+
+    if (binder == NULL) {
+        return STATUS_BAD_VALUE;
+    }
+
+    this->mNameToService.find(&this->mNameToService, (long)name, (long*)&service);
+    if (service == NULL) {
+        BINDER_LOGW("Tried to unregister %s, but that service wasn't registered\n", String_data(name));
+        return STATUS_INVALID_OPERATION;
+    }
+
+    if (service->binder != binder) {
+        BINDER_LOGW("Tried to unregister %s, but a different service is registered\n", String_data(name));
+        return STATUS_BAD_VALUE;
+    }
+
+    if (service->guaranteeClient) {
+        BINDER_LOGI("Tried to unregister %s, but there is about to be a client\n", String_data(name));
+        return STATUS_INVALID_OPERATION;
+    }
+
+    /* clients < 0: the driver can't tell, assume there are clients.
+     * Otherwise one reference is held by this transaction and one by
+     * servicemanager, anything above that is a real client.
+     */
+
+    clients = this->handleServiceClientCallback(this, name, false);
+    if (clients < 0 || clients > 2) {
+        BINDER_LOGI("Tried to unregister %s, but there are clients\n", String_data(name));
+
+        /* The service may have been told it had none, keep it running */
+
+        this->sendClientCallbackNotifications(this, name, true);
+        return STATUS_INVALID_OPERATION;
+    }
+
+    BINDER_LOGI("Unregistering %s\n", String_data(name));
+    this->mNameToService.erase(&this->mNameToService, (long)name);
+    this->removeService(this, service);
+
+    /* It exits now, a getService() meanwhile must start a new one */
+
+    this->mNameToLazyService.find(&this->mNameToLazyService, (long)name, (long*)&lazy);
+    if (lazy != NULL) {
+        lazy->exiting = true;
+    }
+
     return STATUS_OK;
 }
 
-static int32_t ServiceManager_getServiceDebugInfo(ServiceManager* this, VectorString* aidl_return)
+static int32_t ServiceManager_getServiceDebugInfoPaged(ServiceManager* this, String* startAfter,
+    int32_t maxCount, VectorImpl* aidl_return)
 {
-    BINDER_LOGE("Not support still\n");
-    return STATUS_OK;
+    BinderService** services;
+    size_t count;
+    int32_t status;
+
+    if (maxCount <= 0 || maxCount > AIDL_SERVICE_MANAGER_MAX_LIST_SERVICES) {
+        BINDER_LOGE("getServiceDebugInfoPaged asked for %" PRId32 " services, at most %d\n",
+            maxCount, AIDL_SERVICE_MANAGER_MAX_LIST_SERVICES);
+        return STATUS_BAD_VALUE;
+    }
+
+    status = ServiceManager_sortServices(this, DUMP_PRIORITY_ANY, String_data(startAfter),
+        &services, &count);
+    if (status != STATUS_OK) {
+        return status;
+    }
+
+    for (size_t i = 0; i < count && i < (size_t)maxCount; i++) {
+        BinderService* service = services[i];
+        ServiceDebugInfo* info = zalloc(sizeof(ServiceDebugInfo));
+        ssize_t refs;
+
+        if (info == NULL) {
+            status = STATUS_NO_MEMORY;
+            break;
+        }
+
+        /* One reference is servicemanager's own, see addService() */
+
+        refs = service->getNodeStrongRefCount(service);
+        String_dup(&info->name, &service->name);
+        info->pid = service->debugPid;
+        info->clients = refs > 0 ? refs - 1 : -1;
+        info->lookups = service->lookups;
+        info->lastLookupMs = service->lastLookupMs;
+        aidl_return->push(aidl_return, info);
+    }
+
+    free(services);
+    return status;
 }
 
 static void ServiceManager_removeRegistrationCallback(ServiceManager* this,
-    const IBinder* who, IServiceCallback* it, bool* found)
+    const IBinder* who, VectorImpl* callbacks, bool* found)
 {
-    BINDER_LOGE("Not support still\n");
+    for (int i = callbacks->size(callbacks) - 1; i >= 0; i--) {
+        BpServiceCallback* cb = callbacks->get(callbacks, i);
+        BpRefBase* ref = &cb->m_BpIServiceCallback.m_BpRefBase;
+
+        if (ref->remote(ref) == who) {
+            callbacks->removeAt(callbacks, i);
+            BpServiceCallback_delete(cb);
+            *found = true;
+        }
+    }
 }
 
 static void ServiceManager_tryStartService(ServiceManager* this, String* name)
 {
+    LazyService* lazy = NULL;
+    char* argv[2];
+    pid_t pid;
+    int ret;
+
+    this->mNameToLazyService.find(&this->mNameToLazyService, (long)name, (long*)&lazy);
+    if (lazy == NULL) {
+        return;
+    }
+
+    /* Started before and not registered yet, it is still coming up */
+
+    if (lazy->pid > 0 && !lazy->exiting && kill(lazy->pid, 0) == 0) {
+        return;
+    }
+
+    argv[0] = lazy->program;
+    argv[1] = NULL;
+    ret = posix_spawnp(&pid, lazy->program, NULL, NULL, argv, NULL);
+    if (ret != 0) {
+        BINDER_LOGE("Could not start lazy service %s (%s): %d\n", String_data(name),
+            lazy->program, ret);
+        return;
+    }
+
+    BINDER_LOGI("Started lazy service %s as %s, pid %d\n", String_data(name),
+        lazy->program, pid);
+    lazy->pid = pid;
+    lazy->exiting = false;
 }
 
 static void ServiceManager_removeClientCallback(ServiceManager* this,
-    const IBinder* who, IClientCallback* it)
+    const IBinder* who, VectorImpl* callbacks)
 {
-    BINDER_LOGE("Not support still\n");
+    for (int i = callbacks->size(callbacks) - 1; i >= 0; i--) {
+        BpClientCallback* cb = callbacks->get(callbacks, i);
+        BpRefBase* ref = &cb->m_BpIClientCallback.m_BpRefBase;
+
+        if (ref->remote(ref) == who) {
+            callbacks->removeAt(callbacks, i);
+            BpClientCallback_delete(cb);
+        }
+    }
 }
 
-static void ServiceManager_handleClientCallbacks(const ServiceManager* this)
+static void ServiceManager_handleClientCallbacks(ServiceManager* this)
 {
-    BINDER_LOGE("Not support still\n");
+    HashMapBase* base = &this->mNameToService.m_HashMap;
+    HashMap_Entry* cur;
+    size_t bkt;
+
+    /* Only the services change state here, never the map */
+
+    HashMap_for_each_entry(base, cur, bkt)
+    {
+        BinderService* service = cur->pvalue;
+        this->handleServiceClientCallback(this, &service->name, true);
+    }
 }
 
-static ssize_t ServiceManager_handleServiceClientCallback(const ServiceManager* this,
+static ssize_t ServiceManager_handleServiceClientCallback(ServiceManager* this,
     String* serviceName, bool isCalledOnInterval)
 {
-    BINDER_LOGE("Not support still\n");
-    return 0;
+    BinderService* service = NULL;
+    VectorImpl* callbacks = NULL;
+    ssize_t count;
+    bool hasClients;
+
+    this->mNameToService.find(&this->mNameToService, (long)serviceName, (long*)&service);
+    this->mNameToClientCallback.find(&this->mNameToClientCallback,
+        (long)serviceName, (long*)&callbacks);
+    if (service == NULL || callbacks == NULL || callbacks->size(callbacks) == 0) {
+        return -1;
+    }
+
+    /* -1 when the driver has no BINDER_GET_NODE_INFO_FOR_REF */
+
+    count = service->getNodeStrongRefCount(service);
+    if (count == -1) {
+        return count;
+    }
+
+    /* servicemanager itself holds one strong reference */
+
+    hasClients = count > 1;
+
+    if (service->guaranteeClient) {
+        /* Handed out since the last check, but the client is already gone */
+
+        if (!service->hasClients && !hasClients) {
+            this->sendClientCallbackNotifications(this, serviceName, true);
+        }
+        service->guaranteeClient = false;
+    }
+
+    /* Only the interval check reports changes, so a busy service is not
+     * told on every getService()
+     */
+
+    if (isCalledOnInterval) {
+        if (hasClients && !service->hasClients) {
+            this->sendClientCallbackNotifications(this, serviceName, true);
+        }
+        if (!hasClients && service->hasClients) {
+            this->sendClientCallbackNotifications(this, serviceName, false);
+        }
+    }
+
+    return count;
 }
 
 static void ServiceManager_sendClientCallbackNotifications(ServiceManager* this,
     String* serviceName, bool hasClients)
 {
-    BINDER_LOGE("Not support still\n");
+    BinderService* service = NULL;
+    VectorImpl* callbacks = NULL;
+
+    this->mNameToService.find(&this->mNameToService, (long)serviceName, (long*)&service);
+    if (service == NULL) {
+        BINDER_LOGW("sendClientCallbackNotifications could not find %s\n", String_data(serviceName));
+        return;
+    }
+
+    this->mNameToClientCallback.find(&this->mNameToClientCallback,
+        (long)serviceName, (long*)&callbacks);
+    if (callbacks != NULL) {
+        for (int i = 0; i < callbacks->size(callbacks); i++) {
+            BpClientCallback* cb = callbacks->get(callbacks, i);
+            cb->onClients(cb, service->binder, hasClients);
+        }
+    }
+
+    service->hasClients = hasClients;
+}
+
+static BinderRegistrations* ServiceManager_getRegistrations(ServiceManager* this, IBinder* binder)
+{
+    BinderRegistrations* regs = NULL;
+
+    if (this->mBinderToRegistrations.find(&this->mBinderToRegistrations,
+            (long)binder, (long*)&regs)
+        == STATUS_OK) {
+        return regs;
+    }
+
+    /* implicitly unlinked when the binder dies */
+
+    if (binder->remoteBinder(binder) != NULL
+        && binder->linkToDeath(binder, &this->m_DeathRecipient, NULL, 0) != STATUS_OK) {
+        return NULL;
+    }
+
+    regs = zalloc(sizeof(BinderRegistrations));
+    if (regs == NULL) {
+        return NULL;
+    }
+
+    VectorImpl_ctor(&regs->mServices);
+    VectorImpl_ctor(&regs->mCallbackLists);
+    VectorImpl_ctor(&regs->mClientCallbackLists);
+    if (this->mBinderToRegistrations.put(&this->mBinderToRegistrations,
+            (long)binder, (long)regs)
+        != STATUS_OK) {
+        ServiceManager_freeRegistrations(regs);
+        return NULL;
+    }
+
+    return regs;
+}
+
+static void ServiceManager_removeService(ServiceManager* this, BinderService* service)
+{
+    BinderRegistrations* regs = NULL;
+
+    this->mBinderToRegistrations.find(&this->mBinderToRegistrations,
+        (long)service->binder, (long*)&regs);
+    if (regs != NULL) {
+        for (int i = regs->mServices.size(&regs->mServices) - 1; i >= 0; i--) {
+            if (regs->mServices.get(&regs->mServices, i) == service) {
+                regs->mServices.removeAt(&regs->mServices, i);
+                break;
+            }
+        }
+        ServiceManager_releaseRegistrations(this, service->binder, regs);
+    }
+
+    BinderService_delete(service, &this->mServiceCache);
 }
 
 static void ServiceManager_binderDied(ServiceManager* this, const IBinder* who)
 {
-    BINDER_LOGE("Not support still\n");
+    BinderRegistrations* regs = NULL;
+    bool found = false;
+
+    /* Several registrations may share a death link, only the first
+     * obituary finds the entry.
+     */
+
+    if (this->mBinderToRegistrations.find(&this->mBinderToRegistrations,
+            (long)who, (long*)&regs)
+        != STATUS_OK) {
+        return;
+    }
+    this->mBinderToRegistrations.erase(&this->mBinderToRegistrations, (long)who);
+
+    for (int i = 0; i < regs->mServices.size(&regs->mServices); i++) {
+        BinderService* service = regs->mServices.get(&regs->mServices, i);
+        BinderService* current = NULL;
+
+        BINDER_LOGI("Service %s died\n", String_data(&service->name));
+        this->mNameToService.find(&this->mNameToService, (long)&service->name, (long*)&current);
+        if (current == service) {
+            this->mNameToService.erase(&this->mNameToService, (long)&service->name);
+        }
+        BinderService_delete(service, &this->mServiceCache);
+    }
+
+    for (int i = 0; i < regs->mCallbackLists.size(&regs->mCallbackLists); i++) {
+        VectorImpl* callbacks = regs->mCallbackLists.get(&regs->mCallbackLists, i);
+        this->removeRegistrationCallback(this, who, callbacks, &found);
+    }
+
+    for (int i = 0; i < regs->mClientCallbackLists.size(&regs->mClientCallbackLists); i++) {
+        VectorImpl* callbacks = regs->mClientCallbackLists.get(&regs->mClientCallbackLists, i);
+        this->removeClientCallback(this, who, callbacks);
+    }
+
+    ServiceManager_freeRegistrations(regs);
+}
+
+static void ServiceManager_Vfun_binderDied(DeathRecipient* v_this, IBinder* who)
+{
+    ServiceManager* this = (ServiceManager*)((char*)v_this - offsetof(ServiceManager, m_DeathRecipient));
+    this->binderDied(this, who);
+}
+
+/* Only the exception goes back in the reply, not mErrorCode. A lazy
+ * service must see a refused unregister, or it would exit with clients
+ * still holding it, so the newer calls report failures this way.
+ */
+
+static void ServiceManager_setException(Status* retStatus, int32_t status)
+{
+    if (status == STATUS_BAD_VALUE) {
+        Status_fromExceptionCode(retStatus, EX_ILLEGAL_ARGUMENT, NULL);
+    } else if (status != STATUS_OK) {
+        Status_fromExceptionCode(retStatus, EX_ILLEGAL_STATE, NULL);
+    }
 }
 
 static void ServiceManager_Vfun_getService(BnAIDLServiceManager* v_this, String* name, IBinder** aidl_return,
@@ -302,7 +1050,7 @@ static void ServiceManager_Vfun_listServices(BnAIDLServiceManager* v_this, int32
     VectorString* aidl_return, Status* retStatus)
 {
     ServiceManager* this = (ServiceManager*)v_this;
-    retStatus->mErrorCode = this->listServices(this, dumpPriority, aidl_return);
+    ServiceManager_setException(retStatus, this->listServices(this, dumpPriority, aidl_return));
 }
 
 static void ServiceManager_Vfun_registerForNotifications(BnAIDLServiceManager* v_this, String* name,
@@ -341,29 +1089,146 @@ static void ServiceManager_Vfun_registerClientCallback(BnAIDLServiceManager* v_t
     Status* retStatus)
 {
     ServiceManager* this = (ServiceManager*)v_this;
-    retStatus->mErrorCode = this->registerClientCallback(this, name, service, callback);
+    ServiceManager_setException(retStatus, this->registerClientCallback(this, name, service, callback));
 }
 
 static void ServiceManager_Vfun_tryUnregisterService(BnAIDLServiceManager* v_this, String* name,
     const IBinder* service, Status* retStatus)
 {
     ServiceManager* this = (ServiceManager*)v_this;
-    retStatus->mErrorCode = this->tryUnregisterService(this, name, service);
+    ServiceManager_setException(retStatus, this->tryUnregisterService(this, name, service));
 }
 
-static void ServiceManager_Vfun_getServiceDebugInfo(BnAIDLServiceManager* v_this, VectorString* aidl_return,
-    Status* retStatus)
+static void ServiceManager_Vfun_getServices(BnAIDLServiceManager* v_this, VectorString* names,
+    VectorImpl* aidl_return, Status* retStatus)
 {
     ServiceManager* this = (ServiceManager*)v_this;
-    retStatus->mErrorCode = this->getServiceDebugInfo(this, aidl_return);
+    ServiceManager_setException(retStatus, this->getServices(this, names, aidl_return));
 }
 
+static void ServiceManager_Vfun_listServicesPaged(BnAIDLServiceManager* v_this, int32_t dumpPriority,
+    String* startAfter, int32_t maxCount, VectorString* aidl_return, Status* retStatus)
+{
+    ServiceManager* this = (ServiceManager*)v_this;
+    ServiceManager_setException(retStatus,
+        this->listServicesPaged(this, dumpPriority, startAfter, maxCount, aidl_return));
+}
+
+static void ServiceManager_Vfun_getServiceDebugInfoPaged(BnAIDLServiceManager* v_this, String* startAfter,
+    int32_t maxCount, VectorImpl* aidl_return, Status* retStatus)
+{
+    ServiceManager* this = (ServiceManager*)v_this;
+    ServiceManager_setException(retStatus,
+        this->getServiceDebugInfoPaged(this, startAfter, maxCount, aidl_return));
+}
+
+static void ServiceManager_freeCallbacks(const void* key, void* value)
+{
+    VectorImpl* callbacks = value;
+
+    for (int i = 0; i < callbacks->size(callbacks); i++) {
+        BpServiceCallback_delete(callbacks->get(callbacks, i));
+    }
+    VectorImpl_delete(callbacks);
+}
+
+static void ServiceManager_freeClientCallbacks(const void* key, void* value)
+{
+    VectorImpl* callbacks = value;
+
+    for (int i = 0; i < callbacks->size(callbacks); i++) {
+        BpClientCallback_delete(callbacks->get(callbacks, i));
+    }
+    VectorImpl_delete(callbacks);
+}
+
+static void ServiceManager_freeLazyService(const void* key, void* value)
+{
+    free(value);
+}
+
+static void ServiceManager_freeRegistrationsEntry(const void* key, void* value)
+{
+    ServiceManager_freeRegistrations(value);
+}
+
+#ifdef CONFIG_BINDER_SVCMANAGER_LAZY_SERVICES
+static void ServiceManager_addLazyServices(ServiceManager* this, const char* list)
+{
+    char* entries = strdup(list);
+    char* saveptr = NULL;
+    char* entry;
+
+    if (entries == NULL) {
+        return;
+    }
+
+    /* "name=program name=program ..." */
+
+    for (entry = strtok_r(entries, " ", &saveptr); entry != NULL;
+         entry = strtok_r(NULL, " ", &saveptr)) {
+        char* program = strchr(entry, '=');
+        LazyService* lazy;
+        String name;
+
+        if (program == NULL || program[1] == '\0') {
+            BINDER_LOGE("Invalid lazy service entry: %s\n", entry);
+            continue;
+        }
+        *program++ = '\0';
+        if (!isValidServiceName(entry)) {
+            BINDER_LOGE("Invalid lazy service name: %s\n", entry);
+            continue;
+        }
+
+        String_init(&name, entry);
+        if (this->mNameToLazyService.find(&this->mNameToLazyService, (long)&name, NULL)
+            == STATUS_OK) {
+            BINDER_LOGE("Duplicate lazy service: %s\n", entry);
+            continue;
+        }
+
+        lazy = zalloc(sizeof(LazyService) + strlen(program) + 1);
+        if (lazy == NULL) {
+            break;
+        }
+        strcpy(lazy->program, program);
+
+        if (this->mNameToLazyService.put(&this->mNameToLazyService, (long)&name, (long)lazy)
+            != STATUS_OK) {
+            free(lazy);
+        }
+    }
+
+    free(entries);
+}
+#endif
+
 static void ServiceManager_dtor(ServiceManager* this)
 {
+    this->mBinderToRegistrations.iterator(&this->mBinderToRegistrations,
+        ServiceManager_freeRegistrationsEntry);
+    this->mBinderToRegistrations.dtor(&this->mBinderToRegistrations);
+    this->mNameToRegistrationCallback.iterator(&this->mNameToRegistrationCallback,
+        ServiceManager_freeCallbacks);
+    this->mNameToClientCallback.iterator(&this->mNameToClientCallback,
+        ServiceManager_freeClientCallbacks);
+    this->mNameToLazyService.iterator(&this->mNameToLazyService,
+        ServiceManager_freeLazyService);
     this->m_DeathRecipient.dtor(&this->m_DeathRecipient);
     this->mNameToService.dtor(&this->mNameToService);
     this->mNameToRegistrationCallback.dtor(&this->mNameToRegistrationCallback);
     this->mNameToClientCallback.dtor(&this->mNameToClientCallback);
+    this->mNameToLazyService.dtor(&this->mNameToLazyService);
+    while (!RingBuffer_isEmpty(&this->mNotificationQueue)) {
+        PendingNotification* pending = RingBuffer_pop(&this->mNotificationQueue);
+
+        free(pending);
+    }
+    RingBuffer_destroy(&this->mNotificationQueue);
+    this->mNameToPendingNotification.dtor(&this->mNameToPendingNotification);
+    this->mManifest.dtor(&this->mManifest);
+    SlabCache_destroy(&this->mServiceCache);
 }
 
 static void ServiceManager_ctor(ServiceManager* this)
@@ -375,6 +1240,13 @@ static void ServiceManager_ctor(ServiceManager* this)
     HashMap_String_ctor(&this->mNameToService);
     HashMap_String_ctor(&this->mNameToRegistrationCallback);
     HashMap_String_ctor(&this->mNameToClientCallback);
+    HashMap_ctor(&this->mBinderToRegistrations);
+    HashMap_String_ctor(&this->mNameToLazyService);
+    ServiceManifest_ctor(&this->mManifest);
+    RingBuffer_init(&this->mNotificationQueue);
+    HashMap_String_ctor(&this->mNameToPendingNotification);
+    memset(&this->mNotificationStats, 0, sizeof(NotificationStats));
+    SlabCache_init(&this->mServiceCache, NULL, "BinderService", sizeof(BinderService));
 
     aidl = &this->m_BnServiceManager;
 
@@ -389,7 +1261,9 @@ static void ServiceManager_ctor(ServiceManager* this)
     aidl->getDeclaredInstances = ServiceManager_Vfun_getDeclaredInstances;
     aidl->registerClientCallback = ServiceManager_Vfun_registerClientCallback;
     aidl->tryUnregisterService = ServiceManager_Vfun_tryUnregisterService;
-    aidl->getServiceDebugInfo = ServiceManager_Vfun_getServiceDebugInfo;
+    aidl->getServices = ServiceManager_Vfun_getServices;
+    aidl->listServicesPaged = ServiceManager_Vfun_listServicesPaged;
+    aidl->getServiceDebugInfoPaged = ServiceManager_Vfun_getServiceDebugInfoPaged;
 
     this->getService = ServiceManager_getService;
     this->checkService = ServiceManager_checkService;
@@ -401,9 +1275,12 @@ static void ServiceManager_ctor(ServiceManager* this)
     this->getDeclaredInstances = ServiceManager_getDeclaredInstances;
     this->registerClientCallback = ServiceManager_registerClientCallback;
     this->tryUnregisterService = ServiceManager_tryUnregisterService;
-    this->getServiceDebugInfo = ServiceManager_getServiceDebugInfo;
+    this->getServices = ServiceManager_getServices;
+    this->listServicesPaged = ServiceManager_listServicesPaged;
+    this->getServiceDebugInfoPaged = ServiceManager_getServiceDebugInfoPaged;
 
     /* Virtual function override at IBinder::DeathRecipient */
+    this->m_DeathRecipient.binderDied = ServiceManager_Vfun_binderDied;
     this->binderDied = ServiceManager_binderDied;
 
     /* Virtual function */
@@ -414,10 +1291,23 @@ static void ServiceManager_ctor(ServiceManager* this)
     this->sendClientCallbackNotifications = ServiceManager_sendClientCallbackNotifications;
     this->handleServiceClientCallback = ServiceManager_handleServiceClientCallback;
     this->handleClientCallbacks = ServiceManager_handleClientCallbacks;
+    this->drainNotifications = ServiceManager_drainNotifications;
+    this->logNotificationStats = ServiceManager_logNotificationStats;
     this->removeClientCallback = ServiceManager_removeClientCallback;
     this->removeRegistrationCallback = ServiceManager_removeRegistrationCallback;
+    this->getRegistrations = ServiceManager_getRegistrations;
+    this->removeService = ServiceManager_removeService;
+    this->queueNotification = ServiceManager_queueNotification;
 
     this->dtor = ServiceManager_dtor;
+
+#ifdef CONFIG_BINDER_SVCMANAGER_LAZY_SERVICES
+    ServiceManager_addLazyServices(this, CONFIG_BINDER_SVCMANAGER_LAZY_SERVICES);
+#endif
+
+    if (CONFIG_BINDER_SVCMANAGER_MANIFEST[0] != '\0') {
+        this->mManifest.load(&this->mManifest, CONFIG_BINDER_SVCMANAGER_MANIFEST);
+    }
 }
 
 ServiceManager* ServiceManager_new()
@@ -26,6 +26,20 @@
 #include "base/IServiceCallback.h"
 #include "base/Status.h"
 #include "utils/HashMap.h"
+#include "utils/RingBuffer.h"
+#include "utils/Slab.h"
+#include "utils/Timers.h"
+#include "utils/Vector.h"
+
+#include "ServiceManifest.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_BINDER_SVCMANAGER_CLIENT_CHECK_INTERVAL
+#define CONFIG_BINDER_SVCMANAGER_CLIENT_CHECK_INTERVAL 5000
+#endif
 
 /****************************************************************************
  * Public Types
@@ -35,18 +49,76 @@ struct BinderService;
 typedef struct BinderService BinderService;
 
 struct BinderService {
+    String name;
     IBinder* binder;
     bool allowIsolated;
     int32_t dumpPriority;
     bool hasClients;
     bool guaranteeClient;
     pid_t debugPid;
+    int64_t lookups; /* Lookups that found it, kept across re-registration */
+    int64_t lastLookupMs;
 
     void (*dtor)(BinderService* this);
     ssize_t (*getNodeStrongRefCount)(BinderService* this);
 };
 
-BinderService* BinderService_new(void);
+BinderService* BinderService_new(SlabCache* cache);
+
+/* Everything registered with one binder, so that its death is handled
+ * in O(k) of its own entries instead of walking every name.
+ */
+
+struct BinderRegistrations;
+typedef struct BinderRegistrations BinderRegistrations;
+
+struct BinderRegistrations {
+    VectorImpl mServices; /* BinderService* added with this binder */
+    VectorImpl mCallbackLists; /* mNameToRegistrationCallback values it is in */
+    VectorImpl mClientCallbackLists; /* mNameToClientCallback values it is in */
+};
+
+/* A service that servicemanager starts itself on the first getService(),
+ * see CONFIG_BINDER_SVCMANAGER_LAZY_SERVICES.
+ */
+
+struct LazyService;
+typedef struct LazyService LazyService;
+
+struct LazyService {
+    pid_t pid; /* Last instance started, 0 if none */
+    bool exiting; /* That instance has unregistered and is going away */
+    char program[];
+};
+
+/* A registration not yet told to its listeners. There is one per name,
+ * re-adding the name meanwhile coalesces into it and the listeners get
+ * whatever binder is registered when it goes out.
+ */
+
+struct PendingNotification;
+typedef struct PendingNotification PendingNotification;
+
+struct PendingNotification {
+    String name;
+    nsecs_t queuedAt; /* uptimeNanos() of the first addService() */
+};
+
+/* Latency runs from addService() to the oneway onRegistration() */
+
+struct NotificationStats;
+typedef struct NotificationStats NotificationStats;
+
+struct NotificationStats {
+    uint64_t queued;
+    uint64_t coalesced; /* Registrations folded into a pending one */
+    uint64_t delivered; /* Names fanned out, not calls made */
+    uint64_t dropped; /* Service gone before its turn */
+    uint64_t reported; /* delivered at the last logNotificationStats() */
+    size_t maxDepth;
+    nsecs_t totalLatency;
+    nsecs_t maxLatency;
+};
 
 struct ServiceManager;
 typedef struct ServiceManager ServiceManager;
@@ -71,7 +143,11 @@ struct ServiceManager {
     int32_t (*registerClientCallback)(ServiceManager* this, String* name, const IBinder* service,
         const IClientCallback* callback);
     int32_t (*tryUnregisterService)(ServiceManager* this, String* name, const IBinder* service);
-    int32_t (*getServiceDebugInfo)(ServiceManager* this, VectorString* aidl_return);
+    int32_t (*getServices)(ServiceManager* this, VectorString* names, VectorImpl* aidl_return);
+    int32_t (*listServicesPaged)(ServiceManager* this, int32_t dumpPriority, String* startAfter,
+        int32_t maxCount, VectorString* aidl_return);
+    int32_t (*getServiceDebugInfoPaged)(ServiceManager* this, String* startAfter, int32_t maxCount,
+        VectorImpl* aidl_return);
 
     /* Virtual function override at IBinder::DeathRecipient */
     void (*binderDied)(ServiceManager* this, const IBinder* who);
@@ -80,17 +156,31 @@ struct ServiceManager {
     void (*tryStartService)(ServiceManager* this, String* name);
 
     /* Member function */
-    void (*handleClientCallbacks)(const ServiceManager* this);
+    void (*handleClientCallbacks)(ServiceManager* this);
+    /* Fans out at most maxCount queued names, returns how many are left */
+    size_t (*drainNotifications)(ServiceManager* this, size_t maxCount);
+    void (*logNotificationStats)(ServiceManager* this);
     void (*removeRegistrationCallback)(ServiceManager* this, const IBinder* who,
-        IServiceCallback* it, bool* found);
-    ssize_t (*handleServiceClientCallback)(const ServiceManager* this, String* serviceName, bool isCalledOnInterval);
+        VectorImpl* callbacks, bool* found);
+    ssize_t (*handleServiceClientCallback)(ServiceManager* this, String* serviceName, bool isCalledOnInterval);
     void (*sendClientCallbackNotifications)(ServiceManager* this, String* serviceName, bool hasClients);
-    void (*removeClientCallback)(ServiceManager* this, const IBinder* who, IClientCallback* it);
+    void (*removeClientCallback)(ServiceManager* this, const IBinder* who, VectorImpl* callbacks);
     IBinder* (*tryGetService)(ServiceManager* this, String* name, bool startIfNotFound);
+    BinderRegistrations* (*getRegistrations)(ServiceManager* this, IBinder* binder);
+    void (*removeService)(ServiceManager* this, BinderService* service);
+    void (*queueNotification)(ServiceManager* this, String* name);
 
     HashMap mNameToService;
-    HashMap mNameToRegistrationCallback;
-    HashMap mNameToClientCallback;
+    HashMap mNameToRegistrationCallback; /* VectorImpl* of BpServiceCallback* */
+    HashMap mNameToClientCallback; /* VectorImpl* of BpClientCallback* */
+    HashMap mBinderToRegistrations; /* IBinder* -> BinderRegistrations* */
+    HashMap mNameToLazyService; /* LazyService* */
+    ServiceManifest mManifest; /* What isDeclared() answers from */
+    RingBuffer mNotificationQueue; /* PendingNotification* in addService() order */
+    HashMap mNameToPendingNotification; /* PendingNotification* */
+    NotificationStats mNotificationStats;
+
+    SlabCache mServiceCache;
 };
 
 ServiceManager* ServiceManager_new(void);
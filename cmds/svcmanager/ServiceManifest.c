@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "ServiceManifest"
+
+#include <endian.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/BinderString.h"
+#include "utils/Binderlog.h"
+#include <android/binder_status.h>
+
+#include "ServiceManifest.h"
+
+static const char* ServiceManifest_name(ServiceManifest* this, size_t index)
+{
+    return this->mStrings + le32toh(this->mEntries[index].offset);
+}
+
+/* Checked once here, so that lookups can trust every offset */
+
+static bool ServiceManifest_validate(ServiceManifest* this)
+{
+    const ServiceManifestHeader* header = this->mBase;
+    uint32_t strings;
+    uint32_t count;
+    size_t stringsSize;
+
+    if (this->mSize < sizeof(ServiceManifestHeader)
+        || le32toh(header->magic) != SERVICE_MANIFEST_MAGIC
+        || le32toh(header->version) != SERVICE_MANIFEST_VERSION) {
+        return false;
+    }
+
+    /* The entries sit between the header and the string table */
+
+    strings = le32toh(header->strings);
+    count = le32toh(header->count);
+    if (strings < sizeof(ServiceManifestHeader) || strings > this->mSize
+        || count > (strings - sizeof(ServiceManifestHeader)) / sizeof(ServiceManifestEntry)) {
+        return false;
+    }
+
+    this->mEntries = (const ServiceManifestEntry*)(header + 1);
+    this->mStrings = (const char*)this->mBase + strings;
+    this->mCount = count;
+    stringsSize = this->mSize - strings;
+
+    for (uint32_t i = 0; i < this->mCount; i++) {
+        uint32_t offset = le32toh(this->mEntries[i].offset);
+        uint32_t length = le32toh(this->mEntries[i].length);
+
+        if (offset >= stringsSize || length >= stringsSize - offset
+            || this->mStrings[offset + length] != '\0') {
+            return false;
+        }
+        if (i > 0 && strcmp(ServiceManifest_name(this, i - 1), ServiceManifest_name(this, i)) >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void ServiceManifest_unload(ServiceManifest* this)
+{
+    if (this->mBase != NULL) {
+        munmap(this->mBase, this->mSize);
+    }
+    this->mBase = NULL;
+    this->mSize = 0;
+    this->mEntries = NULL;
+    this->mStrings = NULL;
+    this->mCount = 0;
+}
+
+static int32_t ServiceManifest_load(ServiceManifest* this, const char* path)
+{
+    struct stat st;
+    void* base;
+    int fd;
+
+    ServiceManifest_unload(this);
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        BINDER_LOGI("No service manifest at %s\n", path);
+        return STATUS_OK;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        BINDER_LOGE("Could not stat service manifest %s\n", path);
+        return STATUS_BAD_VALUE;
+    }
+
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        BINDER_LOGE("Could not map service manifest %s: %d\n", path, errno);
+        return STATUS_NO_MEMORY;
+    }
+
+    this->mBase = base;
+    this->mSize = st.st_size;
+    if (!ServiceManifest_validate(this)) {
+        BINDER_LOGE("Malformed service manifest %s\n", path);
+        ServiceManifest_unload(this);
+        return STATUS_BAD_VALUE;
+    }
+
+    BINDER_LOGI("Loaded %" PRIu32 " declared services from %s\n", this->mCount, path);
+    return STATUS_OK;
+}
+
+/* Index of the first entry not sorting before name */
+
+static size_t ServiceManifest_lowerBound(ServiceManifest* this, const char* name)
+{
+    size_t low = 0;
+    size_t high = this->mCount;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if (strcmp(ServiceManifest_name(this, mid), name) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static bool ServiceManifest_isDeclared(ServiceManifest* this, const char* name)
+{
+    size_t index = this->lowerBound(this, name);
+
+    return index < this->mCount && strcmp(ServiceManifest_name(this, index), name) == 0;
+}
+
+static void ServiceManifest_getDeclaredInstances(ServiceManifest* this, const char* iface,
+    VectorString* instances)
+{
+    char prefix[STRING_INIT_CAPACITY + 1];
+    size_t length;
+    size_t index;
+
+    length = snprintf(prefix, sizeof(prefix), "%s/", iface);
+    if (length >= sizeof(prefix)) {
+        return;
+    }
+
+    for (index = this->lowerBound(this, prefix); index < this->mCount; index++) {
+        const char* name = ServiceManifest_name(this, index);
+        String instance;
+
+        if (strncmp(name, prefix, length) != 0) {
+            break;
+        }
+        String_init(&instance, name + length);
+        instances->add(instances, &instance);
+    }
+}
+
+static void ServiceManifest_dtor(ServiceManifest* this)
+{
+    ServiceManifest_unload(this);
+}
+
+void ServiceManifest_ctor(ServiceManifest* this)
+{
+    this->mBase = NULL;
+    this->mSize = 0;
+    this->mEntries = NULL;
+    this->mStrings = NULL;
+    this->mCount = 0;
+
+    this->load = ServiceManifest_load;
+    this->isDeclared = ServiceManifest_isDeclared;
+    this->getDeclaredInstances = ServiceManifest_getDeclaredInstances;
+    this->lowerBound = ServiceManifest_lowerBound;
+    this->dtor = ServiceManifest_dtor;
+}
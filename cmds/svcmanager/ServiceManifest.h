@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BINDER_CMDS_SVCMANAGER_SERVICEMANIFEST_H__
+#define __BINDER_CMDS_SVCMANAGER_SERVICEMANIFEST_H__
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/Vector.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_BINDER_SVCMANAGER_MANIFEST
+#define CONFIG_BINDER_SVCMANAGER_MANIFEST ""
+#endif
+
+#define SERVICE_MANIFEST_MAGIC 0x4d435653 /* "SVCM" */
+#define SERVICE_MANIFEST_VERSION 1
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* The services a product declares, generated at build time by
+ * mkmanifest.py. All fields are little endian:
+ *
+ *   ServiceManifestHeader
+ *   ServiceManifestEntry[count], sorted by name
+ *   "interface/instance\0" strings, at strings
+ *
+ * Sorted by full name, the instances of an interface are adjacent.
+ */
+
+struct ServiceManifestHeader;
+typedef struct ServiceManifestHeader ServiceManifestHeader;
+
+struct ServiceManifestHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t strings; /* File offset of the string table */
+};
+
+struct ServiceManifestEntry;
+typedef struct ServiceManifestEntry ServiceManifestEntry;
+
+struct ServiceManifestEntry {
+    uint32_t offset; /* Of the name in the string table */
+    uint32_t length; /* Of the name, without its terminator */
+};
+
+struct ServiceManifest;
+typedef struct ServiceManifest ServiceManifest;
+
+struct ServiceManifest {
+    void (*dtor)(ServiceManifest* this);
+
+    /* Maps path read-only, a missing file leaves the manifest empty */
+    int32_t (*load)(ServiceManifest* this, const char* path);
+    bool (*isDeclared)(ServiceManifest* this, const char* name);
+    void (*getDeclaredInstances)(ServiceManifest* this, const char* iface,
+        VectorString* instances);
+
+    /* Member function */
+    size_t (*lowerBound)(ServiceManifest* this, const char* name);
+
+    void* mBase;
+    size_t mSize;
+    const ServiceManifestEntry* mEntries;
+    const char* mStrings;
+    uint32_t mCount;
+};
+
+void ServiceManifest_ctor(ServiceManifest* this);
+
+#endif /* __BINDER_CMDS_SVCMANAGER_SERVICEMANIFEST_H__ */
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2023 Xiaomi Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+"""Build the service manifest servicemanager maps at startup.
+
+Every input line names one declared service as "interface/instance",
+blank lines and "#" comments are skipped. --names takes more of them
+from the command line, as the Makefiles pass the Kconfig list. The
+output layout is the one ServiceManifest.h describes, names sorted
+bytewise as strcmp() does.
+
+    mkmanifest.py -o servicemanifest.bin product.txt [more.txt ...]
+    mkmanifest.py -o servicemanifest.bin --names a.IFoo/default [...]
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x4D435653  # "SVCM"
+VERSION = 1
+MAX_NAME = 63  # A String holds 64 bytes with the terminator
+
+
+def check_name(where, name):
+    iface, sep, instance = name.partition("/")
+    if not sep or not iface or not instance:
+        sys.exit(f"{where}: expected interface/instance, got {name!r}")
+    if len(name.encode("utf-8")) > MAX_NAME:
+        sys.exit(f"{where}: {name!r} is longer than {MAX_NAME} bytes")
+    return name.encode("utf-8")
+
+
+def read_names(paths, extra):
+    names = set()
+    for path in paths:
+        with open(path, encoding="utf-8") as f:
+            for lineno, line in enumerate(f, 1):
+                name = line.split("#", 1)[0].strip()
+                if name:
+                    names.add(check_name(f"{path}:{lineno}", name))
+    for name in extra:
+        names.add(check_name("--names", name))
+    return sorted(names)
+
+
+def build(names):
+    header_size = struct.calcsize("<4I")
+    entry_size = struct.calcsize("<2I")
+    strings_offset = header_size + entry_size * len(names)
+
+    entries = b""
+    strings = b""
+    for name in names:
+        entries += struct.pack("<2I", len(strings), len(name))
+        strings += name + b"\0"
+
+    header = struct.pack("<4I", MAGIC, VERSION, len(names), strings_offset)
+    return header + entries + strings
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("-o", "--output", required=True, help="manifest to write")
+    parser.add_argument("--names", nargs="*", default=[], help="interface/instance names")
+    parser.add_argument("inputs", nargs="*", help="interface/instance lists")
+    args = parser.parse_args()
+
+    with open(args.output, "wb") as f:
+        f.write(build(read_names(args.inputs, args.names)))
+
+
+if __name__ == "__main__":
+    main()
@@ -20,15 +20,17 @@
 #include <debug.h>
 #include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/epoll.h>
 #include <sys/ioctl.h>
-#include <sys/timerfd.h>
 #include <time.h>
 
 #include "utils/Binderlog.h"
+#include "utils/EventLoop.h"
+#include "utils/Timers.h"
 #include <android/binder_status.h>
 
 #include "base/IPCThreadState.h"
@@ -37,15 +39,89 @@
 
 #include "ServiceManager.h"
 
+/* Read rounds per wake-up, so a busy binder fd cannot starve the timers */
+
+#define SVC_MAX_DRAIN_ROUNDS 16
+
+/* Names fanned out per turn before the binder fd is looked at again */
+
+#define SVC_MAX_NOTIFICATIONS_PER_ROUND 8
+
+struct SvcContext;
+typedef struct SvcContext SvcContext;
+
+struct SvcContext {
+    IPCThreadState* self;
+    ServiceManager* manager;
+    EventLoop* loop;
+    EventLoopTimer* notifyTimer; /* Pending fan-out turn, NULL if none */
+};
+
+static void svc_handleNotifications(void* data);
+
+static void svc_scheduleNotifications(SvcContext* ctx)
+{
+    if (ctx->notifyTimer == NULL
+        && !RingBuffer_isEmpty(&ctx->manager->mNotificationQueue)) {
+        ctx->notifyTimer = ctx->loop->addTimer(ctx->loop, 0, 0, svc_handleNotifications, ctx);
+    }
+}
+
+/* Registration callbacks go out here, after the addService() replies,
+ * a slow listener no longer holds up the service that registered.
+ */
+
+static void svc_handleNotifications(void* data)
+{
+    SvcContext* ctx = data;
+
+    ctx->notifyTimer = NULL;
+    ctx->manager->drainNotifications(ctx->manager, SVC_MAX_NOTIFICATIONS_PER_ROUND);
+    svc_scheduleNotifications(ctx);
+}
+
+static void svc_handleBinder(int fd, uint32_t events, void* data)
+{
+    SvcContext* ctx = data;
+    IPCThreadState* self = ctx->self;
+    struct pollfd pfd;
+    int rounds = 0;
+
+    (void)events;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    /* Take every queued transaction before going back to epoll_wait() */
+
+    do {
+        self->handlePolledCommands(self);
+        pfd.revents = 0;
+    } while (++rounds < SVC_MAX_DRAIN_ROUNDS && poll(&pfd, 1, 0) > 0);
+
+    svc_scheduleNotifications(ctx);
+}
+
+/* Lazy services learn about their clients on this tick, a steady
+ * stream of transactions must not hold it off.
+ */
+
+static void svc_handleClientCheck(void* data)
+{
+    SvcContext* ctx = data;
+
+    ctx->manager->handleClientCallbacks(ctx->manager);
+    ctx->manager->logNotificationStats(ctx->manager);
+}
+
 int main(int argc, char** argv)
 {
     int32_t status;
     String name;
     ProcessState* ps;
     IPCThreadState* self;
+    EventLoop* loop;
+    SvcContext ctx;
     int binder_fd;
-    int epoll_fd;
-    struct epoll_event ev;
 
     if (argc > 2) {
         LOG_FATAL_IF(1, "usage: %s [binder driver]\n", argv[0]);
@@ -79,29 +155,29 @@ int main(int argc, char** argv)
     /* flush BC_ENTER_LOOPER */
     self->flushCommands(self);
 
-    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
-    if (epoll_fd == -1) {
+    loop = EventLoop_new();
+    if (loop == NULL) {
         return EXIT_FAILURE;
     }
 
-    ev.events = EPOLLIN;
-    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, binder_fd, &ev) == -1) {
+    ctx.self = self;
+    ctx.manager = manager;
+    ctx.loop = loop;
+    ctx.notifyTimer = NULL;
+
+    if (loop->addFd(loop, binder_fd, EPOLLIN, svc_handleBinder, &ctx) != STATUS_OK) {
         return EXIT_FAILURE;
     }
-    while (1) {
-        struct epoll_event events[1];
-        int numEvents = epoll_wait(epoll_fd, events, 1, 1000);
-        if (numEvents < 0) {
-            if (errno == EINTR) {
-                continue;
-            }
-            return EXIT_FAILURE;
-        }
-
-        if (numEvents > 0) {
-            self->handlePolledCommands(self);
-        }
+
+    if (loop->addTimer(loop, CONFIG_BINDER_SVCMANAGER_CLIENT_CHECK_INTERVAL,
+            CONFIG_BINDER_SVCMANAGER_CLIENT_CHECK_INTERVAL, svc_handleClientCheck, &ctx)
+        == NULL) {
+        return EXIT_FAILURE;
     }
+
+    loop->run(loop);
+
     // should not be reached
+    EventLoop_delete(loop);
     return EXIT_FAILURE;
 }
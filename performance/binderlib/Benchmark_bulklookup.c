@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <android/binder_status.h>
+
+#include "base/AidlServiceManager.h"
+#include "base/IPCThreadState.h"
+#include "base/IServiceManager.h"
+#include "base/ProcessState.h"
+
+#include "bench_time.h"
+
+/* Lookups an app does at startup, and how many startups to average */
+
+#define SERVICES 20
+#define ROUNDS 50
+
+/* The raw servicemanager interface, so the lookup cache of the shim
+ * does not turn every round after the first into a hit.
+ */
+
+static void lookup_sequential(IAIDLServiceManager* aidl, VectorString* names)
+{
+    for (size_t i = 0; i < names->size(names); i++) {
+        IBinder* svc = NULL;
+        Status status;
+
+        Status_init(&status);
+        aidl->getService(aidl, names->get(names, i), &svc, &status);
+    }
+}
+
+static void lookup_bulk(IAIDLServiceManager* aidl, VectorString* names)
+{
+    size_t count = names->size(names);
+
+    for (size_t i = 0; i < count; i += AIDL_SERVICE_MANAGER_MAX_GET_SERVICES) {
+        VectorString batch;
+        VectorImpl found;
+        Status status;
+
+        VectorString_ctor(&batch);
+        VectorImpl_ctor(&found);
+        for (size_t j = i; j < count && j < i + AIDL_SERVICE_MANAGER_MAX_GET_SERVICES; j++) {
+            batch.add(&batch, names->get(names, j));
+        }
+        Status_init(&status);
+        aidl->getServices(aidl, &batch, &found, &status);
+        found.dtor(&found);
+        batch.dtor(&batch);
+    }
+}
+
+static void run(const char* title, IAIDLServiceManager* aidl, VectorString* names,
+    uint32_t rounds, void (*lookup)(IAIDLServiceManager*, VectorString*))
+{
+    uint64_t start = bench_now_ns();
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        lookup(aidl, names);
+    }
+
+    printf("%-28s %4zu services  %8.1f us/startup\n", title, names->size(names),
+        (double)(bench_now_ns() - start) / rounds / 1000.0);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t services = argc > 1 ? strtoul(argv[1], NULL, 0) : SERVICES;
+    uint32_t rounds = argc > 2 ? strtoul(argv[2], NULL, 0) : ROUNDS;
+    ProcessState* ps = ProcessState_self();
+    IAIDLServiceManager* aidl;
+    IServiceManager* sm;
+    VectorString names;
+    BBinder* service;
+
+    if (IPCThreadState_self() == NULL) {
+        printf("Failed to get IPCThreadState\n");
+        return EXIT_FAILURE;
+    }
+
+    sm = defaultServiceManager();
+    aidl = IAIDLServiceManager_asInterface(ps->getContextObject(ps, NULL));
+    service = zalloc(sizeof(BBinder));
+    if (sm == NULL || aidl == NULL || service == NULL) {
+        printf("Failed to set up the service manager or the service\n");
+        return EXIT_FAILURE;
+    }
+
+    BBinder_ctor(service);
+    service->incStrong(service, service);
+
+    VectorString_ctor(&names);
+    for (uint32_t i = 0; i < services; i++) {
+        char buf[64];
+        String name;
+
+        snprintf(buf, sizeof(buf), "benchmark.bulk.%d.%" PRIu32, getpid(), i);
+        String_init(&name, buf);
+        if (sm->addService(sm, &name, (IBinder*)service, false,
+                DUMP_FLAG_PRIORITY_DEFAULT)
+            != STATUS_OK) {
+            printf("Failed to add %s\n", buf);
+            return EXIT_FAILURE;
+        }
+        names.add(&names, &name);
+    }
+
+    run("getService, one by one", aidl, &names, rounds, lookup_sequential);
+    run("getServices, batched", aidl, &names, rounds, lookup_bulk);
+
+    names.dtor(&names);
+    return EXIT_SUCCESS;
+}
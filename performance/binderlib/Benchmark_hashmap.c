@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <android/binder_status.h>
+
+#include "utils/BinderString.h"
+#include "utils/HashMap.h"
+
+#include "bench_time.h"
+
+/* The chained HashMap this library used before the open addressing one:
+ * a bucket array of separately allocated nodes, with hash/equal called
+ * through function pointers on every chain step. Kept here as reference.
+ */
+
+typedef struct LegacyEntry {
+    long key;
+    long value;
+    struct LegacyEntry* next;
+} LegacyEntry;
+
+typedef struct LegacyMap {
+    size_t (*hash)(long key);
+    bool (*equal)(long key1, long key2);
+
+    LegacyEntry** buckets;
+    size_t capacity;
+    size_t cap_bits;
+    size_t size;
+} LegacyMap;
+
+static LegacyEntry** legacy_find_entry(LegacyMap* this, long key)
+{
+    LegacyEntry** pprev;
+
+    if (!this->buckets)
+        return NULL;
+
+    pprev = &this->buckets[hash_bits(this->hash(key), this->cap_bits)];
+    for (; *pprev; pprev = &(*pprev)->next) {
+        if (this->equal((*pprev)->key, key))
+            return pprev;
+    }
+    return NULL;
+}
+
+static int legacy_grow(LegacyMap* this)
+{
+    size_t new_cap_bits = this->cap_bits + 1 < 2 ? 2 : this->cap_bits + 1;
+    size_t new_cap = 1UL << new_cap_bits;
+    LegacyEntry** new_buckets;
+    LegacyEntry* cur;
+    LegacyEntry* tmp;
+    size_t bkt, h;
+
+    new_buckets = calloc(new_cap, sizeof(new_buckets[0]));
+    if (!new_buckets)
+        return -1;
+
+    for (bkt = 0; bkt < this->capacity; bkt++) {
+        for (cur = this->buckets[bkt]; cur; cur = tmp) {
+            tmp = cur->next;
+            h = hash_bits(this->hash(cur->key), new_cap_bits);
+            cur->next = new_buckets[h];
+            new_buckets[h] = cur;
+        }
+    }
+
+    free(this->buckets);
+    this->buckets = new_buckets;
+    this->capacity = new_cap;
+    this->cap_bits = new_cap_bits;
+    return 0;
+}
+
+static int legacy_insert(LegacyMap* this, long key, long value)
+{
+    LegacyEntry* entry;
+    size_t h;
+
+    if (legacy_find_entry(this, key))
+        return -1;
+
+    if (this->capacity == 0 || (this->size + 1) * 4 / 3 > this->capacity) {
+        if (legacy_grow(this) < 0)
+            return -1;
+    }
+
+    entry = malloc(sizeof(LegacyEntry));
+    if (!entry)
+        return -1;
+
+    h = hash_bits(this->hash(key), this->cap_bits);
+    entry->key = key;
+    entry->value = value;
+    entry->next = this->buckets[h];
+    this->buckets[h] = entry;
+    this->size++;
+    return 0;
+}
+
+static bool legacy_find(LegacyMap* this, long key, long* value)
+{
+    LegacyEntry** pprev = legacy_find_entry(this, key);
+
+    if (!pprev)
+        return false;
+
+    *value = (*pprev)->value;
+    return true;
+}
+
+static bool legacy_erase(LegacyMap* this, long key)
+{
+    LegacyEntry** pprev = legacy_find_entry(this, key);
+    LegacyEntry* entry;
+
+    if (!pprev)
+        return false;
+
+    entry = *pprev;
+    *pprev = entry->next;
+    free(entry);
+    this->size--;
+    return true;
+}
+
+static void legacy_destroy(LegacyMap* this)
+{
+    LegacyEntry* cur;
+    LegacyEntry* tmp;
+    size_t bkt;
+
+    for (bkt = 0; bkt < this->capacity; bkt++) {
+        for (cur = this->buckets[bkt]; cur; cur = tmp) {
+            tmp = cur->next;
+            free(cur);
+        }
+    }
+    free(this->buckets);
+}
+
+static size_t legacy_long_hash(long key)
+{
+    return key;
+}
+
+static bool legacy_long_equal(long key1, long key2)
+{
+    return key1 == key2;
+}
+
+static size_t legacy_string_hash(long key)
+{
+    return str_hash(((String*)key)->mData);
+}
+
+static bool legacy_string_equal(long key1, long key2)
+{
+    return strcmp(((String*)key1)->mData, ((String*)key2)->mData) == 0;
+}
+
+/* Benchmark drivers: `keys` holds 2 * n keys, the first half is inserted
+ * and the second half is only used for lookups that miss.
+ */
+
+static volatile long g_sink;
+
+static void bench_legacy(const char* kind, size_t n, const long* keys, bool string)
+{
+    LegacyMap map = {
+        .hash = string ? legacy_string_hash : legacy_long_hash,
+        .equal = string ? legacy_string_equal : legacy_long_equal,
+    };
+    char name[64];
+    long value;
+
+    snprintf(name, sizeof(name), "chained %s insert n=%zu", kind, n);
+    BENCH_RUN(name, n, legacy_insert(&map, keys[__i], __i));
+    snprintf(name, sizeof(name), "chained %s find hit n=%zu", kind, n);
+    BENCH_RUN(name, n, if (legacy_find(&map, keys[__i], &value)) g_sink = value);
+    snprintf(name, sizeof(name), "chained %s find miss n=%zu", kind, n);
+    BENCH_RUN(name, n, if (legacy_find(&map, keys[n + __i], &value)) g_sink = value);
+    snprintf(name, sizeof(name), "chained %s erase n=%zu", kind, n);
+    BENCH_RUN(name, n, legacy_erase(&map, keys[__i]));
+
+    legacy_destroy(&map);
+}
+
+static void bench_hashmap(const char* kind, size_t n, const long* keys, bool string)
+{
+    HashMap map;
+    char name[64];
+    long value;
+
+    if (string) {
+        HashMap_String_ctor(&map);
+    } else {
+        HashMap_ctor(&map);
+    }
+
+    snprintf(name, sizeof(name), "open %s insert n=%zu", kind, n);
+    BENCH_RUN(name, n, map.insert(&map, keys[__i], __i));
+    snprintf(name, sizeof(name), "open %s find hit n=%zu", kind, n);
+    BENCH_RUN(name, n, if (map.find(&map, keys[__i], &value) == STATUS_OK) g_sink = value);
+    snprintf(name, sizeof(name), "open %s find miss n=%zu", kind, n);
+    BENCH_RUN(name, n, if (map.find(&map, keys[n + __i], &value) == STATUS_OK) g_sink = value);
+    snprintf(name, sizeof(name), "open %s erase n=%zu", kind, n);
+    BENCH_RUN(name, n, map.erase(&map, keys[__i]));
+
+    map.dtor(&map);
+}
+
+int main(int argc, char** argv)
+{
+    static const size_t sizes[] = { 10, 100, 1000, 10000 };
+    size_t max = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    String* strings;
+    long* ints;
+    long* strs;
+    size_t i;
+
+    ints = malloc(2 * max * sizeof(long));
+    strs = malloc(2 * max * sizeof(long));
+    strings = malloc(2 * max * sizeof(String));
+    if (!ints || !strs || !strings) {
+        printf("Failed to allocate keys\n");
+        free(ints);
+        free(strs);
+        free(strings);
+        return EXIT_FAILURE;
+    }
+
+    /* handles/cookies are sparse, service names share long prefixes */
+
+    for (i = 0; i < 2 * max; i++) {
+        char buf[STRING_INIT_CAPACITY];
+
+        ints[i] = (long)(i * 0x9e3779b1u) & 0x7fffffff;
+        snprintf(buf, sizeof(buf), "vendor.xiaomi.hardware.service.%zu", i);
+        String_init(&strings[i], buf);
+        strs[i] = (long)&strings[i];
+    }
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_legacy("long", sizes[i], ints, false);
+        bench_hashmap("long", sizes[i], ints, false);
+        bench_legacy("string", sizes[i], strs, true);
+        bench_hashmap("string", sizes[i], strs, true);
+    }
+
+    free(ints);
+    free(strs);
+    free(strings);
+    return EXIT_SUCCESS;
+}
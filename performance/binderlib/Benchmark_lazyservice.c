@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "base/AidlServiceManager.h"
+#include "base/IPCThreadState.h"
+#include "base/ProcessState.h"
+#include <android/binder_status.h>
+
+#include "bench_time.h"
+
+/* Every round asks servicemanager for the lazy service, uses it, lets it
+ * go and waits for it to unregister and exit. The next round must find
+ * it started again. Needs "benchmark.lazy=Benchmark_lazyservice_srv" in
+ * CONFIG_BINDER_SVCMANAGER_LAZY_SERVICES.
+ */
+
+#define LAZY_SERVICE_NAME "benchmark.lazy"
+#define ROUNDS 5
+
+#ifdef CONFIG_BINDER_SVCMANAGER_CLIENT_CHECK_INTERVAL
+#define CLIENT_CHECK_INTERVAL_MS CONFIG_BINDER_SVCMANAGER_CLIENT_CHECK_INTERVAL
+#else
+#define CLIENT_CHECK_INTERVAL_MS 5000
+#endif
+
+#define START_TIMEOUT_MS 2000
+
+/* A getService() keeps the service for one more interval, it reports no
+ * clients on the one after that.
+ */
+
+#define EXIT_TIMEOUT_MS (4 * CLIENT_CHECK_INTERVAL_MS)
+
+static IBinder* check_service(IAIDLServiceManager* aidl, String* name)
+{
+    IBinder* svc = NULL;
+    Status status;
+
+    Status_init(&status);
+    aidl->checkService(aidl, name, &svc, &status);
+    return status.mException == EX_NONE ? svc : NULL;
+}
+
+/* getService() only starts it, poll until it has registered */
+
+static IBinder* start_service(IAIDLServiceManager* aidl, String* name, uint64_t* latency)
+{
+    uint64_t start = bench_now_ns();
+    uint64_t deadline = start + START_TIMEOUT_MS * 1000000ULL;
+    IBinder* svc = NULL;
+    Status status;
+
+    Status_init(&status);
+    aidl->getService(aidl, name, &svc, &status);
+    while (svc == NULL && bench_now_ns() < deadline) {
+        usleep(10 * 1000);
+        svc = check_service(aidl, name);
+    }
+    *latency = bench_now_ns() - start;
+    return svc;
+}
+
+static bool wait_unregistered(IAIDLServiceManager* aidl, String* name)
+{
+    uint64_t deadline = bench_now_ns() + EXIT_TIMEOUT_MS * 1000000ULL;
+
+    while (check_service(aidl, name) != NULL) {
+        if (bench_now_ns() >= deadline) {
+            return false;
+        }
+        usleep(100 * 1000);
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t rounds = argc > 1 ? strtoul(argv[1], NULL, 0) : ROUNDS;
+    ProcessState* ps = ProcessState_self();
+    IAIDLServiceManager* aidl;
+    uint64_t total = 0;
+    uint64_t worst = 0;
+    String name;
+
+    if (IPCThreadState_self() == NULL) {
+        printf("Failed to get IPCThreadState\n");
+        return EXIT_FAILURE;
+    }
+
+    aidl = IAIDLServiceManager_asInterface(ps->getContextObject(ps, NULL));
+    if (aidl == NULL) {
+        printf("Failed to get the service manager\n");
+        return EXIT_FAILURE;
+    }
+    String_init(&name, LAZY_SERVICE_NAME);
+
+    /* A running instance from an earlier run has to go first */
+
+    if (!wait_unregistered(aidl, &name)) {
+        printf("%s is still registered from before\n", LAZY_SERVICE_NAME);
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        uint64_t latency;
+        IBinder* svc;
+
+        svc = start_service(aidl, &name, &latency);
+        if (svc == NULL) {
+            printf("round %" PRIu32 ": %s was not started\n", i, LAZY_SERVICE_NAME);
+            return EXIT_FAILURE;
+        }
+
+        svc->incStrong(svc, &name);
+        if (svc->pingBinder(svc) != STATUS_OK) {
+            printf("round %" PRIu32 ": %s does not answer\n", i, LAZY_SERVICE_NAME);
+            return EXIT_FAILURE;
+        }
+        svc->decStrong(svc, &name);
+
+        if (!wait_unregistered(aidl, &name)) {
+            printf("round %" PRIu32 ": %s did not unregister\n", i, LAZY_SERVICE_NAME);
+            return EXIT_FAILURE;
+        }
+
+        total += latency;
+        worst = latency > worst ? latency : worst;
+    }
+
+    printf("%-32s %4" PRIu32 " rounds  avg %8.1f ms  max %8.1f ms\n", "lazy start after unregister",
+        rounds, (double)total / rounds / 1000000.0, (double)worst / 1000000.0);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base/AidlServiceManager.h"
+#include "base/IClientCallback.h"
+#include "base/IPCThreadState.h"
+#include "base/IServiceManager.h"
+#include "base/ProcessState.h"
+#include <android/binder_status.h>
+
+/* The lazy service Benchmark_lazyservice asks for. servicemanager spawns
+ * it on a getService() of LAZY_SERVICE_NAME, it registers and exits
+ * again once servicemanager reports that its last client is gone.
+ */
+
+#define LAZY_SERVICE_NAME "benchmark.lazy"
+
+static IAIDLServiceManager* g_aidl;
+
+static int32_t lazy_onClients(void* v_this, const IBinder* registered, bool hasClients)
+{
+    Status status;
+    String name;
+
+    if (hasClients) {
+        return STATUS_OK;
+    }
+
+    /* Refused while a client is on its way, servicemanager then reports
+     * clients again and a later interval retries.
+     */
+
+    String_init(&name, LAZY_SERVICE_NAME);
+    Status_init(&status);
+    g_aidl->tryUnregisterService(g_aidl, &name, (IBinder*)registered, &status);
+    if (status.mException == EX_NONE) {
+        exit(EXIT_SUCCESS);
+    }
+    return STATUS_OK;
+}
+
+int main(int argc, char** argv)
+{
+    ProcessState* ps = ProcessState_self();
+    IPCThreadState* ipc = IPCThreadState_self();
+    BnClientCallback* callback;
+    BBinder* service;
+    Status status;
+    String name;
+
+    if (ipc == NULL) {
+        printf("Failed to get IPCThreadState\n");
+        return EXIT_FAILURE;
+    }
+
+    g_aidl = IAIDLServiceManager_asInterface(ps->getContextObject(ps, NULL));
+    service = zalloc(sizeof(BBinder));
+    callback = zalloc(sizeof(BnClientCallback));
+    if (g_aidl == NULL || service == NULL || callback == NULL) {
+        printf("Failed to set up the service manager or the service\n");
+        return EXIT_FAILURE;
+    }
+
+    BBinder_ctor(service);
+    service->incStrong(service, service);
+
+    BnClientCallback_ctor(callback);
+    callback->m_BnIClientCallback.m_IClientCallback.onClients = lazy_onClients;
+    callback->m_BnIClientCallback.m_BBinder.incStrong(&callback->m_BnIClientCallback.m_BBinder,
+        callback);
+
+    String_init(&name, LAZY_SERVICE_NAME);
+    Status_init(&status);
+    g_aidl->addService(g_aidl, &name, (IBinder*)service, false, DUMP_FLAG_PRIORITY_DEFAULT,
+        &status);
+    if (status.mException != EX_NONE) {
+        printf("Failed to add %s\n", LAZY_SERVICE_NAME);
+        return EXIT_FAILURE;
+    }
+
+    Status_init(&status);
+    g_aidl->registerClientCallback(g_aidl, &name, (IBinder*)service,
+        (const IClientCallback*)&callback->m_BnIClientCallback.m_BBinder, &status);
+    if (status.mException != EX_NONE) {
+        printf("Failed to register the client callback of %s\n", LAZY_SERVICE_NAME);
+        return EXIT_FAILURE;
+    }
+
+    ipc->joinThreadPool(ipc, true);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <android/binder_status.h>
+
+#include "base/AidlServiceManager.h"
+#include "base/IPCThreadState.h"
+#include "base/IServiceManager.h"
+#include "base/ProcessState.h"
+
+#include "bench_time.h"
+
+/* Registry size, and how many full listings to average */
+
+#define SERVICES 1000
+#define ROUNDS 20
+
+/* Every 4th service is critical, so the filtered listing has work to skip */
+
+#define CRITICAL_EVERY 4
+
+static void run(const char* title, IServiceManager* sm, int dumpPriority, uint32_t rounds)
+{
+    uint64_t start = bench_now_ns();
+    size_t count = 0;
+    double us;
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        VectorString list;
+
+        VectorString_ctor(&list);
+        if (sm->listServices(sm, dumpPriority, &list) != STATUS_OK) {
+            printf("%-28s failed\n", title);
+            list.dtor(&list);
+            return;
+        }
+        count = list.size(&list);
+        list.dtor(&list);
+    }
+
+    us = (double)(bench_now_ns() - start) / rounds / 1000.0;
+    printf("%-28s %5zu names  %9.1f us/listing  %9.0f names/s\n", title, count, us,
+        us > 0 ? count * 1000000.0 / us : 0);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t services = argc > 1 ? strtoul(argv[1], NULL, 0) : SERVICES;
+    uint32_t rounds = argc > 2 ? strtoul(argv[2], NULL, 0) : ROUNDS;
+    ProcessState* ps = ProcessState_self();
+    IAIDLServiceManager* aidl;
+    IServiceManager* sm;
+    VectorString list;
+    BBinder* service;
+    Status status;
+
+    if (IPCThreadState_self() == NULL) {
+        printf("Failed to get IPCThreadState\n");
+        return EXIT_FAILURE;
+    }
+
+    sm = defaultServiceManager();
+    aidl = IAIDLServiceManager_asInterface(ps->getContextObject(ps, NULL));
+    service = zalloc(sizeof(BBinder));
+    if (sm == NULL || aidl == NULL || service == NULL) {
+        printf("Failed to set up the service manager or the service\n");
+        return EXIT_FAILURE;
+    }
+
+    BBinder_ctor(service);
+    service->incStrong(service, service);
+
+    for (uint32_t i = 0; i < services; i++) {
+        int dumpPriority = i % CRITICAL_EVERY == 0 ? DUMP_FLAG_PRIORITY_CRITICAL
+                                                   : DUMP_FLAG_PRIORITY_DEFAULT;
+        char buf[64];
+        String name;
+
+        snprintf(buf, sizeof(buf), "benchmark.list.%d.%" PRIu32, getpid(), i);
+        String_init(&name, buf);
+        if (sm->addService(sm, &name, (IBinder*)service, false, dumpPriority) != STATUS_OK) {
+            printf("Failed to add %s\n", buf);
+            return EXIT_FAILURE;
+        }
+    }
+
+    run("listServices, all, paged", sm, DUMP_FLAG_PRIORITY_ALL, rounds);
+    run("listServices, critical, paged", sm, DUMP_FLAG_PRIORITY_CRITICAL, rounds);
+
+    /* What the paging avoids: the whole registry in one reply */
+
+    VectorString_ctor(&list);
+    Status_init(&status);
+    aidl->listServices(aidl, DUMP_FLAG_PRIORITY_ALL, &list, &status);
+    printf("%-28s %5zu names  %s\n", "listServices, one reply", list.size(&list),
+        status.mException == EX_NONE ? "ok" : "failed");
+    list.dtor(&list);
+
+    return EXIT_SUCCESS;
+}
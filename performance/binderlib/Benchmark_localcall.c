@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base/AidlServiceManager.h"
+#include "base/BnServiceManager.h"
+#include "base/BpServiceManager.h"
+#include "base/IPCThreadState.h"
+#include "base/Status.h"
+
+#include "bench_time.h"
+
+#define ITERATIONS 100000
+
+/* An in-process service manager that only answers isDeclared() */
+
+static void LocalServiceManager_isDeclared(IAIDLServiceManager* this, String* name,
+    bool* aidl_return, Status* retStatus)
+{
+    *aidl_return = String_size(name) != 0;
+}
+
+static void call_isDeclared(IAIDLServiceManager* sm, String* name)
+{
+    Status status;
+    bool declared;
+
+    Status_init(&status);
+    sm->isDeclared(sm, name, &declared, &status);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iters = argc > 1 ? strtoul(argv[1], NULL, 0) : ITERATIONS;
+    IPCThreadState* self = IPCThreadState_self();
+    BnAIDLServiceManager* service;
+    IAIDLServiceManager* local;
+    BpAIDLServiceManager* proxy;
+    IBinder* binder;
+    String name;
+
+    if (self == NULL) {
+        printf("Failed to get IPCThreadState\n");
+        return EXIT_FAILURE;
+    }
+
+    service = zalloc(sizeof(BnAIDLServiceManager));
+    if (service == NULL) {
+        printf("Failed to allocate the local service\n");
+        return EXIT_FAILURE;
+    }
+
+    BnAIDLServiceManager_ctor(service);
+    service->m_BnIAidlServiceManager.m_IAIDLServiceManager.isDeclared = LocalServiceManager_isDeclared;
+    binder = (IBinder*)service;
+    binder->incStrong(binder, service);
+
+    String_init(&name, "benchmark.local");
+
+    /* What interface_cast() hands out now, and the marshalling proxy that
+     * used to wrap the same in-process BBinder.
+     */
+
+    local = interface_cast(IAIDLServiceManager, binder);
+    proxy = BpAIDLServiceManager_new(binder);
+    if (local == NULL || proxy == NULL) {
+        printf("Failed to get the interfaces\n");
+        return EXIT_FAILURE;
+    }
+    if ((void*)local != (void*)&service->m_BnIAidlServiceManager.m_IAIDLServiceManager) {
+        printf("interface_cast() did not return the local implementation\n");
+    }
+
+    BENCH_RUN("isDeclared, local interface_cast", iters,
+        call_isDeclared(local, &name));
+    BENCH_RUN("isDeclared, Parcel through BBinder", iters,
+        call_isDeclared((IAIDLServiceManager*)proxy, &name));
+
+    BpAIDLServiceManager_delete(proxy);
+    return EXIT_SUCCESS;
+}
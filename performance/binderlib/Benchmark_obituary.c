@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <android/binder_status.h>
+
+#include "base/BpBinder.h"
+#include "base/IPCThreadState.h"
+#include "base/ObituaryExecutor.h"
+#include "base/ProcessState.h"
+
+#include "bench_time.h"
+
+#define DEATHS 256
+
+/* Proxies to the context manager stand in for the dead services, their
+ * obituaries are sent the way a BR_DEAD_BINDER from the driver would.
+ */
+
+#define PROXY_HANDLE 0
+
+struct CountingRecipient {
+    DeathRecipient m_DeathRecipient;
+
+    atomic_uint mDied;
+    uint32_t mExpected;
+    pthread_mutex_t mLock;
+    pthread_cond_t mDone;
+};
+
+typedef struct CountingRecipient CountingRecipient;
+
+static void CountingRecipient_binderDied(DeathRecipient* v_this, IBinder* who)
+{
+    CountingRecipient* this = (CountingRecipient*)v_this;
+
+    if (atomic_fetch_add(&this->mDied, 1) + 1 == this->mExpected) {
+        pthread_mutex_lock(&this->mLock);
+        pthread_cond_signal(&this->mDone);
+        pthread_mutex_unlock(&this->mLock);
+    }
+}
+
+static void CountingRecipient_wait(CountingRecipient* this)
+{
+    pthread_mutex_lock(&this->mLock);
+    while (atomic_load(&this->mDied) < this->mExpected) {
+        pthread_cond_wait(&this->mDone, &this->mLock);
+    }
+    pthread_mutex_unlock(&this->mLock);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t deaths = argc > 1 ? strtoul(argv[1], NULL, 0) : DEATHS;
+    IPCThreadState* self = IPCThreadState_self();
+    CountingRecipient recipient;
+    ObituaryExecutorStats stats;
+    BpBinder** proxies;
+    uint64_t start;
+    uint64_t posted;
+    uint64_t delivered;
+    uint32_t i;
+
+    if (self == NULL) {
+        printf("Failed to get IPCThreadState\n");
+        return EXIT_FAILURE;
+    }
+
+    proxies = calloc(deaths, sizeof(BpBinder*));
+    if (proxies == NULL) {
+        printf("Failed to allocate %" PRIu32 " proxy slots\n", deaths);
+        return EXIT_FAILURE;
+    }
+
+    DeathRecipient_ctor(&recipient.m_DeathRecipient);
+    recipient.m_DeathRecipient.binderDied = CountingRecipient_binderDied;
+    atomic_init(&recipient.mDied, 0);
+    recipient.mExpected = deaths;
+    pthread_mutex_init(&recipient.mLock, NULL);
+    pthread_cond_init(&recipient.mDone, NULL);
+
+    for (i = 0; i < deaths; i++) {
+        proxies[i] = BpBinder_create(PROXY_HANDLE);
+        ((IBinder*)proxies[i])->incStrong((IBinder*)proxies[i], proxies);
+        if (proxies[i]->linkToDeath(proxies[i], &recipient.m_DeathRecipient,
+                NULL, 0)
+            != STATUS_OK) {
+            printf("linkToDeath failed for proxy %" PRIu32 "\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* Time spent by the "binder thread" in sendObituary(), then the time
+     * until the last recipient ran.
+     */
+
+    start = bench_now_ns();
+    for (i = 0; i < deaths; i++) {
+        proxies[i]->sendObituary(proxies[i]);
+    }
+    posted = bench_now_ns();
+    CountingRecipient_wait(&recipient);
+    delivered = bench_now_ns();
+
+    ObituaryExecutor_getStats(&stats);
+    printf("%" PRIu32 " deaths: binder thread busy %.1f us (%.1f ns/death), "
+           "all delivered after %.1f us\n",
+        deaths, (posted - start) / 1000.0, (double)(posted - start) / deaths,
+        (delivered - start) / 1000.0);
+    printf("executor: %zu deaths in %zu batches (max %zu), %zu inline\n",
+        stats.deaths, stats.batches, stats.maxBatch, stats.inlined);
+
+    for (i = 0; i < deaths; i++) {
+        ((IBinder*)proxies[i])->decStrong((IBinder*)proxies[i], proxies);
+    }
+    self->flushCommands(self);
+    free(proxies);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base/BpBinder.h"
+#include "base/IPCThreadState.h"
+#include "base/ProcessState.h"
+
+#include "bench_time.h"
+
+#define ITERATIONS 10000
+
+/* The proxy handle and id used to take references. Handle 0 is the
+ * context manager, which is always valid while svcmanager runs.
+ */
+
+#define PROXY_HANDLE 0
+
+/* Flush the queued BC_INCREFS/BC_DECREFS pairs every so often */
+
+#define FLUSH_INTERVAL 64
+
+/* Number of proxies kept alive at once to measure the resident cost */
+
+#define LIVE_PROXIES 4096
+
+static void proxy_cycle(IPCThreadState* self, uint32_t i)
+{
+    BpBinder* proxy = BpBinder_create(PROXY_HANDLE);
+    IBinder* binder = (IBinder*)proxy;
+
+    binder->incStrong(binder, &proxy);
+    binder->decStrong(binder, &proxy);
+
+    /* Proxies are not freed by their counts, this one never left here */
+
+    BpBinder_delete(proxy);
+    if ((i % FLUSH_INTERVAL) == 0) {
+        self->flushCommands(self);
+    }
+}
+
+static int proxy_live(IPCThreadState* self, uint32_t count)
+{
+    BpBinder** proxies = calloc(count, sizeof(BpBinder*));
+    struct mallinfo before;
+    struct mallinfo after;
+    uint32_t i;
+
+    if (proxies == NULL) {
+        printf("Failed to allocate %" PRIu32 " proxy slots\n", count);
+        return -1;
+    }
+
+    before = mallinfo();
+    for (i = 0; i < count; i++) {
+        proxies[i] = BpBinder_create(PROXY_HANDLE);
+        ((IBinder*)proxies[i])->incStrong((IBinder*)proxies[i], proxies);
+        if ((i % FLUSH_INTERVAL) == 0) {
+            self->flushCommands(self);
+        }
+    }
+    self->flushCommands(self);
+    after = mallinfo();
+
+    printf("%" PRIu32 " live proxies: %.1f heap bytes/proxy "
+           "(BpBinder %zu, lazy BpBinder_Extras %zu)\n",
+        count, (double)(after.uordblks - before.uordblks) / count,
+        sizeof(BpBinder), sizeof(BpBinder_Extras));
+
+    for (i = 0; i < count; i++) {
+        ((IBinder*)proxies[i])->decStrong((IBinder*)proxies[i], proxies);
+        BpBinder_delete(proxies[i]);
+        if ((i % FLUSH_INTERVAL) == 0) {
+            self->flushCommands(self);
+        }
+    }
+    self->flushCommands(self);
+    free(proxies);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iters = argc > 1 ? strtoul(argv[1], NULL, 0) : ITERATIONS;
+    uint32_t live = argc > 2 ? strtoul(argv[2], NULL, 0) : LIVE_PROXIES;
+    IPCThreadState* self = IPCThreadState_self();
+    struct mallinfo before;
+    struct mallinfo after;
+
+    if (self == NULL) {
+        printf("Failed to get IPCThreadState\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Warm up, so the handle table and parcels are already sized */
+
+    for (uint32_t i = 0; i < FLUSH_INTERVAL; i++) {
+        proxy_cycle(self, i);
+    }
+    self->flushCommands(self);
+
+    before = mallinfo();
+    BENCH_RUN("BpBinder create/destroy", iters, proxy_cycle(self, __i));
+    self->flushCommands(self);
+    after = mallinfo();
+
+    printf("heap per proxy: %zu bytes, retained after destroy: %.1f bytes/op\n",
+        sizeof(BpBinder), (double)(after.uordblks - before.uordblks) / iters);
+
+    if (proxy_live(self, live) < 0) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
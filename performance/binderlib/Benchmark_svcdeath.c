@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <inttypes.h>
+#include <malloc.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "base/AidlServiceManager.h"
+#include "base/IPCThreadState.h"
+#include "base/IServiceManager.h"
+#include "base/ProcessState.h"
+
+#include "bench_time.h"
+
+/* Every round a child task registers SERVICES services and exits, its
+ * death must take them all out of servicemanager again.
+ */
+
+#define ROUNDS 64
+#define SERVICES 64
+
+/* How long servicemanager gets to handle one round of deaths */
+
+#define EVICT_TIMEOUT_MS 2000
+
+static void service_name(String* name, int round, int index)
+{
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "benchmark.svcdeath.%d.%d", round, index);
+    String_init(name, buf);
+}
+
+static int child_main(int argc, char* argv[])
+{
+    int round = atoi(argv[1]);
+    IServiceManager* sm = defaultServiceManager();
+
+    for (int i = 0; i < SERVICES; i++) {
+        BBinder* service = zalloc(sizeof(BBinder));
+        String name;
+
+        if (service == NULL) {
+            return EXIT_FAILURE;
+        }
+        BBinder_ctor(service);
+        service->incStrong(service, service);
+
+        service_name(&name, round, i);
+        sm->addService(sm, &name, (IBinder*)service, false, DUMP_FLAG_PRIORITY_DEFAULT);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* Number of the round's services still registered once the timeout hit */
+
+static int wait_evicted(IServiceManager* sm, int round)
+{
+    uint64_t deadline = bench_now_ns() + EVICT_TIMEOUT_MS * 1000000ULL;
+    int left;
+
+    do {
+        left = 0;
+        for (int i = 0; i < SERVICES; i++) {
+            String name;
+
+            service_name(&name, round, i);
+            left += sm->checkService(sm, &name) != NULL;
+        }
+        if (left != 0) {
+            usleep(10 * 1000);
+        }
+    } while (left != 0 && bench_now_ns() < deadline);
+
+    return left;
+}
+
+static int run_round(IServiceManager* sm, int round)
+{
+    char arg[16];
+    char* argv[2] = { arg, NULL };
+    int status;
+    pid_t pid;
+
+    snprintf(arg, sizeof(arg), "%d", round);
+    pid = task_create("svcdeath", SCHED_PRIORITY_DEFAULT,
+        CONFIG_BINDER_PERFORMANCE_BINDERLIB_STACKSIZE, child_main, argv);
+    if (pid < 0) {
+        printf("Failed to start round %d\n", round);
+        return SERVICES;
+    }
+    waitpid(pid, &status, 0);
+
+    return wait_evicted(sm, round);
+}
+
+int main(int argc, char** argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : ROUNDS;
+    IServiceManager* sm;
+    struct mallinfo before;
+    struct mallinfo after;
+    uint64_t start;
+    int left = 0;
+
+    if (IPCThreadState_self() == NULL) {
+        printf("Failed to get IPCThreadState\n");
+        return EXIT_FAILURE;
+    }
+
+    sm = defaultServiceManager();
+
+    /* The first round grows the maps of servicemanager to their working
+     * size, heap use is compared from there on.
+     */
+
+    left += run_round(sm, 0);
+    before = mallinfo();
+
+    start = bench_now_ns();
+    for (int round = 1; round <= rounds; round++) {
+        left += run_round(sm, round);
+    }
+    after = mallinfo();
+
+    printf("%d services registered and killed in %.1f ms\n", rounds * SERVICES,
+        (double)(bench_now_ns() - start) / 1000000.0);
+    printf("services left behind: %d\n", left);
+    printf("heap in use: %d -> %d bytes (%+d)\n", before.uordblks, after.uordblks,
+        after.uordblks - before.uordblks);
+
+    return left == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
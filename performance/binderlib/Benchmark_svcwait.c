@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corperation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "base/AidlServiceManager.h"
+#include "base/IPCThreadState.h"
+#include "base/IServiceManager.h"
+#include "base/ProcessState.h"
+
+#include "bench_time.h"
+
+#define ROUNDS 20
+
+/* Time the service takes to come up after the client asked for it */
+
+#define START_DELAY_MS 30
+
+/* Interval of the polling getService() this is compared against */
+
+#define POLL_INTERVAL_MS 100
+
+struct Announcer {
+    IServiceManager* mSm;
+    IBinder* mService;
+    String mName;
+    uint64_t mReadyAt;
+};
+
+typedef struct Announcer Announcer;
+
+static void* announcer_main(void* arg)
+{
+    Announcer* this = arg;
+
+    usleep(START_DELAY_MS * 1000);
+    this->mReadyAt = bench_now_ns();
+    this->mSm->addService(this->mSm, &this->mName, this->mService, false,
+        DUMP_FLAG_PRIORITY_DEFAULT);
+    return NULL;
+}
+
+static IBinder* poll_service(IServiceManager* sm, String* name)
+{
+    IBinder* svc;
+
+    while ((svc = sm->checkService(sm, name)) == NULL) {
+        usleep(POLL_INTERVAL_MS * 1000);
+    }
+    return svc;
+}
+
+static void run(const char* title, IServiceManager* sm, IBinder* service,
+    uint32_t rounds, bool poll)
+{
+    uint64_t total = 0;
+    uint64_t worst = 0;
+
+    for (uint32_t i = 0; i < rounds; i++) {
+        char name[64];
+        Announcer announcer;
+        pthread_t thread;
+        IBinder* svc;
+        uint64_t latency;
+
+        snprintf(name, sizeof(name), "benchmark.svcwait.%d.%s.%" PRIu32,
+            getpid(), poll ? "poll" : "notify", i);
+        String_init(&announcer.mName, name);
+        announcer.mSm = sm;
+        announcer.mService = service;
+
+        pthread_create(&thread, NULL, announcer_main, &announcer);
+        svc = poll ? poll_service(sm, &announcer.mName)
+                   : sm->getService(sm, &announcer.mName);
+        latency = bench_now_ns() - announcer.mReadyAt;
+        pthread_join(thread, NULL);
+
+        if (svc == NULL) {
+            printf("%s: %s never showed up\n", title, name);
+            continue;
+        }
+
+        total += latency;
+        worst = latency > worst ? latency : worst;
+    }
+
+    printf("%-32s %4" PRIu32 " rounds  avg %8.1f us  max %8.1f us\n", title,
+        rounds, (double)total / rounds / 1000.0, (double)worst / 1000.0);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t rounds = argc > 1 ? strtoul(argv[1], NULL, 0) : ROUNDS;
+    ProcessState* ps = ProcessState_self();
+    IServiceManager* sm;
+    BBinder* service;
+
+    if (IPCThreadState_self() == NULL) {
+        printf("Failed to get IPCThreadState\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Registration notifications are oneway calls into this process */
+
+    ps->startThreadPool(ps);
+
+    sm = defaultServiceManager();
+    service = zalloc(sizeof(BBinder));
+    if (sm == NULL || service == NULL) {
+        printf("Failed to set up the service manager or the service\n");
+        return EXIT_FAILURE;
+    }
+
+    BBinder_ctor(service);
+    service->incStrong(service, service);
+
+    printf("service ready -> client ready, service starts %d ms after the request\n",
+        START_DELAY_MS);
+
+    run("getService, notification", sm, (IBinder*)service, rounds, false);
+    run("checkService, 100 ms polling", sm, (IBinder*)service, rounds, true);
+
+    return EXIT_SUCCESS;
+}
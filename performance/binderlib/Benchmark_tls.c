@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "base/IPCThreadState.h"
+#include "base/ProcessGlobal.h"
+#include "base/ProcessState.h"
+
+#include "bench_time.h"
+
+#define ITERATIONS 100000
+
+/* Sink for the looked up pointers, so the loops are not optimized away */
+
+static void* volatile g_sink;
+
+/* The lookup chain IPCThreadState_self() used to walk on every call:
+ * task TLS -> process mutex -> pthread key.
+ */
+
+static IPCThreadState* legacy_self(void)
+{
+    ProcessState_global* global = &ProcessGlobal_lookup()->gProcessState_global;
+    ProcessState* proc;
+
+    pthread_mutex_lock(&global->gProcessMutex);
+    proc = global->gProcessState;
+    pthread_mutex_unlock(&global->gProcessMutex);
+    return (IPCThreadState*)pthread_getspecific(proc->mTLS);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t iters = argc > 1 ? strtoul(argv[1], NULL, 0) : ITERATIONS;
+
+    /* Warm up: create the per-process and per-thread objects */
+
+    if (IPCThreadState_self() == NULL) {
+        printf("Failed to get IPCThreadState\n");
+        return EXIT_FAILURE;
+    }
+
+#ifdef CONFIG_BINDER_LIB_TLS_FAST_PATH
+    printf("TLS fast path: enabled\n");
+#else
+    printf("TLS fast path: disabled\n");
+#endif
+
+    BENCH_RUN("ProcessGlobal_lookup (task TLS)", iters, g_sink = ProcessGlobal_lookup());
+    BENCH_RUN("ProcessGlobal_get", iters, g_sink = ProcessGlobal_get());
+    BENCH_RUN("ProcessState_self", iters, g_sink = ProcessState_self());
+    BENCH_RUN("IPCThreadState_self (legacy chain)", iters, g_sink = legacy_self());
+    BENCH_RUN("IPCThreadState_self", iters, g_sink = IPCThreadState_self());
+    BENCH_RUN("Parcel_global_get", iters, g_sink = Parcel_global_get());
+
+    return EXIT_SUCCESS;
+}
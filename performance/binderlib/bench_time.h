@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2023 Xiaomi Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __BINDER_PERFORMANCE_BINDERLIB_BENCH_TIME_H__
+#define __BINDER_PERFORMANCE_BINDERLIB_BENCH_TIME_H__
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Run BODY `iters` times and print the average cost per iteration */
+
+#define BENCH_RUN(name, iters, BODY)                                       \
+    do {                                                                   \
+        uint64_t __sta = bench_now_ns();                                   \
+        for (uint32_t __i = 0; __i < (uint32_t)(iters); __i++) {           \
+            BODY;                                                          \
+        }                                                                  \
+        uint64_t __ns = bench_now_ns() - __sta;                            \
+        printf("%-40s %10" PRIu32 " iters %10.1f ns/op\n", (name),         \
+            (uint32_t)(iters), (double)__ns / (double)(iters));            \
+    } while (0)
+
+#endif /* __BINDER_PERFORMANCE_BINDERLIB_BENCH_TIME_H__ */